@@ -2,12 +2,27 @@ TEMPLATE = subdirs
 
 # Names of the sub projects
 SUBDIRS = \
+    core \
+    lib \
+    server \
+    cli \
+    capi \
     app \
     tests
 
 # Relative paths to the sub projects
+core.subdir = src/core
+lib.subdir = src/lib
+server.subdir = src/server
+cli.subdir = src/cli
+capi.subdir = src/capi
 app.subdir = src/app
 tests.subdir = src/tests
 
 # What sub projects depend on other sub projects
-tests.depends = app
+lib.depends = core
+server.depends = lib
+cli.depends = server
+capi.depends = lib
+app.depends = lib
+tests.depends = server
@@ -0,0 +1,199 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <math.h>
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QString>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include "abimoapi.h"
+#include "calculation.h"
+#include "constants.h"
+#include "dbaseReader.h"
+#include "diagnosticsink.h"
+#include "initvalues.h"
+
+namespace {
+
+void setOutput(float *column, size_t i, float value)
+{
+    if (column != 0) {
+        column[i] = value;
+    }
+}
+
+void setOutputRow(const abimo_output_columns &output, size_t i, const BlockResult &result)
+{
+    setOutput(output.R, i, result.r);
+    setOutput(output.ROW, i, result.row);
+    setOutput(output.RI, i, result.ri);
+    setOutput(output.RVOL, i, result.rvol);
+    setOutput(output.ROWVOL, i, result.rowvol);
+    setOutput(output.RIVOL, i, result.rivol);
+    setOutput(output.FLAECHE, i, result.flaeche);
+    setOutput(output.VERDUNSTUN, i, result.verdunst);
+}
+
+bool allColumnsGiven(const abimo_input_columns &input)
+{
+    const void *columns[] = {
+        input.NUTZUNG, input.TYP, input.BEZIRK, input.REGENJA, input.REGENSO,
+        input.FLUR, input.FELD_30, input.FELD_150, input.PROBAU, input.PROVGU,
+        input.VGSTRASSE, input.KAN_BEB, input.KAN_VGU, input.KAN_STR,
+        input.BELAG1, input.BELAG2, input.BELAG3, input.BELAG4,
+        input.STR_BELAG1, input.STR_BELAG2, input.STR_BELAG3, input.STR_BELAG4,
+        input.FLGES, input.STR_FLGES
+    };
+
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+        if (columns[i] == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Calculate the rows [begin, end) with an own Calculation object. The
+// InitValues are shared (read only) between the threads.
+class EvaluateRange : public QRunnable
+{
+public:
+    EvaluateRange(
+        const abimo_input_columns &input, const abimo_output_columns &output,
+        InitValues &initValues, size_t begin, size_t end, QAtomicInt &unknownUsage
+    ):
+        input(input), output(output), initValues(initValues),
+        begin(begin), end(end), unknownUsage(unknownUsage)
+    {
+    }
+
+    void run()
+    {
+        // There is no protocol file, messages are only counted
+        QString protocol;
+        QTextStream protocolStream(&protocol);
+
+        Calculation calculation(initValues, protocolStream);
+        calculation.setDiagnosticMode(DiagnosticMode::aggregated, 0);
+
+        abimoRecord record;
+        BlockResult result;
+
+        for (size_t i = begin; i < end; i++) {
+
+            record.NUTZUNG = input.NUTZUNG[i];
+
+            if (record.NUTZUNG == 0) {
+                setOutputRow(output, i, {NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN});
+                continue;
+            }
+
+            // same conversions as in DbaseReader::fillRecord()
+            record.REGENJA = input.REGENJA[i];
+            record.REGENSO = input.REGENSO[i];
+            record.FLUR = input.FLUR[i];
+            record.TYP = input.TYP[i];
+            record.FELD_30 = input.FELD_30[i];
+            record.FELD_150 = input.FELD_150[i];
+            record.BEZIRK = input.BEZIRK[i];
+            record.PROBAU_fraction = input.PROBAU[i] / 100.0F;
+            record.PROVGU_fraction = DbaseReader::floatFraction(input.PROVGU[i]);
+            record.VGSTRASSE_fraction = DbaseReader::floatFraction(input.VGSTRASSE[i]);
+            record.KAN_BEB_fraction = DbaseReader::floatFraction(input.KAN_BEB[i]);
+            record.KAN_VGU_fraction = DbaseReader::floatFraction(input.KAN_VGU[i]);
+            record.KAN_STR_fraction = DbaseReader::floatFraction(input.KAN_STR[i]);
+            record.BELAG1_fraction = DbaseReader::floatFraction(input.BELAG1[i]);
+            record.BELAG2_fraction = DbaseReader::floatFraction(input.BELAG2[i]);
+            record.BELAG3_fraction = DbaseReader::floatFraction(input.BELAG3[i]);
+            record.BELAG4_fraction = DbaseReader::floatFraction(input.BELAG4[i]);
+            record.STR_BELAG1_fraction = DbaseReader::floatFraction(input.STR_BELAG1[i]);
+            record.STR_BELAG2_fraction = DbaseReader::floatFraction(input.STR_BELAG2[i]);
+            record.STR_BELAG3_fraction = DbaseReader::floatFraction(input.STR_BELAG3[i]);
+            record.STR_BELAG4_fraction = DbaseReader::floatFraction(input.STR_BELAG4[i]);
+            record.FLGES = input.FLGES[i];
+            record.STR_FLGES = input.STR_FLGES[i];
+
+            // the rows after an unknown usage are not calculated
+            if (!calculation.calcRecord(record, result)) {
+                unknownUsage.storeRelease(1);
+                return;
+            }
+
+            setOutputRow(output, i, result);
+        }
+    }
+
+private:
+    const abimo_input_columns &input;
+    const abimo_output_columns &output;
+    InitValues &initValues;
+    size_t begin;
+    size_t end;
+    QAtomicInt &unknownUsage;
+};
+
+} // namespace
+
+int abimo_evaluate(
+    const abimo_input_columns *input,
+    const abimo_params *params,
+    abimo_output_columns *output,
+    size_t n,
+    int threads
+)
+{
+    if (input == 0 || output == 0 || !allColumnsGiven(*input)) {
+        return ABIMO_ERROR_ARGUMENT;
+    }
+
+    // Update default initial values with values given in the config file
+    InitValues initValues;
+
+    if (params != 0 && params->config_file != 0) {
+        QString errorMessage = InitValues::updateFromConfig(
+            initValues, QString::fromUtf8(params->config_file)
+        );
+        if (!errorMessage.isEmpty()) {
+            return ABIMO_ERROR_CONFIG;
+        }
+    }
+
+    if (threads <= 0) {
+        threads = MAX(QThread::idealThreadCount(), 1);
+    }
+
+    size_t parts = MIN((size_t) threads, n);
+
+    // set by the ranges with a row of unknown usage
+    QAtomicInt unknownUsage(0);
+
+    if (parts <= 1) {
+        EvaluateRange(*input, *output, initValues, 0, n, unknownUsage).run();
+        return unknownUsage.loadAcquire() ? ABIMO_ERROR_USAGE : ABIMO_OK;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+
+    for (size_t part = 0; part < parts; part++) {
+        pool.start(new EvaluateRange(
+            *input, *output, initValues, n * part / parts, n * (part + 1) / parts,
+            unknownUsage
+        ));
+    }
+
+    pool.waitForDone();
+
+    return unknownUsage.loadAcquire() ? ABIMO_ERROR_USAGE : ABIMO_OK;
+}
+
+const char *abimo_version(void)
+{
+    return VERSION_STRING;
+}
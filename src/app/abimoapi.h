@@ -0,0 +1,111 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef ABIMOAPI_H
+#define ABIMOAPI_H
+
+/*
+ * C interface of the Abimo model (shared library abimoapi, see src/capi).
+ * The calculation runs directly on column arrays owned by the caller, there
+ * is no file input/output. Each row is calculated as by Calculation::calc().
+ */
+
+#include <stddef.h>
+
+#if defined(_WIN32) && !defined(ABIMO_API_STATIC)
+#  if defined(ABIMO_API_BUILD)
+#    define ABIMO_API __declspec(dllexport)
+#  else
+#    define ABIMO_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define ABIMO_API __attribute__((visibility("default")))
+#else
+#  define ABIMO_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Return values of abimo_evaluate() */
+#define ABIMO_OK 0
+#define ABIMO_ERROR_ARGUMENT -1
+#define ABIMO_ERROR_CONFIG -2
+#define ABIMO_ERROR_USAGE -3
+
+/*
+ * Input columns, one value per block partial area and column. The values are
+ * given in the units of the input dbf-file, i.e. shares in percent. All
+ * columns are required.
+ */
+typedef struct abimo_input_columns {
+    const int *NUTZUNG;
+    const int *TYP;
+    const int *BEZIRK;
+    const int *REGENJA;
+    const int *REGENSO;
+    const float *FLUR;
+    const int *FELD_30;
+    const int *FELD_150;
+    const float *PROBAU;
+    const float *PROVGU;
+    const float *VGSTRASSE;
+    const float *KAN_BEB;
+    const float *KAN_VGU;
+    const float *KAN_STR;
+    const float *BELAG1;
+    const float *BELAG2;
+    const float *BELAG3;
+    const float *BELAG4;
+    const float *STR_BELAG1;
+    const float *STR_BELAG2;
+    const float *STR_BELAG3;
+    const float *STR_BELAG4;
+    const float *FLGES;
+    const float *STR_FLGES;
+} abimo_input_columns;
+
+typedef struct abimo_params {
+    /* configuration file (config.xml), NULL: default values */
+    const char *config_file;
+} abimo_params;
+
+/*
+ * Output columns, one value per row of the input. Columns that are NULL are
+ * not written. Rows with NUTZUNG == 0 are not calculated (NaN).
+ */
+typedef struct abimo_output_columns {
+    float *R;
+    float *ROW;
+    float *RI;
+    float *RVOL;
+    float *ROWVOL;
+    float *RIVOL;
+    float *FLAECHE;
+    float *VERDUNSTUN;
+} abimo_output_columns;
+
+/*
+ * Calculate n rows using the given number of threads (<= 0: number of
+ * processor cores). Returns ABIMO_OK or one of the ABIMO_ERROR_* values.
+ * ABIMO_ERROR_USAGE: NUTZUNG of a row is not known, the output is incomplete.
+ */
+ABIMO_API int abimo_evaluate(
+    const abimo_input_columns *input,
+    const abimo_params *params,
+    abimo_output_columns *output,
+    size_t n,
+    int threads
+);
+
+/* Version of the model, e.g. for checks by the caller */
+ABIMO_API const char *abimo_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ABIMOAPI_H */
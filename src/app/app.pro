@@ -14,36 +14,17 @@ QT += \
 
 #CONFIG += console
 
+linkAbimoLibraries()
+
 HEADERS += \
-    bagrov.h \
-    calculation.h \
-    config.h \
-    constants.h \
-    dbaseField.h \
-    dbaseReader.h \
-    dbaseWriter.h \
-    effectivenessunsealed.h \
-    helpers.h \
-    initvalues.h \
+    calculationworker.h \
     main.h \
-    mainwindow.h \
-    pdr.h \
-    saxhandler.h
+    mainwindow.h
 
 SOURCES += \
-    bagrov.cpp \
-    calculation.cpp \
-    config.cpp \
-    dbaseField.cpp \
-    dbaseReader.cpp \
-    dbaseWriter.cpp \
-    effectivenessunsealed.cpp \
-    helpers.cpp \
-    initvalues.cpp \
+    calculationworker.cpp \
     main.cpp \
-    mainwindow.cpp \
-    pdr.cpp \
-    saxhandler.cpp
+    mainwindow.cpp
 
 #RC_FILE += AbimoQt.rc
 #OTHER_FILES += release/config.xml
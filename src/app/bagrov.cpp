@@ -3,8 +3,8 @@
  * of this repository (https://github.com/KWB-R/abimo).
  ***************************************************************************/
 
-#include <QDebug>
 #include <math.h>
+#include <string.h> // for memset()
 
 #include "bagrov.h"
 
@@ -33,8 +33,55 @@
  =======================================================================================================================
  */
 
-Bagrov::Bagrov()
+Bagrov::Bagrov():
+    precision(Precision::legacyFloat),
+    warmStart(false),
+    hasLast(false),
+    lastBag(0),
+    lastA(0),
+    lastB(0),
+    lastC(0),
+    lastBucket(0),
+    lastX(0),
+    lastY(0)
 {
+    resetStatistics();
+}
+
+const BagrovStatistics& Bagrov::getStatistics()
+{
+    return statistics;
+}
+
+void Bagrov::resetStatistics()
+{
+    memset(&statistics, 0, sizeof(BagrovStatistics));
+}
+
+// Start the iterations at the previous solution if the bag values of
+// subsequent calls lie in the same bucket (see getWarmStartBucket()). Most
+// effective if the calls are sorted by bucket and x.
+void Bagrov::setWarmStart(bool value)
+{
+    warmStart = value;
+    hasLast = false;
+}
+
+// Arithmetic of nbagro() and bagrov(), see precision.h
+void Bagrov::setPrecision(Precision value)
+{
+    precision = value;
+    hasLast = false;
+}
+
+Precision Bagrov::getPrecision()
+{
+    return precision;
+}
+
+int Bagrov::getWarmStartBucket(float bag)
+{
+    return (int) floor(MIN(bag, 20.0) / BAGROV_WARM_START_BUCKET);
 }
 
 const float Bagrov::aa[]= {
@@ -58,12 +105,23 @@ const float Bagrov::aa[]= {
 
 float Bagrov::nbagro(float bage, float x)
 {
-    int i, ia, ie, j;
-    float bag, bag_plus_one, reciprocal_bag_plus_one;
-    float a, a0, a1, a2, b, c, epa, eyn, h13, h23, sum_1, sum_2, w, y0;
+    switch (precision) {
+    case Precision::doublePrecision:
+        return (float) evaluate<DoublePolicy>(bage, x);
+    case Precision::fastFloat:
+        return evaluate<FastFloatPolicy>(bage, x);
+    default:
+        return evaluate<LegacyFloatPolicy>(bage, x);
+    }
+}
 
-    // General helper variable of type float
-    float h;
+// nbagro() with the arithmetic of the policy P
+template <class P>
+typename P::real Bagrov::evaluate(typename P::real bage, typename P::real x)
+{
+    typedef typename P::real real;
+
+    real bag, a, b, c, y;
 
     // If input value x is already below a threshold, return 0.0
     if (x < 0.0005F) {
@@ -76,12 +134,54 @@ float Bagrov::nbagro(float bage, float x)
     // Set local variable bag to value of parameter bage (20.0 at maximum)
     bag = MIN(bage, 20.0);
 
+    if (!warmStart) {
+        coefficients<P>(bag, a, b, c);
+        return solve<P>(bag, x, a, b, c, false);
+    }
+
+    int bucket = getWarmStartBucket(bag);
+
+    if (hasLast && bag == lastBag) {
+        a = (real) lastA;
+        b = (real) lastB;
+        c = (real) lastC;
+    }
+    else {
+        coefficients<P>(bag, a, b, c);
+    }
+
+    y = solve<P>(bag, x, a, b, c, hasLast && bucket == lastBucket);
+
+    hasLast = true;
+    lastBag = bag;
+    lastA = a;
+    lastB = b;
+    lastC = c;
+    lastBucket = bucket;
+    lastX = x;
+    lastY = y;
+
+    return y;
+}
+
+// KOEFFIZIENTEN DER BEDINGUNGSGLEICHUNG UND DES LOESUNGSANSATZES, they only
+// depend on bag
+template <class P>
+void Bagrov::coefficients(
+    typename P::real bag, typename P::real &a, typename P::real &b, typename P::real &c
+)
+{
+    typedef typename P::real real;
+
+    real bag_plus_one, reciprocal_bag_plus_one;
+    real a0, a1, a2, h13, h23;
+
     // Calculate expressions that are based on bag
     bag_plus_one = bag + 1.0F;
-    reciprocal_bag_plus_one = (float) (1.0 / bag_plus_one);
+    reciprocal_bag_plus_one = (real) (1.0 / bag_plus_one);
 
-    h13 = (float) exp(-bag_plus_one * 1.09861);
-    h23 = (float) exp(-bag_plus_one * 0.405465);
+    h13 = (real) P::exp(-bag_plus_one * 1.09861);
+    h23 = (real) P::exp(-bag_plus_one * 0.405465);
 
     // KOEFFIZIENTEN DER BEDINGUNGSGLEICHUNG
     a2 = -13.5F * reciprocal_bag_plus_one * (1.0F + 3.0F * (h13 - h23));
@@ -94,13 +194,38 @@ float Bagrov::nbagro(float bage, float x)
 
     // KOEFFIZIENTEN DES LOESUNSANSATZES
     b = (bag >= 0.49999F) ?
-        (- (float) sqrt(0.25 * a1 * a1 - a2) + 0.5F * a1) :
-        (- (float) sqrt(0.5F * a1 * a1 - a2));
+        (- (real) sqrt(0.25 * a1 * a1 - a2) + 0.5F * a1) :
+        (- (real) sqrt(0.5F * a1 * a1 - a2));
 
     c = a1 - b;
     a = a0 / (b - c);
+}
 
-    epa = (float) exp(x / a);
+// y is monotone in x: if the last solution for the same bag and a lower x
+// was already 1, the solution is 1 (the iteration would only run into its
+// limit, y = 1 is not a point of convergence)
+bool Bagrov::isSaturated(double bag, double x)
+{
+    return warmStart && hasLast && bag == lastBag && x >= lastX && lastY >= 1.0F;
+}
+
+// Solution y for bag and x (already limited), warm: start the iteration at
+// the last solution
+template <class P>
+typename P::real Bagrov::solve(
+    typename P::real bag, typename P::real x,
+    typename P::real a, typename P::real b, typename P::real c, bool warm
+)
+{
+    typedef typename P::real real;
+
+    int i, ia, ie, j;
+    real epa, eyn, sum_1, sum_2, w, y0;
+
+    // General helper variable of type float
+    real h;
+
+    epa = (real) P::exp(x / a);
 
     // NULLTE NAEHERUNGSLOESUNG (1. Naeherungsloesung)
     // Limit y0 to its maximum allowed value
@@ -108,36 +233,74 @@ float Bagrov::nbagro(float bage, float x)
 
     // If bag is between a certain range return y0
     if (bag >= 0.7F && bag <= 3.8F) {
+        statistics.calls[closedForm]++;
         return y0;
     }
 
     // NUMERISCHE INTEGRATION FUER BAG > 3.8 (3. Naeherungsloesung)
     if (bag >= 3.8F) {
+        statistics.calls[newton]++;
+
+        if (isSaturated(bag, x)) {
+            statistics.warmStarts++;
+            return 1.0F;
+        }
+
+        if (warm) {
+            statistics.warmStarts++;
+            y0 = (real) lastY;
+        }
+
         h = 1.0F;
         i = 0;
         while(fabs(h) > 0.001 && i < 15) {
             y0 = MIN(y0, 0.999F);
-            epa = (float) exp(bag * log(y0));
+            epa = (real) P::exp(bag * P::log(y0));
             h = MIN(MAX(1.0F - epa, ALMOST_ZERO), ALMOST_ONE);
-            h *= (y0 + epa * y0 / (float) (h - bag * epa / (float) log(h)) - x);
+            h *= (y0 + epa * y0 / (real) (h - bag * epa / (real) P::log(h)) - x);
             y0 -= h;
             i++;
         }
 
+        statistics.iterations[newton] += i;
+
+        if (fabs(h) > 0.001) {
+            statistics.notConverged[newton]++;
+        }
+
         // Return y0 (1.0 at maximum)
         return MIN(y0, 1.0);
     }
 
     // NUMERISCHE INTEGRATION FUER BAG<0.7 (2.Naeherungsloesung)
-    //j = 1;
+    statistics.calls[seriesExpansion]++;
+
+    if (isSaturated(bag, x)) {
+        statistics.warmStarts++;
+        return 1.0F;
+    }
+
+    // The iteration stops as soon as eyn > 0.9 (see below). It starts at the
+    // last solution only if neither the zeroth approximation nor the last
+    // solution are in that range.
+    if (
+        warm && (real) P::exp(bag * P::log(y0)) <= 0.9F &&
+        (real) P::exp(bag * P::log((real) lastY)) <= 0.9F
+    ) {
+        statistics.warmStarts++;
+        y0 = (real) lastY;
+    }
 
-    while (true/*j <= 30*/)
+    bool converged = false;
+
+    for (int iteration = 0; iteration < BAGROV_MAX_ITERATIONS; iteration++)
     {
-        eyn = (float) exp(bag * log(y0));
+        statistics.iterations[seriesExpansion]++;
+
+        eyn = (real) P::exp(bag * P::log(y0));
 
         // If eyn, bag are in a certain range, return y0 (1.0 at maximum)
         if ((eyn > 0.9F) || (eyn >= UPPER_LIMIT_EYN && bag > 4.0F)) {
-            //*y = MIN(y0, 1.0);
             return MIN(y0, 1.0);
         }
 
@@ -161,7 +324,7 @@ float Bagrov::nbagro(float bage, float x)
             h *= eyn;
             w = aa[i - 1] * h;
             j = i - ia + 1; /* cls J=I-IA+1 */
-            sum_2 += w / (j * (float) bag + 1.0F);
+            sum_2 += w / (j * (real) bag + 1.0F);
             sum_1 += w;
         }
 
@@ -172,116 +335,236 @@ float Bagrov::nbagro(float bage, float x)
 
         // Break out of this loop if a condition is met
         if (fabs(h) / y0 < 0.007F) {
+            converged = true;
             break;
         }
+    }
 
-        //j++;
+    if (!converged) {
+        statistics.notConverged[seriesExpansion]++;
     }
 
     if (y0 > 0.9) {
-        bagrov(&bag, &x, &y0);
-    }
-    else {
-      //qDebug() << "y0 <= 0.9 -> not calling bagrov()";
+        solveIntegral<P>(bag, x, y0);
     }
 
     // Return y0 (1.0 at maximum)
     return MIN(y0, 1.0);
 }
 
+BagrovCurve::BagrovCurve():
+    solver(0),
+    precision(Precision::legacyFloat),
+    bag(0),
+    a(0),
+    b(0),
+    c(0)
+{}
+
+// The coefficients are calculated with the precision of the solver
+BagrovCurve::BagrovCurve(Bagrov &solver, float bag):
+    solver(&solver),
+    precision(solver.getPrecision())
+{
+    switch (precision) {
+    case Precision::doublePrecision:
+        init<DoublePolicy>(bag);
+        break;
+    case Precision::fastFloat:
+        init<FastFloatPolicy>(bag);
+        break;
+    default:
+        init<LegacyFloatPolicy>(bag);
+    }
+}
+
+template <class P>
+void BagrovCurve::init(float bage)
+{
+    typename P::real bagP, aP, bP, cP;
+
+    bagP = MIN(bage, 20.0);
+    Bagrov::coefficients<P>(bagP, aP, bP, cP);
+
+    bag = bagP;
+    a = aP;
+    b = bP;
+    c = cP;
+}
+
+float BagrovCurve::getBag()
+{
+    return (float) bag;
+}
+
+// Same as Bagrov::nbagro(bag, x)
+float BagrovCurve::y(float x)
+{
+    switch (precision) {
+    case Precision::doublePrecision:
+        return (float) evaluate<DoublePolicy>(x);
+    case Precision::fastFloat:
+        return evaluate<FastFloatPolicy>(x);
+    default:
+        return evaluate<LegacyFloatPolicy>(x);
+    }
+}
+
+// ys[i] = y(xs[i]) for i = 0..n - 1
+void BagrovCurve::y(const float *xs, float *ys, int n)
+{
+    for (int i = 0; i < n; i++) {
+        ys[i] = y(xs[i]);
+    }
+}
+
+// y() with the arithmetic of the policy P (the one of the solver at
+// construction)
+template <class P>
+typename P::real BagrovCurve::evaluate(typename P::real x)
+{
+    typedef typename P::real real;
+
+    if (x < 0.0005F) {
+        return 0.0F;
+    }
+
+    return solver->solve<P>((real) bag, MIN(x, 15.0F), (real) a, (real) b, (real) c, false);
+}
+
+template <class P>
+void BagrovCurve::evaluate(const typename P::real *xs, typename P::real *ys, int n)
+{
+    for (int i = 0; i < n; i++) {
+        ys[i] = evaluate<P>(xs[i]);
+    }
+}
+
 /*
  =======================================================================================================================
-    FIXME:
+    Loesung der Bagrovbeziehung durch numerische Integration: y0 wird ausgehend von 0.5 hoechstens
+    BAGROV_MAX_CORRECTIONS mal korrigiert, bis die Korrektur kleiner als 0.01 ist. Solve the Bagrov relation
+    x0 = integral(bag, y0) for y0 by at most BAGROV_MAX_CORRECTIONS corrections, starting with y0 = 0.5.
  =======================================================================================================================
  */
 void Bagrov::bagrov(float *bagf, float *x0, float *y0)
 {
-    bool doloop; /* LOGICAL16 */
-    int _do0, i, ii, j;
+    double y;
+
+    switch (precision) {
+    case Precision::doublePrecision:
+        solveIntegral<DoublePolicy>(*bagf, *x0, y);
+        *y0 = (float) y;
+        break;
+    case Precision::fastFloat:
+        solveIntegral<FastFloatPolicy>(*bagf, *x0, *y0);
+        break;
+    default:
+        solveIntegral<LegacyFloatPolicy>(*bagf, *x0, *y0);
+    }
+}
+
+template <class P>
+void Bagrov::solveIntegral(typename P::real bag, typename P::real x0, typename P::real &y0)
+{
+    typedef typename P::real real;
+
+    real delta, x;
 
-    qDebug() << "In bagrov()...";
+    statistics.integrations++;
 
-    /* meiko : initialisiere i (einzige Aenderung) */
-    i = 0;
+    if (x0 == 0.0) {
+        y0 = 0.0F;
+        return;
+    }
+
+    if (x0 > integrate<P>(bag, 0.99F)) {
+        y0 = 1.0F;
+        return;
+    }
 
-    float	delta, du, h, s, s1, sg, si, su, u, x;
+    y0 = 0.5F;
+
+    /* SCHLEIFE I=1(1)10 ZUR BERECHNUNG VON DELTA */
+    for (int i = 1; i <= BAGROV_MAX_CORRECTIONS; i++) {
+
+        x = integrate<P>(bag, y0);
+
+        delta = (x0 - x) * (1.0F - (real) P::exp(bag * (real) P::log(y0)));
+        y0 = y0 + delta;
+
+        if (y0 >= 1.0) {
+            y0 = 0.99F;
+        }
+        else if (y0 <= 0.0) {
+            y0 = 0.01F;
+        }
+        else if (fabs(delta) < 0.01F) {
+            return;
+        }
+    }
+
+    statistics.notConverged[seriesExpansion]++;
+}
+
+/*
+ =======================================================================================================================
+    NUMERISCHE INTEGRATION DER BAGROVBEZIEHUNG: Simpson's rule for the integral of 1 / (1 - u^bag) from 0 to y. The
+    number of intervals is doubled until the result changes by less than 0.1 %, at most BAGROV_MAX_REFINEMENTS times.
+ =======================================================================================================================
+ */
+template <class P>
+typename P::real Bagrov::integrate(typename P::real bag, typename P::real y)
+{
+    typedef typename P::real real;
 
-    if (*x0 == 0.0) goto L_10;
-    *y0 = 0.99F;
-    goto L_20;
-L_10:
-    *y0 = 0.0F;
-    return;
-L_20:
-    doloop = false;
+    int ii, j;
+    real du, h, s, sg, si, su, u;
 
-    /* NUMERISCHE INTEGRATION DER BAGROVBEZIEHUNG */
-L_21:
     j = 1;
-    du = 2.0F **y0;
-    h = 1.0F + 1.0F / (1.0F - (float) exp(*bagf * log(*y0)));
+    du = 2.0F * y;
+    h = 1.0F + 1.0F / (1.0F - (real) P::exp(bag * P::log(y)));
     si = h * du / 4.0F;
     sg = 0.0F;
     su = 0.0F;
-L_1:
-    s = si;
-    j = j * 2;
-    du = du / 2.0F;
-    u = du / 2.0F;
-    sg = sg + su;
-    su = 0.0F;
 
-    for (ii = 1, _do0 = j; ii <= _do0; ii += 2)
-    {
-        su = su + 1.0F / (1.0F - (float) exp(*bagf * log(u)));
-        u = u + du;
+    for (int refinement = 0; refinement < BAGROV_MAX_REFINEMENTS; refinement++) {
+
+        s = si;
+        j = j * 2;
+        du = du / 2.0F;
+        u = du / 2.0F;
+        sg = sg + su;
+        su = 0.0F;
+
+        for (ii = 1; ii <= j; ii += 2)
+        {
+            su = su + 1.0F / (1.0F - (real) P::exp(bag * P::log(u)));
+            u = u + du;
+        }
+
+        si = (2.0F * sg + 4.0F * su + h) * du / 6.0F;
+
+        // (also stops on NaN, as before)
+        if (!(fabs(s - si) > 0.001F * s)) {
+            return si;
+        }
     }
 
-    si = (2.0F * sg + 4.0F * su + h) * du / 6.0F;
-    s1 = 0.001F * s;
-    if (fabs(s - si) > s1) goto L_1;
-    x = si;
-
-    /* ENDE DER NUMERISCHEN INTEGRATION */
-    if (doloop) goto L_42;
-    if (*x0 > x) goto L_30;
-    *y0 = 0.5F;
-    goto L_40;
-L_30:
-    *y0 = 1.0F;
-    return;
-L_40:
-    i = 1;
+    statistics.notConverged[seriesExpansion]++;
 
-    /* SCHLEIFE I=1(1)10 ZUR BERECHNUNG VON DELTA */
-L_41:
-    doloop = true;
-    goto L_21;
-L_42:
-    delta = (*x0 - x) * (1.0F - (float) exp(*bagf * (float) log(*y0)));
-    *y0 = *y0 + delta;
-    if (*y0 >= 1.0) goto L_50;
-    if (*y0 <= 0.0) goto L_60;
-    goto L_70;
-L_50:
-    *y0 = 0.99F;
-    goto L_90;
-L_60:
-    *y0 = 0.01F;
-    goto L_90;
-L_70:
-    if (fabs(delta) < 0.01F) goto L_80;
-    goto L_90;
-L_80:
-    ;
-    return;
-L_90:
-    if (i < 10) goto L_91;
-    goto L_92;
-L_91:
-    i = i + 1;
-    goto L_41;
-L_92:
-    ;
-    return;
-}	/* end of function */
+    return si;
+}
+
+// Instances used by Calculation
+template float Bagrov::evaluate<LegacyFloatPolicy>(float, float);
+template double Bagrov::evaluate<DoublePolicy>(double, double);
+template float Bagrov::evaluate<FastFloatPolicy>(float, float);
+
+template float BagrovCurve::evaluate<LegacyFloatPolicy>(float);
+template double BagrovCurve::evaluate<DoublePolicy>(double);
+template float BagrovCurve::evaluate<FastFloatPolicy>(float);
+
+template void BagrovCurve::evaluate<LegacyFloatPolicy>(const float*, float*, int);
+template void BagrovCurve::evaluate<DoublePolicy>(const double*, double*, int);
+template void BagrovCurve::evaluate<FastFloatPolicy>(const float*, float*, int);
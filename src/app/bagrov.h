@@ -6,16 +6,121 @@
 #ifndef BAGROV_H /* Prevent multiple includes */
 #define BAGROV_H
 
+#include "precision.h"
+
+// Iteration limits of the numerical solutions (the loops were unbounded
+// before). nbagro() does not reach them for realistic input; the numerical
+// integration only stops at its limit where it did not converge before.
+#define BAGROV_MAX_ITERATIONS 30
+#define BAGROV_MAX_REFINEMENTS 16
+#define BAGROV_MAX_CORRECTIONS 10
+
+// Regimes of Bagrov::nbagro() depending on the effectiveness parameter bag
+enum BagrovRegime {
+    // bag < 0.7: iteration of a series expansion
+    seriesExpansion,
+    // 0.7 <= bag <= 3.8: closed approximation, no iteration
+    closedForm,
+    // bag > 3.8: Newton iteration
+    newton
+};
+
+#define BAGROV_REGIMES 3
+
+// Width of the bag intervals within which Bagrov::nbagro() starts the
+// iteration at the previous solution (see Bagrov::setWarmStart())
+#define BAGROV_WARM_START_BUCKET 0.01F
+
+// Work done by Bagrov::nbagro() since the last reset
+struct BagrovStatistics {
+    long calls[BAGROV_REGIMES];
+    long iterations[BAGROV_REGIMES];
+
+    // solutions stopped at an iteration limit (the numerical integration
+    // counts for seriesExpansion, it is only used there)
+    long notConverged[BAGROV_REGIMES];
+
+    // calls of the numerical integration Bagrov::bagrov()
+    long integrations;
+
+    // iterations started at the previous solution (see Bagrov::setWarmStart())
+    long warmStarts;
+};
+
+class BagrovCurve;
+
 class Bagrov
 {
+    friend class BagrovCurve;
 
 public:
     Bagrov();
     float nbagro(float bage, float x);
+    template <class P> typename P::real evaluate(typename P::real bage, typename P::real x);
     void bagrov(float *bagf, float *x0, float *y0);
+    const BagrovStatistics& getStatistics();
+    void resetStatistics();
+    void setWarmStart(bool value);
+    static int getWarmStartBucket(float bag);
+    void setPrecision(Precision value);
+    Precision getPrecision();
 
 private:
     const static float aa[];
+    BagrovStatistics statistics;
+    Precision precision;
+
+    // Warm start: the coefficients a, b, c of the last bag and the last
+    // solution (x, y) are kept. The iteration for a bag in the same bucket
+    // starts at the last solution instead of the zeroth approximation. The
+    // results are the same within the convergence criteria, but not
+    // bit-identical. (double holds the values of all precisions exactly)
+    bool warmStart;
+    bool hasLast;
+    double lastBag;
+    double lastA, lastB, lastC;
+    int lastBucket;
+    double lastX, lastY;
+
+    template <class P> static void coefficients(
+        typename P::real bag, typename P::real &a, typename P::real &b, typename P::real &c
+    );
+    bool isSaturated(double bag, double x);
+    template <class P> typename P::real solve(
+        typename P::real bag, typename P::real x,
+        typename P::real a, typename P::real b, typename P::real c, bool warm
+    );
+    template <class P> void solveIntegral(
+        typename P::real bag, typename P::real x0, typename P::real &y0
+    );
+    template <class P> typename P::real integrate(typename P::real bag, typename P::real y);
+};
+
+// Bagrov relation y(x) for a fixed effectiveness parameter bag, e.g. of a
+// sealed surface class that is constant for a whole run. The coefficients
+// that only depend on bag are calculated once. The results are the same as
+// those of Bagrov::nbagro(bag, x), calls are counted by the given Bagrov.
+class BagrovCurve
+{
+
+public:
+    BagrovCurve();
+    BagrovCurve(Bagrov &solver, float bag);
+    float getBag();
+    float y(float x);
+    void y(const float *xs, float *ys, int n);
+    template <class P> typename P::real evaluate(typename P::real x);
+    template <class P> void evaluate(const typename P::real *xs, typename P::real *ys, int n);
+
+private:
+    Bagrov *solver;
+    Precision precision;
+
+    // values of the precision of the solver
+    double bag;
+    double a, b, c;
+
+    template <class P> void init(float bage);
 };
 
 #endif
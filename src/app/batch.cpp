@@ -0,0 +1,741 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QtDebug>
+
+#include "bagrov.h"
+#include "batch.h"
+#include "blockmodel.h"
+#include "calculation.h"
+#include "constants.h"
+#include "dbaseReader.h"
+#include "helpers.h"
+#include "initvalues.h"
+#include "recordfilter.h"
+#include "recordstore.h"
+#include "resultcache.h"
+
+void defineParser(QCommandLineParser* parser)
+{
+    parser->setApplicationDescription("Abimo-Programm");
+    parser->addHelpOption();
+    parser->addVersionOption();
+
+    parser->addPositionalArgument(
+        "source",
+        QCoreApplication::translate("main", "Input dbf-file.")
+    );
+
+    parser->addPositionalArgument(
+        "destination",
+        QCoreApplication::translate("main", "Destination dbf-file (optional)."),
+        "[destination]"
+    );
+
+    // Option -d --debug: debug mode
+    QCommandLineOption debugOption(
+        QStringList() << "d" << "debug",
+        QCoreApplication::translate("main", "Show debug information.")
+    );
+
+    // Option -c --config <config-file>
+    QCommandLineOption configOption(
+        QStringList() << "c" << "config",
+        QCoreApplication::translate("main", "Override initial values with values in 'config.xml'"),
+        QCoreApplication::translate("main", "config-file")
+    );
+
+    // Option --write-bagrov-table
+    QCommandLineOption bagrovOption(
+        QStringList() << "b" << "write-bagrov-table",
+        QCoreApplication::translate("main", "Output table of Bagrov calculations")
+    );
+
+    // Option -s --series <mode>
+    QCommandLineOption seriesOption(
+        QStringList() << "s" << "series",
+        QCoreApplication::translate("main", "Calculate the years given in columns REGENJA_<year> "
+            "(and REGENSO_<year>) and write a CSV file with one row per block and year "
+            "(mode 'years') or statistics over all years (mode 'stats')"),
+        QCoreApplication::translate("main", "mode")
+    );
+
+    // Option --compile
+    QCommandLineOption compileOption(
+        QStringList() << "compile",
+        QCoreApplication::translate("main", "Compile the input dbf-file into a block model "
+            "file (destination, default: <source>.abm) that can be evaluated with --model")
+    );
+
+    // Option -m --model
+    QCommandLineOption modelOption(
+        QStringList() << "m" << "model",
+        QCoreApplication::translate("main", "Source is a block model file created with --compile")
+    );
+
+    // Option --dedup
+    QCommandLineOption dedupOption(
+        QStringList() << "dedup",
+        QCoreApplication::translate("main", "Calculate blocks with identical parameters only once")
+    );
+
+    // Option --warm-start
+    QCommandLineOption warmStartOption(
+        QStringList() << "warm-start",
+        QCoreApplication::translate("main", "Calculate the blocks sorted by their Bagrov "
+            "parameters and start the iterations at the previous solution (faster, "
+            "results differ slightly)")
+    );
+
+    // Option --precision <policy>
+    QCommandLineOption precisionOption(
+        QStringList() << "precision",
+        QCoreApplication::translate("main", "Arithmetic of the calculation: 'legacy' (float, "
+            "reference results, default), 'double' or 'fast' (float with approximated exp "
+            "and log)"),
+        QCoreApplication::translate("main", "policy")
+    );
+
+    // Option --precision-report
+    QCommandLineOption precisionReportOption(
+        QStringList() << "precision-report",
+        QCoreApplication::translate("main", "Calculate the source with each arithmetic and "
+            "write the differences to the legacy results (CSV) to stdout")
+    );
+
+    // Option --log-summary <n>
+    QCommandLineOption logSummaryOption(
+        QStringList() << "log-summary",
+        QCoreApplication::translate("main", "Write the number of messages per message type "
+            "and the first <n> messages of each type to the log file instead of one "
+            "message per block"),
+        QCoreApplication::translate("main", "n")
+    );
+
+    // Option --serve <name>
+    QCommandLineOption serveOption(
+        QStringList() << "serve",
+        QCoreApplication::translate("main", "Run as job server listening on the local socket "
+            "<name>, jobs are given as JSON (see jobserver.h)"),
+        QCoreApplication::translate("main", "name")
+    );
+
+    // Option --delta <file>
+    QCommandLineOption deltaOption(
+        QStringList() << "delta",
+        QCoreApplication::translate("main", "Calculate only the blocks in the dbf-file <file> "
+            "(changed or new blocks, NUTZUNG = 0 for removed blocks) and merge their results "
+            "into the result of the previous run on the input file (see --previous)"),
+        QCoreApplication::translate("main", "file")
+    );
+
+    // Option --config-diff <file>
+    QCommandLineOption configDiffOption(
+        QStringList() << "config-diff",
+        QCoreApplication::translate("main", "Configuration file <file> of the previous run: "
+            "calculate only the blocks affected by the changes of the configuration (--config) "
+            "and take all other results from the previous result (see --previous)"),
+        QCoreApplication::translate("main", "file")
+    );
+
+    // Option --previous <file>
+    QCommandLineOption previousOption(
+        QStringList() << "previous",
+        QCoreApplication::translate("main", "Result file of the previous run used by --delta "
+            "or --config-diff (default: the output file, which is then updated in place)"),
+        QCoreApplication::translate("main", "file")
+    );
+
+    // Option --result-cache <file>
+    QCommandLineOption resultCacheOption(
+        QStringList() << "result-cache",
+        QCoreApplication::translate("main", "Take the results of blocks calculated before "
+            "from the cache file <file> and add new results to it (the file is created if "
+            "needed and may be shared by several runs, see resultcache.h)"),
+        QCoreApplication::translate("main", "file")
+    );
+
+    // Option --result-cache-size <slots>
+    QCommandLineOption resultCacheSizeOption(
+        QStringList() << "result-cache-size",
+        QCoreApplication::translate("main", "Number of results the cache file of "
+            "--result-cache holds, about 200 bytes each (default for a new file: 65536, "
+            "an existing file of another size is recreated)"),
+        QCoreApplication::translate("main", "slots")
+    );
+
+    // Option --http <port>
+    QCommandLineOption httpOption(
+        QStringList() << "http",
+        QCoreApplication::translate("main", "Load the input file and answer what-if requests "
+            "for single blocks on http://localhost:<port>/evaluate (see whatifserver.h)"),
+        QCoreApplication::translate("main", "port")
+    );
+
+    // Option --where <filter>
+    QCommandLineOption whereOption(
+        QStringList() << "where",
+        QCoreApplication::translate("main", "Calculate only the blocks matching <filter>: "
+            "BEZIRK=<list>, NUTZUNG=<list> or CODE=<list> with comma separated values, "
+            "or CODE=@<file> with one code per line (the option may be repeated, the "
+            "blocks must match all filters)"),
+        QCoreApplication::translate("main", "filter")
+    );
+
+    // Option --lookup <codes>
+    QCommandLineOption lookupOption(
+        QStringList() << "lookup",
+        QCoreApplication::translate("main", "Write the records of the (input or result) "
+            "file with the given codes to stdout as CSV, <codes> is a comma separated "
+            "list or @<file> with one code per line. The records are found in the code "
+            "index of the file (<file>.codeindex, built on first use, see codeindex.h)"),
+        QCoreApplication::translate("main", "codes")
+    );
+
+    parser->addOption(debugOption);
+    parser->addOption(configOption);
+    parser->addOption(bagrovOption);
+    parser->addOption(seriesOption);
+    parser->addOption(compileOption);
+    parser->addOption(modelOption);
+    parser->addOption(dedupOption);
+    parser->addOption(warmStartOption);
+    parser->addOption(precisionOption);
+    parser->addOption(precisionReportOption);
+    parser->addOption(logSummaryOption);
+    parser->addOption(serveOption);
+    parser->addOption(deltaOption);
+    parser->addOption(configDiffOption);
+    parser->addOption(previousOption);
+    parser->addOption(resultCacheOption);
+    parser->addOption(resultCacheSizeOption);
+    parser->addOption(httpOption);
+    parser->addOption(whereOption);
+    parser->addOption(lookupOption);
+}
+
+void debugInputs(
+    QString inputFileName,
+    QString outputFileName,
+    QString configFileName,
+    QString logFileName,
+    bool debug
+)
+{
+    qDebug() << "Running in batch mode...";
+    qDebug() << "inputFileName =" << inputFileName;
+    qDebug() << "outputFileName =" << outputFileName;
+    qDebug() << "configFile =" << configFileName;
+    qDebug() << "logFileName =" << logFileName;
+    qDebug() << "debug =" << debug;
+}
+
+// Options/arguments for example call on the command line
+// --config ..\config.xml ..\abimo_2012ges.dbf ..\abimo-result.dbf
+
+int main_batch(int argc, char *argv[], const ServerModes *servers)
+{    
+    QCoreApplication app(argc, argv);
+    app.setApplicationVersion(VERSION_STRING);
+
+    QCommandLineParser parser;
+    defineParser(&parser);
+
+    // Process the actual command line arguments given by the user
+    parser.process(app);
+
+    if ((parser.isSet("serve") || parser.isSet("http")) && servers == 0) {
+        qDebug() << "Error: --serve and --http are only available in abimo-cli";
+        return 1;
+    }
+
+    // Handle --serve: keep running and calculate the jobs sent by clients
+    if (parser.isSet("serve")) {
+        return servers->serveJobs(app, parser.value("serve"));
+    }
+
+    const QStringList positionalArgs = parser.positionalArguments();
+    QString inputFileName = Helpers::positionalArgOrNULL(&parser, 0);
+
+    QString outputFileName = Helpers::positionalArgOrNULL(&parser, 1);
+
+    bool series = parser.isSet("series");
+    bool compile = parser.isSet("compile");
+    bool useModel = parser.isSet("model");
+
+    // If no output file name was given, create a default output file name
+    if (outputFileName == NULL) {
+        if (series) {
+            outputFileName = Helpers::defaultSeriesFileName(inputFileName);
+        }
+        else if (compile) {
+            outputFileName = Helpers::defaultModelFileName(inputFileName);
+        }
+        else {
+            outputFileName = Helpers::defaultOutputFileName(inputFileName);
+        }
+    }
+
+    QString configFileName= parser.value("config");
+
+    QString logFileName = Helpers::defaultLogFileName(outputFileName);
+    bool debug = parser.isSet("debug");
+
+    DiagnosticMode diagnosticMode = parser.isSet("log-summary") ?
+        DiagnosticMode::aggregated : DiagnosticMode::full;
+    int maxExamples = parser.value("log-summary").toInt();
+
+    // Handle --write_bagrov-table
+    if (parser.isSet("write-bagrov-table")) {
+        writeBagrovTable();
+        return 0;
+    }
+
+    // Handle --lookup: only the records with the codes are read
+    if (parser.isSet("lookup")) {
+        return writeLookup(inputFileName, parser.value("lookup")) ? 0 : 1;
+    }
+
+    Precision precision = Precision::legacyFloat;
+
+    if (parser.isSet("precision") && !parsePrecision(parser.value("precision"), precision)) {
+        qDebug() << "Unknown precision (expected 'legacy', 'double' or 'fast'): " <<
+            parser.value("precision");
+        return 1;
+    }
+
+    RecordFilter filter;
+    QStringList filters = parser.values("where");
+
+    for (int i = 0; i < filters.size(); i++) {
+        if (!filter.add(filters.at(i))) {
+            qDebug() << "Error: " << filter.getError();
+            return 1;
+        }
+    }
+
+    if (!filter.isEmpty() && (
+        useModel || parser.isSet("delta") || parser.isSet("config-diff") ||
+        parser.isSet("http") || parser.isSet("precision-report")
+    )) {
+        qDebug() << "Error: --where is not supported with --model, --delta, "
+                    "--config-diff, --http or --precision-report";
+        return 1;
+    }
+
+    // Both need the records of a dbf-file, a block model has none
+    if (useModel && (parser.isSet("precision-report") || parser.isSet("http"))) {
+        qDebug() << "Error: --precision-report and --http are not supported with --model";
+        return 1;
+    }
+
+    // Only calc() deduplicates or warm-starts the blocks
+    if ((parser.isSet("dedup") || parser.isSet("warm-start")) && (
+        series || compile || useModel || parser.isSet("delta") || parser.isSet("config-diff")
+    )) {
+        qDebug() << "Error: --dedup and --warm-start are not supported with --series, "
+                    "--compile, --model, --delta or --config-diff";
+        return 1;
+    }
+
+    // The cache holds results of the reference calculation, warm-started
+    // results differ slightly
+    if (parser.isSet("result-cache") && parser.isSet("warm-start")) {
+        qDebug() << "Error: --result-cache is not supported with --warm-start";
+        return 1;
+    }
+
+    // The cache file is only created for runs that look up results in it
+    if (parser.isSet("result-cache") && (series || compile || useModel)) {
+        qDebug() << "Error: --result-cache is not supported with --series, --compile or --model";
+        return 1;
+    }
+
+    if (parser.isSet("result-cache-size") && parser.value("result-cache-size").toUInt() == 0) {
+        qDebug() << "Error: --result-cache-size expects a positive number of slots: " <<
+            parser.value("result-cache-size");
+        return 1;
+    }
+
+    debugInputs(inputFileName, outputFileName, configFileName, logFileName, debug);
+
+    // A block model is memory mapped later, there is no dbf-file to read
+    DbaseReader dbReader(useModel ? QString() : inputFileName);
+
+    if (! useModel && ! dbReader.checkAndRead()) {
+        qDebug() << dbReader.getFullError();
+        return 2;
+    }
+
+    // Update default initial values with values given in config.xml
+    InitValues initValues;
+    QString errorMessage = InitValues::updateFromConfig(initValues, configFileName);
+
+    if (errorMessage.length() > 0) {
+        qDebug() << "Error: " << errorMessage;
+    }
+
+    // Handle --precision-report
+    if (parser.isSet("precision-report")) {
+        return writePrecisionReport(dbReader, initValues) ? 0 : 1;
+    }
+
+    // Handle --http: keep running and answer what-if requests on the input
+    if (parser.isSet("http")) {
+        return servers->serveWhatIf(app, dbReader, initValues, parser.value("http").toUShort());
+    }
+
+    QFile logFile(logFileName);
+
+    if (! logFile.open(QFile::WriteOnly)) {
+        qDebug() << "Konnte Datei: '" << logFileName <<
+            "' nicht oeffnen.\n" << logFile.error();
+        return 1;
+    }
+
+    QTextStream logStream(&logFile);
+
+    logStream << "Start der Berechnung " + Helpers::nowString() + "\r\n";
+
+    if (useModel) {
+
+        BlockModel blockModel(inputFileName);
+
+        if (! blockModel.open()) {
+            qDebug() << blockModel.getError();
+            return 2;
+        }
+
+        Calculation calculator(initValues, logStream);
+        calculator.setDiagnosticMode(diagnosticMode, maxExamples);
+        calculator.setPrecision(precision);
+
+        qDebug() << "Start the calculation (block model)";
+
+        if (! calculator.calcModel(blockModel, outputFileName)) {
+            qDebug() << "Error in calcModel(): " << calculator.getError();
+            return 1;
+        }
+
+        qDebug() << "End of calculation (Results are in " << outputFileName << ").";
+
+        return -1;
+    }
+
+    // Create calculator object
+    Calculation calculator(dbReader, initValues, logStream);
+    calculator.setDiagnosticMode(diagnosticMode, maxExamples);
+    calculator.setPrecision(precision);
+
+    if (!filter.isEmpty()) {
+        calculator.setFilter(&filter);
+    }
+
+    ResultCache resultCache(
+        parser.value("result-cache"), parser.value("result-cache-size").toUInt()
+    );
+
+    if (parser.isSet("result-cache")) {
+
+        if (! resultCache.open()) {
+            qDebug() << "Error: " << resultCache.getError();
+            return 1;
+        }
+
+        calculator.setResultCache(&resultCache);
+    }
+
+    if (compile) {
+
+        qDebug() << "Compile the block model";
+
+        if (! calculator.compile(outputFileName, debug)) {
+            qDebug() << "Error in compile(): " << calculator.getError();
+            return 1;
+        }
+
+        qDebug() << "Block model written to " << outputFileName << ".";
+
+        return -1;
+    }
+
+    if (parser.isSet("delta") || parser.isSet("config-diff")) {
+
+        DbaseReader previousReader(
+            parser.isSet("previous") ? parser.value("previous") : outputFileName
+        );
+
+        if (! previousReader.read()) {
+            qDebug() << previousReader.getError();
+            return 2;
+        }
+
+        if (parser.isSet("delta")) {
+
+            DbaseReader deltaReader(parser.value("delta"));
+
+            if (! deltaReader.checkAndRead()) {
+                qDebug() << deltaReader.getFullError();
+                return 2;
+            }
+
+            qDebug() << "Start the calculation (delta)";
+
+            if (! calculator.calcDelta(deltaReader, previousReader, outputFileName, debug)) {
+                qDebug() << "Error in calcDelta(): " << calculator.getError();
+                return 1;
+            }
+        }
+        else {
+
+            InitValues previousValues;
+            errorMessage = InitValues::updateFromConfig(previousValues, parser.value("config-diff"));
+
+            if (errorMessage.length() > 0) {
+                qDebug() << "Error: " << errorMessage;
+            }
+
+            qDebug() << "Start the calculation (changed configuration)";
+
+            if (! calculator.calcConfigChange(previousValues, previousReader, outputFileName, debug)) {
+                qDebug() << "Error in calcConfigChange(): " << calculator.getError();
+                return 1;
+            }
+        }
+
+        qDebug() << "End of calculation (Results are in " << outputFileName << ").";
+
+        return -1;
+    }
+
+    calculator.setDeduplicate(parser.isSet("dedup"));
+    calculator.setWarmStart(parser.isSet("warm-start"));
+
+    qDebug() << "Start the calculation";
+
+    if (series) {
+
+        QString mode = parser.value("series");
+
+        if (mode != "years" && mode != "stats") {
+            qDebug() << "Unknown series mode (expected 'years' or 'stats'): " << mode;
+            return 1;
+        }
+
+        if (!calculator.calcSeries(
+            outputFileName,
+            (mode == "years") ? SeriesOutput::years : SeriesOutput::statistics,
+            debug
+        )) {
+            qDebug() << "Error in calcSeries(): " << calculator.getError();
+            return 1;
+        }
+    }
+    else if (!calculator.calc(outputFileName, debug)) {
+        qDebug() << "Error in calc(): " << calculator.getError();
+        return 1;
+    }
+
+    qDebug() << "End of calculation (Results are in " << outputFileName << ").";
+
+    return -1;
+}
+
+QTextStream& qStdOut()
+{
+    static QTextStream ts( stdout );
+    return ts;
+}
+
+void writeBagrovTable(float bag_min, float bag_max, float bag_step,
+                      float x_min, float x_max, float x_step)
+{
+    qStdOut() << "# Writing a table of bagrov values to stdout...\n";
+    qStdOut() << "bag,x,y\n";
+
+    Bagrov bagrov;
+
+    float y = 0.0;
+    float bag = bag_min;
+
+    while(bag <= bag_max) {
+
+        float x = x_min;
+
+        while(x <= x_max) {
+            float xtmp = x;
+            y = bagrov.nbagro(bag, xtmp);
+            qStdOut() << bag << "," << x << "," << y << "\n";
+            x += x_step;
+        }
+
+        bag += bag_step;
+    }
+}
+
+bool parsePrecision(QString name, Precision &precision)
+{
+    if (name == "legacy") {
+        precision = Precision::legacyFloat;
+    }
+    else if (name == "double") {
+        precision = Precision::doublePrecision;
+    }
+    else if (name == "fast") {
+        precision = Precision::fastFloat;
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+// Calculate all blocks of the source with each arithmetic (see precision.h)
+// and write the run time and the maximum differences to the results of the
+// reference arithmetic (legacy float) as CSV. changed_rows counts the blocks
+// with a different value of R, ROW, RI or VERDUNSTUN in the output (rounded
+// to the configured number of decimals).
+bool writePrecisionReport(DbaseReader &dbReader, InitValues &initValues)
+{
+    const Precision precisions[] = {
+        Precision::legacyFloat, Precision::doublePrecision, Precision::fastFloat
+    };
+    const char *names[] = {"legacy", "double", "fast"};
+
+    RecordStore records;
+    abimoRecord record;
+
+    for (int k = 0; k < dbReader.getNumberOfRecords(); k++) {
+
+        dbReader.fillRecord(k, record);
+
+        if (record.NUTZUNG != 0) {
+            records.append(record);
+        }
+    }
+
+    QVector<BlockResult> reference;
+
+    qStdOut() << "precision,seconds,blocks,max_diff_r,max_diff_row,max_diff_ri,"
+        "max_diff_verdunstung,changed_rows\n";
+
+    for (int p = 0; p < 3; p++) {
+
+        // messages are only counted
+        QString protocol;
+        QTextStream protocolStream(&protocol);
+
+        Calculation calculation(initValues, protocolStream);
+        calculation.setDiagnosticMode(DiagnosticMode::aggregated, 0);
+        calculation.setPrecision(precisions[p]);
+
+        QVector<BlockResult> results(records.size());
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int i = 0; i < records.size(); i++) {
+            records.get(i, record);
+
+            if (!calculation.calcRecord(record, results[i])) {
+                qDebug() << "Error: " << calculation.getError();
+                return false;
+            }
+        }
+
+        double seconds = timer.nsecsElapsed() / 1.0e9;
+
+        if (precisions[p] == Precision::legacyFloat) {
+            reference = results;
+        }
+
+        float maxDiff[4] = {0.0F, 0.0F, 0.0F, 0.0F};
+        int changedRows = 0;
+
+        for (int i = 0; i < results.size(); i++) {
+
+            const BlockResult &a = results.at(i);
+            const BlockResult &b = reference.at(i);
+
+            maxDiff[0] = qMax(maxDiff[0], qAbs(a.r - b.r));
+            maxDiff[1] = qMax(maxDiff[1], qAbs(a.row - b.row));
+            maxDiff[2] = qMax(maxDiff[2], qAbs(a.ri - b.ri));
+            maxDiff[3] = qMax(maxDiff[3], qAbs(a.verdunst - b.verdunst));
+
+            if (
+                QString::number(a.r, 'f', initValues.getDecR()) !=
+                    QString::number(b.r, 'f', initValues.getDecR()) ||
+                QString::number(a.row, 'f', initValues.getDecROW()) !=
+                    QString::number(b.row, 'f', initValues.getDecROW()) ||
+                QString::number(a.ri, 'f', initValues.getDecRI()) !=
+                    QString::number(b.ri, 'f', initValues.getDecRI()) ||
+                QString::number(a.verdunst, 'f', initValues.getDecVERDUNSTUNG()) !=
+                    QString::number(b.verdunst, 'f', initValues.getDecVERDUNSTUNG())
+            ) {
+                changedRows++;
+            }
+        }
+
+        qStdOut() << names[p] << "," << seconds << "," << results.size() << "," <<
+            maxDiff[0] << "," << maxDiff[1] << "," << maxDiff[2] << "," <<
+            maxDiff[3] << "," << changedRows << "\n";
+    }
+
+    return true;
+}
+
+// Write the records of a dbf file with the given codes (see --lookup) as CSV,
+// in the order of the codes. Codes without record are reported.
+bool writeLookup(QString fileName, QString codes)
+{
+    QVector<QByteArray> wanted;
+    QString error;
+
+    if (!RecordFilter::readCodes(codes, wanted, error)) {
+        qDebug() << "Error: " << error;
+        return false;
+    }
+
+    DbaseReader reader(fileName);
+    QVector<int> numbers;
+
+    if (!reader.readRecordsByCode(wanted, numbers)) {
+        qDebug() << "Error: " << reader.getError();
+        return false;
+    }
+
+    QStringList names = reader.getFieldNames();
+
+    qStdOut() << "record," << names.join(",") << "\n";
+
+    int k = 0;
+
+    for (int i = 0; i < wanted.size(); i++) {
+
+        if (numbers.at(i) < 0) {
+            qDebug() << "Code not found: " << QString::fromUtf8(wanted.at(i));
+            continue;
+        }
+
+        qStdOut() << numbers.at(i);
+
+        for (int field = 0; field < names.size(); field++) {
+            qStdOut() << "," << Helpers::csvField(reader.getRecord(k, field));
+        }
+
+        qStdOut() << "\n";
+        k++;
+    }
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QString>
+#include <QTextStream>
+
+#include "dbaseReader.h"
+#include "initvalues.h"
+#include "precision.h"
+
+// Command line interface shared by the GUI program and the command line
+// program abimo-cli (see src/cli)
+
+// Server modes --serve and --http. The servers need QtNetwork and are in a
+// library of their own (see src/server), a program linking it passes them
+// to main_batch() (see src/cli/main.cpp).
+struct ServerModes {
+    int (*serveJobs)(QCoreApplication &app, QString name);
+    int (*serveWhatIf)(
+        QCoreApplication &app, DbaseReader &dbReader, InitValues &initValues, quint16 port
+    );
+};
+
+void defineParser(QCommandLineParser* parser);
+int main_batch(int argc, char *argv[], const ServerModes *servers = 0);
+QTextStream& qStdOut();
+bool parsePrecision(QString name, Precision &precision);
+bool writePrecisionReport(DbaseReader &dbReader, InitValues &initValues);
+bool writeLookup(QString fileName, QString codes);
+
+void writeBagrovTable(
+    float bag_min = 0.1F,
+    float bag_max = 10.0F,
+    float bag_step = 0.1F,
+    float x_min = 0.1F,
+    float x_max = 15.1F,
+    float x_step = 0.1F
+);
+
+#endif // BATCH_H
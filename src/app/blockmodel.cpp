@@ -0,0 +1,169 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <string.h> // for memcpy(), strncmp()
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+
+#include "blockmodel.h"
+
+BlockModel::BlockModel(const QString &fileName):
+    file(fileName),
+    data(0),
+    header(0),
+    entries(0),
+    codes(0)
+{}
+
+BlockModel::~BlockModel()
+{
+    close();
+}
+
+QString BlockModel::getError()
+{
+    return error;
+}
+
+bool BlockModel::open()
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = "Kann die Datei nicht oeffnen\n" + file.errorString();
+        return false;
+    }
+
+    qint64 size = file.size();
+
+    if (size < (qint64) sizeof(BlockModelHeader)) {
+        error = "Datei unbekannten Formats.";
+        file.close();
+        return false;
+    }
+
+    data = file.map(0, size);
+
+    if (data == 0) {
+        error = "Kann die Datei nicht in den Speicher abbilden\n" + file.errorString();
+        file.close();
+        return false;
+    }
+
+    header = reinterpret_cast<const BlockModelHeader*>(data);
+
+    if (strncmp(header->magic, BLOCKMODEL_MAGIC, sizeof(header->magic)) != 0) {
+        error = "Datei ist kein kompiliertes Blockmodell.";
+        close();
+        return false;
+    }
+
+    if (
+        header->version != BLOCKMODEL_VERSION ||
+        header->entrySize != sizeof(BlockModelEntry)
+    ) {
+        error = "Blockmodell wurde mit einer anderen Programmversion erstellt.";
+        close();
+        return false;
+    }
+
+    qint64 expectedSize = sizeof(BlockModelHeader) +
+        (qint64) header->numberOfBlocks * sizeof(BlockModelEntry) +
+        (qint64) header->codeAreaSize;
+
+    if (size != expectedSize) {
+        error = "Blockmodell unbekannten Formats, falsche Groesse.";
+        close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const BlockModelEntry*>(data + sizeof(BlockModelHeader));
+    codes = reinterpret_cast<const char*>(entries + header->numberOfBlocks);
+
+    return true;
+}
+
+void BlockModel::close()
+{
+    if (data != 0) {
+        file.unmap(data);
+        data = 0;
+    }
+
+    header = 0;
+    entries = 0;
+    codes = 0;
+
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+int BlockModel::getNumberOfBlocks()
+{
+    return (header == 0) ? 0 : (int) header->numberOfBlocks;
+}
+
+const BlockModelHeader& BlockModel::getHeader()
+{
+    return *header;
+}
+
+const BlockModelEntry& BlockModel::getEntry(int i)
+{
+    return entries[i];
+}
+
+// The bytes of the CODE field as DbaseReader decodes them (UTF-8)
+QString BlockModel::getCode(int i)
+{
+    return QString::fromUtf8(codes + entries[i].codeOffset, entries[i].codeLength);
+}
+
+bool BlockModel::write(
+    const QString &fileName,
+    BlockModelHeader header,
+    const QVector<BlockModelEntry> &entries,
+    const QByteArray &codes,
+    QString &error
+)
+{
+    memcpy(header.magic, BLOCKMODEL_MAGIC, sizeof(header.magic));
+    header.version = BLOCKMODEL_VERSION;
+    header.entrySize = sizeof(BlockModelEntry);
+    header.numberOfBlocks = entries.size();
+    header.codeAreaSize = codes.size();
+
+    QFile out(fileName);
+
+    if (!out.open(QIODevice::WriteOnly)) {
+        error = "kann Out-Datei: '" + fileName + "' nicht oeffnen\n Grund: " +
+            out.errorString();
+        return false;
+    }
+
+    qint64 entriesSize = (qint64) entries.size() * sizeof(BlockModelEntry);
+
+    bool written =
+        out.write(reinterpret_cast<const char*>(&header), sizeof(BlockModelHeader)) ==
+            (qint64) sizeof(BlockModelHeader) &&
+        out.write(reinterpret_cast<const char*>(entries.constData()), entriesSize) ==
+            entriesSize &&
+        out.write(codes) == codes.size() &&
+        out.flush();
+
+    out.close();
+
+    // an incomplete model must not be evaluated later
+    if (!written) {
+        error = "Fehler beim Schreiben in: '" + fileName + "'\n Grund: " + out.errorString();
+        out.remove();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef BLOCKMODEL_H
+#define BLOCKMODEL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "calculation.h"
+
+// A compiled block model file contains the climate independent state of all
+// block partial areas of an input file (see Calculation::compile()). It
+// consists of a BlockModelHeader, numberOfBlocks BlockModelEntry structures
+// and an area with the CODE strings (the trimmed bytes of the input file, see
+// DbaseReader::getCodes()). All numbers are stored in the byte order of the
+// machine that compiled the model. The file is memory mapped when it is
+// evaluated, no parsing is required.
+
+#define BLOCKMODEL_MAGIC "ABIMOBM"
+#define BLOCKMODEL_VERSION 2
+
+struct BlockModelHeader {
+    char magic[8];
+    quint32 version;
+
+    // size of one BlockModelEntry, changes if the layout changes
+    quint32 entrySize;
+
+    // number of blocks (records with NUTZUNG != 0)
+    quint32 numberOfBlocks;
+
+    // number of records in the input file (including NUTZUNG == 0)
+    quint32 numberOfRecords;
+
+    // number of records with NUTZUNG == 0 and without area
+    quint32 nutzungIstNull;
+    quint32 keineFlaechenAngegeben;
+
+    // size of the area holding the CODE strings
+    quint64 codeAreaSize;
+};
+
+struct BlockModelEntry {
+    BlockState state;
+    qint32 BEZIRK;
+    qint32 REGENJA;
+    qint32 REGENSO;
+
+    // position of CODE within the code area
+    quint32 codeOffset;
+    quint32 codeLength;
+};
+
+class BlockModel
+{
+
+public:
+    BlockModel(const QString &fileName);
+    ~BlockModel();
+    bool open();
+    void close();
+    QString getError();
+    int getNumberOfBlocks();
+    const BlockModelHeader& getHeader();
+    const BlockModelEntry& getEntry(int i);
+    QString getCode(int i);
+    static bool write(
+        const QString &fileName,
+        BlockModelHeader header,
+        const QVector<BlockModelEntry> &entries,
+        const QByteArray &codes,
+        QString &error
+    );
+
+private:
+    QFile file;
+    QString error;
+    uchar* data;
+    const BlockModelHeader* header;
+    const BlockModelEntry* entries;
+    const char* codes;
+};
+
+#endif // BLOCKMODEL_H
@@ -3,39 +3,56 @@
  * of this repository (https://github.com/KWB-R/abimo).
  ***************************************************************************/
 
+#include <algorithm> // for std::sort()
 #include <math.h>
+#include <string.h> // for memcpy(), memset()
+#include <QByteArray>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QTextStream>
+#include <QVector>
 
 #include "bagrov.h"
+#include "blockmodel.h"
 #include "calculation.h"
+#include "codeindex.h"
 #include "config.h"
+#include "configdiff.h"
 #include "constants.h"
 #include "dbaseReader.h"
 #include "dbaseWriter.h"
+#include "diagnosticsink.h"
 #include "effectivenessunsealed.h"
 #include "helpers.h"
 #include "initvalues.h"
+#include "lookuptable.h"
 #include "pdr.h"
+#include "recordfilter.h"
+#include "resultcache.h"
 
-// potential ascent rate TAS (column labels for matrix 'Calculation::ijkr_S')
-const float Calculation::iTAS[] = {
+// potential ascent rate TAS (column labels for matrix 'ijkr_S')
+static constexpr LookupAxis<15> iTAS(0.0001F,
     0.1F, 0.2F, 0.3F, 0.4F, 0.5F, 0.6F, 0.7F, 0.8F,
     0.9F, 1.0F, 1.2F, 1.4F, 1.7F, 2.0F, 2.3F
-};
+);
 
 // soil type unknown - default soil type used in the following: sand
 
-// Usable field capacity nFK (row labels for matrix 'Calculation::ijkr_S')
-const float Calculation::inFK_S[] = {
+// Usable field capacity nFK (row labels for matrix 'ijkr_S')
+static constexpr LookupAxis<7> inFK_S(0.0001F,
     8.0F, 9.0F, 14.0F, 14.5F, 15.5F, 17.0F, 20.5F
-};
+);
 
 /* Mean potential capillary rise rate kr [mm/d] of a summer season depending on:
  * potential ascent rate TAS (one column each) and
  * usable field capacity nFK (one row each) */
-const float Calculation::ijkr_S[] = {
+static constexpr LookupMatrix<7, 15> ijkr_S(
     7.0F, 6.0F, 5.0F, 1.5F, 0.5F, 0.2F, 0.1F, 0.0F, 0.0F, 0.0F,  0.0F , 0.0F, 0.0F , 0.0F, 0.0F,
     7.0F, 7.0F, 6.0F, 5.0F, 3.0F, 1.2F, 0.5F, 0.2F, 0.1F, 0.0F,  0.0F , 0.0F, 0.0F , 0.0F, 0.0F,
     7.0F, 7.0F, 6.0F, 6.0F, 5.0F, 3.0F, 1.5F, 0.7F, 0.3F, 0.15F, 0.1F , 0.0F, 0.0F , 0.0F, 0.0F,
@@ -43,35 +60,220 @@ const float Calculation::ijkr_S[] = {
     7.0F, 7.0F, 6.0F, 6.0F, 5.0F, 4.5F, 2.5F, 1.5F, 0.7F, 0.4F,  0.15F, 0.1F, 0.0F , 0.0F, 0.0F,
     7.0F, 7.0F, 6.0F, 6.0F, 5.0F, 5.0F, 3.5F, 2.0F, 1.5F, 0.8F,  0.3F , 0.1F, 0.05F, 0.0F, 0.0F,
     7.0F, 7.0F, 6.0F, 6.0F, 6.0F, 5.0F, 5.0F, 5.0F, 3.0F, 2.0F,  1.0F , 0.5F, 0.15F, 0.0F, 0.0F
-};
+);
+
+// Factor for the effectiveness parameter depending on the ratio of summer
+// precipitation (plus irrigation and capillary rise) to summer evaporation
+static constexpr LookupSteps<14> summerFactor(
+    LookupAxis<14>(0.0F,
+        0.45F, 0.50F, 0.55F, 0.60F, 0.65F, 0.70F, 0.75F, // 0 ..  6
+        0.80F, 0.85F, 0.90F, 0.95F, 1.00F, 1.05F, 1.10F  // 7 .. 13
+    ),
+    LookupTable<14>(
+        0.65F, 0.75F, 0.82F, 0.90F, 1.00F, 1.06F, 1.15F, // 0 ..  6
+        1.22F, 1.30F, 1.38F, 1.47F, 1.55F, 1.63F, 1.70F  // 7 .. 13
+    )
+);
 
 Calculation::Calculation(DbaseReader& dbR, InitValues & init, QTextStream & protoStream):
     initValues(init),
     protokollStream(protoStream),
-    dbReader(dbR),
-    regenja(0),
-    regenso(0),
-    RDV(0),
-    R1V(0),
-    R2V(0),
-    R3V(0),
-    R4V(0),
-    RUV(0),
-    ROWVOL(0),
-    RIVOL(0),
-    RVOL(0),
+    diagnostics(protoStream),
+    dbReader(&dbR),
+    TAS(0),
+    counters({0, 0, 0, 0L, 0L, 0L}),
+    weiter(1),
+    deduplicate(false),
+    warmStart(false),
+    precision(Precision::legacyFloat),
+    resultCache(0),
+    filter(0),
+    notSelected(0L)
+{
+    initSealedCurves();
+    initDistrictValues();
+}
+
+// Calculation without input file, e.g. for evaluating a compiled block model
+Calculation::Calculation(InitValues & init, QTextStream & protoStream):
+    initValues(init),
+    protokollStream(protoStream),
+    diagnostics(protoStream),
+    dbReader(0),
     TAS(0),
-    lenTAS(15),
-    lenS(7),
     counters({0, 0, 0, 0L, 0L, 0L}),
-    weiter(true)
+    weiter(1),
+    deduplicate(false),
+    warmStart(false),
+    precision(Precision::legacyFloat),
+    resultCache(0),
+    filter(0),
+    notSelected(0L)
 {
-    config = new Config();
+    initSealedCurves();
+    initDistrictValues();
 }
 
+// The Bagrov parameters of the roof and pavement classes are constant for a
+// run (see evaluateBlock())
+void Calculation::initSealedCurves()
+{
+    sealedCurves[0] = BagrovCurve(bagrov, initValues.getBagdach());
+    sealedCurves[1] = BagrovCurve(bagrov, initValues.getBagbel1());
+    sealedCurves[2] = BagrovCurve(bagrov, initValues.getBagbel2());
+    sealedCurves[3] = BagrovCurve(bagrov, initValues.getBagbel3());
+    sealedCurves[4] = BagrovCurve(bagrov, initValues.getBagbel4());
+}
+
+// May be called from any thread, e.g. from the GUI while calc() is running
+// in a worker thread
 void Calculation::stop()
 {
-    weiter = false;
+    weiter.storeRelease(0);
+}
+
+// Calculate blocks with identical parameters only once (see calcDeduplicated())
+void Calculation::setDeduplicate(bool value)
+{
+    deduplicate = value;
+}
+
+// Solve the Bagrov relation of the unsealed surfaces with warm starts, the
+// blocks are calculated sorted by their effectiveness parameter and x (see
+// Bagrov::setWarmStart()). The results differ slightly from calc().
+void Calculation::setWarmStart(bool value)
+{
+    warmStart = value;
+    unsealedBagrov.setWarmStart(value);
+}
+
+// Arithmetic of the calculation (see precision.h)
+void Calculation::setPrecision(Precision value)
+{
+    precision = value;
+    bagrov.setPrecision(value);
+    unsealedBagrov.setPrecision(value);
+
+    // the coefficients of the curves are calculated with the new precision
+    initSealedCurves();
+}
+
+// Write one message per block (full) or counts and examples (aggregated)
+void Calculation::setDiagnosticMode(DiagnosticMode mode, int maxExamples)
+{
+    diagnostics.setMode(mode, maxExamples);
+}
+
+// Look up and store the results of calc() and calcRecord() in an opened
+// cache (the cache is not owned by the calculation). It is not used with the
+// warm start, its results differ slightly from the cached ones.
+void Calculation::setResultCache(ResultCache *cache)
+{
+    resultCache = cache;
+}
+
+// Calculate only the records selected by the filter (the filter is not owned
+// by the calculation, 0: all records). Used by calc(), compile() and
+// calcSeries().
+void Calculation::setFilter(const RecordFilter *value)
+{
+    filter = value;
+}
+
+// Record k of dbReader is calculated: it is selected by the filter and its
+// NUTZUNG is not 0 (counted in nutzungIstNull). Both are checked on the
+// bytes of these fields before the record is read by fillRecord().
+bool Calculation::isSelected(int k)
+{
+    if (filter != 0 && !filter->matches(*dbReader, k)) {
+        notSelected++;
+        return false;
+    }
+
+    if (dbReader->getInt(k, AbimoField::NUTZUNG) == 0) {
+        counters.nutzungIstNull++;
+        return false;
+    }
+
+    return true;
+}
+
+// Write the result file. The result file is complete if only its code index
+// could not be written, this is noted in the protocol.
+bool Calculation::writeResults(DbaseWriter &writer)
+{
+    if (!writer.write()) {
+        protokollStream << "Error: "+ writer.getError() +"\r\n";
+        error = "Fehler beim Schreiben der Ergebnisse.\n" + writer.getError();
+        return false;
+    }
+
+    if (!writer.getIndexError().isEmpty()) {
+        protokollStream << "\r\nCODE-Index nicht geschrieben (wird bei Bedarf erstellt): " <<
+            writer.getIndexError() << "\r\n";
+    }
+
+    return true;
+}
+
+// Write the pending diagnostic messages. Must be called before anything else
+// is written to protokollStream.
+void Calculation::finishProtocol()
+{
+    diagnostics.flush();
+    diagnostics.writeSummary();
+
+    if (filter != 0) {
+        protokollStream << "\r\nAuswahl (--where): " <<
+            counters.totalRecRead - notSelected << " von " <<
+            counters.totalRecRead << " Records\r\n";
+    }
+
+    if (resultCache != 0 && resultCache->getLookups() > 0) {
+        protokollStream << "\r\nErgebniscache: " << resultCache->getHits() <<
+            " Treffer bei " << resultCache->getLookups() << " Bloecken (" <<
+            QString::number(
+                100.0 * resultCache->getHits() / resultCache->getLookups(), 'f', 1
+            ) << " %)\r\n";
+    }
+
+    // sealed and unsealed surfaces
+    BagrovStatistics statistics = bagrov.getStatistics();
+    const BagrovStatistics &unsealed = unsealedBagrov.getStatistics();
+
+    for (int i = 0; i < BAGROV_REGIMES; i++) {
+        statistics.calls[i] += unsealed.calls[i];
+        statistics.iterations[i] += unsealed.iterations[i];
+        statistics.notConverged[i] += unsealed.notConverged[i];
+    }
+
+    statistics.integrations += unsealed.integrations;
+    statistics.warmStarts += unsealed.warmStarts;
+
+    protokollStream << "\r\nBagrov-Verfahren (Aufrufe / Iterationen / nicht konvergiert):\r\n" <<
+        "Reihenentwicklung (bag < 0.7): " << statistics.calls[seriesExpansion] << " / " <<
+        statistics.iterations[seriesExpansion] << " / " <<
+        statistics.notConverged[seriesExpansion] << "\r\n" <<
+        "geschlossene Naeherung (0.7 <= bag <= 3.8): " << statistics.calls[closedForm] << "\r\n" <<
+        "Newton-Verfahren (bag > 3.8): " << statistics.calls[newton] << " / " <<
+        statistics.iterations[newton] << " / " << statistics.notConverged[newton] << "\r\n" <<
+        "numerische Integration: " << statistics.integrations << "\r\n";
+
+    if (warmStart) {
+        protokollStream << "Warmstarts: " << statistics.warmStarts << "\r\n";
+    }
+}
+
+// Progress is signalled per record only if PROGRESS_INTERVAL ms have passed
+// since the last signal. Signals are delivered (queued) to the GUI thread.
+bool Calculation::progressDue()
+{
+    if (progressTimer.isValid() && !progressTimer.hasExpired(PROGRESS_INTERVAL)) {
+        return false;
+    }
+
+    progressTimer.start();
+    return true;
 }
 
 Counters Calculation::getCounters()
@@ -91,488 +293,1821 @@ QString Calculation::getError()
 // =============================================================================
 bool Calculation::calc(QString fileOut, bool debug)
 {
+    // the warm start needs all blocks before the calculation to sort them
+    if (deduplicate || warmStart) {
+        return calcDeduplicated(fileOut, debug);
+    }
+
     // Current Abimo record (represents one row of the input dbf file)
     abimoRecord record;
 
+    // Inputs of evaluateBlock() and codes (record numbers in the CODE arena
+    // of dbReader) of the records of the current batch
+    BlockState state;
+    BlockClimate climate;
+    QVector<BlockState> states;
+    QVector<BlockClimate> climates;
+    QVector<int> codes;
+
     // variables for calculation
     int index = 0;
-    
-    // Versiegelungsgrad Dachflaechen / sonst. versiegelte Flaechen / Strassen
-    // vegree of sealing of roof surfaces / other sealed surfaces / roads
-    float vgd, vgb, vgs;
-
-    // Kanalisierungsgrad Dachflaechen / sonst. versiegelte Flaechen / Strassen
-    // degree of canalization for roof surfaces / other sealed surfaces / roads
-    float kd, kb, ks;
-    
-    // Anteil der jeweiligen Belagsklasse
-    // share of respective pavement class
-    float bl1, bl2, bl3, bl4;
-
-    // Anteil der jeweiligen Strassenbelagsklasse
-    // share of respective road pavement class
-    float bls1, bls2, bls3, bls4;
-
-    // Gesamtflaeche Bebauung / Strasse
-    // total area of building development / road
-    float fb, fs;
-
-    // Verhaeltnis Bebauungsflaeche / Strassenflaeche zu Gesamtflaeche (ant = Anteil)
-    // share of building development area / road area to total area
-    float fbant, fsant;
-    
-    // Abflussvariablen der versiegelten Flaechen
-    // runoff variables of sealed surfaces
-    float row1, row2, row3, row4;
-    
-    // Infiltrationsvariablen der versiegelten Flaechen
-    // infiltration variables of sealed surfaces
-    float ri1, ri2, ri3, ri4;
-    
-    // Abfluss- / Infiltrationsvariablen der Dachflaechen
-    // runoff- / infiltration variables of roof surfaces
-    float rowd, rid;
-    
-    // Abfluss- / Infiltrationsvariablen unversiegelter Strassenflaechen
-    // runoff- / infiltration variables of unsealed road surfaces
-    float rowuvs, riuvs;
-    
-    // Infiltration unversiegelter Flaechen
-    // infiltratio of unsealed areas
-    float riuv;
-    
-    // float-Zwischenwerte
-    // float interm values
-    float r, ri, row;
     int k;
 
-    // count protocol entries
-    counters.protcount = 0L;
-    counters.keineFlaechenAngegeben = 0L;
-    counters.nutzungIstNull = 0L;
+    if (dbReader == 0) {
+        error = "Keine Eingabedatei angegeben.";
+        return false;
+    }
+
+    startRun();
 
     // first entry into protocol
     DbaseWriter writer(fileOut, initValues);
 
     // get the number of rows in the input data ?
-    counters.totalRecRead = dbReader.getNumberOfRecords();
+    counters.totalRecRead = dbReader->getNumberOfRecords();
+
+    int batchSize = qMin(counters.totalRecRead, CALCULATION_BATCH_SIZE);
+
+    states.reserve(batchSize);
+    climates.reserve(batchSize);
+    codes.reserve(batchSize);
+    writer.reserve(counters.totalRecRead);
 
-    // loop over all block partial areas (records) of input data
+    // loop over all block partial areas (records) of input data: usage, soil
+    // and sealing dependent part of the calculation (see calcRecord())
     for (k = 0; k < counters.totalRecRead; k++) {
 
-        if (! weiter) {
+        if (! weiter.loadAcquire()) {
+            finishProtocol();
             protokollStream << "Berechnungen abgebrochen.\r\n";
             return true;
         }
 
         ptrDA.wIndex = index;
 
-        // Fill record with data from row k
-        dbReader.fillRecord(k, record, debug);
+        // NUTZUNG = integer representing the type of area usage for each
+        // block partial area. Records with NUTZUNG = 0 and records not
+        // selected by the filter are not read (see isSelected()).
+        if (isSelected(k)) {
 
-        // NUTZUNG = integer representing the type of area usage for each block partial area
-        if (record.NUTZUNG != 0) {
+            // Fill record with data from row k
+            dbReader->fillRecord(k, record, debug);
 
             // CODE: unique identifier for each block partial area
 
-            // precipitation for entire year 'regenja' and for only summer season 'regenso'
-            regenja = record.REGENJA; /* Jetzt regenja,-so OK */
-            regenso = record.REGENSO;
-
-            // depth to groundwater table 'FLUR'
-            ptrDA.FLW = record.FLUR;
-
-            getNUTZ(
-                record.NUTZUNG,
-                record.TYP,      // structure type
-                record.FELD_30,  // field capacity [%] for 0- 30cm below ground level
-                record.FELD_150, // field capacity [%] for 0-150cm below ground level
-                record.CODE
-            );
-
-            /* cls_6a: an dieser Stelle muss garantiert werden, dass f30 und f150
-               als Parameter von getNUTZ einen definierten Wert erhalten und zwar 0.
-
-               FIXED: alle Werte sind definiert... wenn keine 0, sondern nichts bzw. Leerzeichen
-               angegeben wurden, wird nun eine 0 eingesetzt
-               aber eigentlich war das auch schon so ... ???
-            */
-
-            // Bagrov-calculation for sealed surfaces
-            getKLIMA(record.BEZIRK, record.CODE);
-
-            // share of roof area [%] 'PROBAU'
-            vgd = record.PROBAU_fraction;
-          
-            // share of other sealed areas (e.g. Hofflaechen) and calculate total sealed area
-            vgb = record.PROVGU_fraction;
-            ptrDA.VER = INT_ROUND(vgd * 100 + vgb * 100);
-            
-            // share of sealed road area
-            vgs = record.VGSTRASSE_fraction;
-          
-            // degree of canalization for roof / other sealed areas / sealed roads
-            kd = record.KAN_BEB_fraction;
-            kb = record.KAN_VGU_fraction;
-            ks = record.KAN_STR_fraction;
-          
-            // share of each pavement class for surfaces except roads of block area
-            bl1 = record.BELAG1_fraction;
-            bl2 = record.BELAG2_fraction;
-            bl3 = record.BELAG3_fraction;
-            bl4 = record.BELAG4_fraction;
-          
-            // share of each pavement class for roads of block area
-            bls1 = record.STR_BELAG1_fraction;
-            bls2 = record.STR_BELAG2_fraction;
-            bls3 = record.STR_BELAG3_fraction;
-            bls4 = record.STR_BELAG4_fraction;
-          
-            fb = record.FLGES;
-            fs = record.STR_FLGES;
-            
-            // if sum of total building development area and roads area is inconsiderably small
-            // it is assumed, that the area is unknown and 100 % building development area will be given by default
-            if (fb + fs < 0.0001)
-            {
-                //*protokollStream << "\r\nDie Flaeche des Elements " + record.CODE + " ist 0 \r\nund wird automatisch auf 100 gesetzt\r\n";
-                counters.protcount++;
-                counters.keineFlaechenAngegeben++;
-                fb = 100.0F;
+            if (!fillBlockState(record, state)) {
+                return false;
             }
+            applyBERtoZero(state);
 
-            // fbant = Verhaeltnis Bebauungsflaeche zu Gesamtflaeche
-            // fbant = ratio of building development area to total area
-            fbant = fb / (fb + fs);
-            
-            // fsant = Verhaeltnis Strassenflaeche zu Gesamtflaeche
-            // fsant = ratio of roads area to total area
-            fsant = fs / (fb + fs);
-
-            // Runoff for sealed surfaces
-            /* cls_1: Fehler a:
-               rowd = (1.0F - initValues.getInfdach()) * vgd * kb * fbant * RDV;
-               richtige Zeile folgt (kb ----> kd)
-            */
-            
-            /*  Legende der Abflussberechnung der 4 Belagsklassen bzw. Dachklasse:
-                rowd / rowx: Abfluss Dachflaeche / Abfluss Belagsflaeche x
-                infdach / infbelx: Infiltrationsparameter Dachfl. / Belagsfl. x
-                belx: Anteil Belagsklasse x
-                blsx: Anteil Strassenbelagsklasse x
-                vgd / vgb: Anteil versiegelte Dachfl. / sonstige versiegelte Flaeche zu Gesamtblockteilflaeche
-                kd / kb / ks: Grad der Kanalisierung Dach / sonst. vers. Fl. / Strassenflaechen
-                fbant / fsant: ?
-                RDV / RxV: Gesamtabfluss versiegelte Flaeche
-            */
-            rowd = (1.0F - initValues.getInfdach()) * vgd * kd * fbant * RDV;
-            row1 = (1.0F - initValues.getInfbel1()) * (bl1 * kb * vgb * fbant + bls1 * ks * vgs * fsant) * R1V;
-            row2 = (1.0F - initValues.getInfbel2()) * (bl2 * kb * vgb * fbant + bls2 * ks * vgs * fsant) * R2V;
-            row3 = (1.0F - initValues.getInfbel3()) * (bl3 * kb * vgb * fbant + bls3 * ks * vgs * fsant) * R3V;
-            row4 = (1.0F - initValues.getInfbel4()) * (bl4 * kb * vgb * fbant + bls4 * ks * vgs * fsant) * R4V;
-
-            // Infiltration for sealed surfaces
-            rid = (1 - kd) * vgd * fbant * RDV;
-            ri1 = (bl1 * vgb * fbant + bls1 * vgs * fsant) * R1V - row1;
-            ri2 = (bl2 * vgb * fbant + bls2 * vgs * fsant) * R2V - row2;
-            ri3 = (bl3 * vgb * fbant + bls3 * vgs * fsant) * R3V - row3;
-            ri4 = (bl4 * vgb * fbant + bls4 * vgs * fsant) * R4V - row4;
-            
-            // consider unsealed road surfaces as pavement class 4
-            rowuvs = 0.0F;                   /* old: 0.11F * (1-vgs) * fsant * R4V; */
-            riuvs = (1 - vgs) * fsant * R4V; /* old: 0.89F * (1-vgs) * fsant * R4V; */
-
-            // runoff for unsealed surfaces rowuv = 0
-            riuv = (100.0F - (float) ptrDA.VER) / 100.0F * RUV;
-
-            // calculate runoff 'row' for entire block patial area (FLGES+STR_FLGES)
-            row = (row1 + row2 + row3 + row4 + rowd + rowuvs); // mm/a
-            ptrDA.ROW = INT_ROUND(row);
-            
-            // calculate volume 'rowvol' from runoff
-            ROWVOL = row * 3.171F * (fb + fs) / 100000.0F;     // qcm/s
-            
-            // calculate infiltration rate 'ri' for entire block partial area
-            ri = (ri1 + ri2 + ri3 + ri4 + rid + riuvs + riuv); // mm/a
-            ptrDA.RI = INT_ROUND(ri);
-            
-            // calculate volume 'rivol' from infiltration rate
-            RIVOL = ri * 3.171F * (fb + fs) / 100000.0F;       // qcm/s
-            
-            // calculate total system losses 'r' due to runoff and infiltration for entire block partial area
-            r = row + ri;
-            ptrDA.R = INT_ROUND(r);
-            
-            // calculate volume of system losses 'rvol'due to runoff and infiltration
-            RVOL = ROWVOL + RIVOL;
-
-            // calculate total area of building development area as well as roads area
-            float flaeche1 = fb + fs;
-// cls_5b:
-            // calculate evaporation 'verdunst' by subtracting the sum of
-            // runoff and infiltration 'r' from precipitation of entire year
-            // 'regenja' multiplied by correction factor 'niedKorrFaktor'
-            float verdunst = (regenja * initValues.getNiedKorrF()) - r;
-
-            // write the calculated variables into respective fields
-            writer.addRecord();
-            writer.setRecordField("CODE", record.CODE);
-            writer.setRecordField("R", r);
-            writer.setRecordField("ROW", row);
-            writer.setRecordField("RI", ri);
-            writer.setRecordField("RVOL", RVOL);
-            writer.setRecordField("ROWVOL", ROWVOL);
-            writer.setRecordField("RIVOL", RIVOL);
-            writer.setRecordField("FLAECHE", flaeche1);
-// cls_5c:
-            writer.setRecordField("VERDUNSTUN", verdunst);
+            climate.regenja = record.REGENJA;
+            climate.regenso = record.REGENSO;
+            getKLIMA(record.BEZIRK, record.CODE, state.usage, climate);
+
+            states.append(state);
+            climates.append(climate);
+            codes.append(k);
 
             index++;
-        }
-        else {
-            counters.nutzungIstNull++;
 
+            // Bagrov-calculation for sealed and unsealed surfaces and runoff
+            if (states.size() == CALCULATION_BATCH_SIZE) {
+                calcBatch(writer, states, climates, codes);
+            }
         }
 
         /* cls_2: Hier koennten falls gewuenscht die Flaechen dokumentiert werden,
            deren NUTZUNG=NULL (siehe auch cls_3)
         */
 
-        emit processSignal((int)((float) k / (float) counters.totalRecRead * 50.0), "Berechne");
+        if (progressDue()) {
+            emit processSignal((int)((float) k / (float) counters.totalRecRead * 40.0), "Berechne");
+        }
+    }
+
+    calcBatch(writer, states, climates, codes);
+
+    emit processSignal(45, "Berechne");
+
+    finishProtocol();
+
+    if (debug) {
+        writeMemoryStatistics(writer);
     }
 
     counters.totalRecWrite = index;
 
     emit processSignal(50, "Schreibe Ergebnisse.");
 
-    if (!writer.write()) {
-        protokollStream << "Error: "+ writer.getError() +"\r\n";
-        error = "Fehler beim Schreiben der Ergebnisse.\n" + writer.getError();
-        return false;
-    }
-
-    return true;
+    return writeResults(writer);
 }
 
 // =============================================================================
-// FIXME:
+// Bagrov-calculation of a batch of records of calc() and writing of their
+// results. The batch is emptied, its vectors keep their memory for the next
+// one.
 // =============================================================================
-void Calculation::getNUTZ(int nutz, int typ, int f30, int f150, QString code)
+void Calculation::calcBatch(
+    DbaseWriter &writer, QVector<BlockState> &states, QVector<BlockClimate> &climates,
+    QVector<int> &codes
+)
 {
-    // mittlere pot. kapillare Aufstiegsrate d. Sommerhalbjahres
-    float kr;
+    QVector<BlockResult> results(states.size());
 
-    /*
-     * Feldlaengen von iTAS und inFK_S, L, T, U ;
-     * extern int lenTAS, lenS, lenL, lenT, lenU;
-     */
+    if (usesResultCache()) {
+        for (int i = 0; i < states.size(); i++) {
+            evaluateCached(states[i], climates[i], results[i]);
+        }
+    }
+    else {
+        QVector<int> order(states.size());
 
-    // declaration of yield power (ERT) and irrigation (BER) for agricultural or gardening purposes
-    setUsageYieldIrrigation(nutz, typ, code);
+        for (int i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
 
-    if (ptrDA.NUT != Usage::waterbody_G)
-    {
-        /* pot. Aufstiegshoehe TAS = FLUR - mittl. Durchwurzelungstiefe TWS */
-        TAS = ptrDA.FLW - config->getTWS(ptrDA.ERT, ptrDA.NUT);
+        evaluateBlocks(states, climates, order, results);
+    }
 
-        /* Feldkapazitaet */
-        /* cls_6b: der Fall der mit NULL belegten FELD_30 und FELD_150 Werte
-           wird hier im erten Fall behandelt - ich erwarte dann den Wert 0 */
-        ptrDA.nFK = PDR::estimateWaterHoldingCapacity(f30, f150, ptrDA.NUT == Usage::forested_W);
+    // write the calculated variables into respective fields
+    for (int i = 0; i < results.size(); i++) {
+        writeResultRecord(writer, dbReader->getCodes(), codes.at(i), results[i]);
+    }
 
-        /*
-         * mittlere pot. kapillare Aufstiegsrate kr (mm/d) des Sommerhalbjahres ;
-         * switch (bod) { case S: case U: case L: case T: case LO: case HN: } wird
-         * eingefuegt, wenn die Bodenart in das Zahlenmaterial aufgenommen wird vorlaeufig
-         * wird Sande angenommen ;
-         * Sande
-         */
-        kr = (TAS <= 0.0) ?
-            7.0F :
-            ijkr_S[
-                Helpers::index(TAS, iTAS, lenTAS) +
-                Helpers::index(ptrDA.nFK, inFK_S, lenS) * lenTAS
-            ];
+    states.resize(0);
+    climates.resize(0);
+    codes.resize(0);
+}
 
-        /* mittlere pot. kapillare Aufstiegsrate kr (mm/d) des Sommerhalbjahres */
-        ptrDA.KR = (int) (PDR::estimateDaysOfGrowth(ptrDA.NUT, ptrDA.ERT) * kr);
+// =============================================================================
+// Calculate one record (with NUTZUNG != 0). This is the calculation that
+// calc() does for all records at once (see evaluateBlocks()), it is also used
+// by the C API (see abimoapi.h). Returns false (with error set) for an
+// unknown usage.
+// =============================================================================
+bool Calculation::calcRecord(abimoRecord &record, BlockResult &result)
+{
+    BlockState state;
+    BlockClimate climate;
+
+    // Usage, soil and sealing dependent part of the calculation
+    if (!fillBlockState(record, state)) {
+        return false;
     }
+    applyBERtoZero(state);
 
-    if (initValues.getBERtoZero() && ptrDA.BER != 0) {
-        //*protokollStream << "Erzwinge BER=0 fuer Code: " << code << ", Wert war:" << ptrDA.BER << " \r\n";
-        counters.totalBERtoZeroForced++;
-        ptrDA.BER = 0;
+    // precipitation for entire year 'regenja' and for only summer season 'regenso'
+    climate.regenja = record.REGENJA; /* Jetzt regenja,-so OK */
+    climate.regenso = record.REGENSO;
+
+    // potential evaporation of the city district
+    getKLIMA(record.BEZIRK, record.CODE, state.usage, climate);
+
+    // Bagrov-calculation for sealed and unsealed surfaces and runoff
+    if (resultCache != 0) {
+        evaluateCached(state, climate, result);
     }
+    else {
+        evaluateBlock(state, climate, result);
+    }
+
+    return true;
 }
 
-void Calculation::setUsageYieldIrrigation(int usage, int type, QString code)
+// =============================================================================
+// evaluateBlock() with results taken from or stored in the result cache. As
+// in calcDeduplicated(), the key does not contain the areas, they only scale
+// the volumes.
+// =============================================================================
+void Calculation::evaluateCached(BlockState &state, BlockClimate &climate, BlockResult &result)
 {
-    UsageResult result;
-
-    result = config->getUsageResult(usage, type, code);
+    ResultCacheKey key;
 
-    if (result.tupleIndex < 0) {
-        protokollStream << result.message;
-        qDebug() << result.message;
-       abort();
+    if (!usesResultCache()) {
+        evaluateBlock(state, climate, result);
+        return;
     }
 
-    if (!result.message.isEmpty()) {
-        protokollStream << result.message;
-        counters.protcount++;
+    fillCacheKey(state, climate, key);
+
+    if (resultCache->lookup(key, result)) {
+        setVolumes(result, state.fb + state.fs);
+        return;
     }
 
-    ptrDA.setUsageYieldIrrigation(config->getUsageTuple(result.tupleIndex));
+    evaluateBlock(state, climate, result);
+    resultCache->insert(key, result);
+}
+
+// A result cache is set and the results are those of the reference
+// arithmetic, the only ones the cache holds
+bool Calculation::usesResultCache()
+{
+    return resultCache != 0 && precision == Precision::legacyFloat && !warmStart;
+}
+
+void Calculation::fillCacheKey(
+    const BlockState &state, const BlockClimate &climate, ResultCacheKey &key
+)
+{
+    // the key has no implicit padding (see BlockState), all bytes are set
+    key.state = state;
+    key.state.fb = 0.0F;
+    key.state.fs = 0.0F;
+    key.climate = climate;
+
+    key.config[0] = initValues.getInfdach();
+    key.config[1] = initValues.getInfbel1();
+    key.config[2] = initValues.getInfbel2();
+    key.config[3] = initValues.getInfbel3();
+    key.config[4] = initValues.getInfbel4();
+    key.config[5] = initValues.getBagdach();
+    key.config[6] = initValues.getBagbel1();
+    key.config[7] = initValues.getBagbel2();
+    key.config[8] = initValues.getBagbel3();
+    key.config[9] = initValues.getBagbel4();
+    key.config[10] = initValues.getNiedKorrF();
+}
+
+// Volumes [qcm/s] from the results in mm/a, as in evaluateBlock()
+void Calculation::setVolumes(BlockResult &result, float area)
+{
+    result.rowvol = result.row * 3.171F * area / 100000.0F;
+    result.rivol = result.ri * 3.171F * area / 100000.0F;
+    result.rvol = result.rowvol + result.rivol;
+    result.flaeche = area;
 }
 
 // =============================================================================
-// FIXME:
+// Same as calc() but blocks that only differ in CODE and in their areas are
+// calculated only once. A first pass determines the block state and climate
+// of each record and assigns it to a unique parameter tuple. The key of a
+// tuple is the block state (without the areas, but with the shares of
+// building development and road areas) together with the climate, i.e.
+// exactly the input of evaluateBlock(). The results in mm/a are therefore
+// identical to calc(). The volumes are scaled with the area of each record.
 // =============================================================================
-void Calculation::getKLIMA(int bez, QString code)
+bool Calculation::calcDeduplicated(QString fileOut, bool debug)
 {
-    // Effektivitaetsparameter
-    float bag;
+    abimoRecord record;
+    BlockResult result;
+
+    // Key of a unique parameter tuple
+    struct TupleKey {
+        BlockState state;
+        BlockClimate climate;
+    } key;
+
+    static_assert(
+        sizeof(TupleKey) == sizeof(BlockState) + sizeof(BlockClimate),
+        "TupleKey has implicit padding"
+    );
+
+    // unique parameter tuples and their index in "tuples"
+    QHash<QByteArray, int> tupleIndex;
+    QVector<TupleKey> tuples;
+
+    // per written record: index of the parameter tuple, area and code (record
+    // number in the CODE arena of dbReader)
+    QVector<int> recordTuple;
+    QVector<float> recordArea;
+    QVector<int> recordCode;
+
+    if (dbReader == 0) {
+        error = "Keine Eingabedatei angegeben.";
+        return false;
+    }
+
+    startRun();
+    counters.totalRecRead = dbReader->getNumberOfRecords();
 
-    // ep = potential evaporation
-    float ep;
+    recordTuple.reserve(counters.totalRecRead);
+    recordArea.reserve(counters.totalRecRead);
 
-    // prepcipitation at ground level
-    float p;
+    for (int k = 0; k < counters.totalRecRead; k++) {
 
-    // ratio of precipitation to potential evaporation
-    float x;
+        if (! weiter.loadAcquire()) {
+            finishProtocol();
+            protokollStream << "Berechnungen abgebrochen.\r\n";
+            return true;
+        }
 
-    // ratio of real evaporation to potential evaporation
-    float y;
+        // not selected or NUTZUNG = 0, the record is not read (see isSelected())
+        if (!isSelected(k)) {
+            continue;
+        }
 
-    // real evapotranspiration
-    float etr;
+        dbReader->fillRecord(k, record, debug);
 
-    /*
-     * spaeter zeizusaetzliche Parameter Hier ;
-     * ptrDA.P1 = p1;
-     * * ptrDA.PS = ps;
-     */
-    ptrDA.P1 = regenja;
-    ptrDA.P1S = regenso;
+        if (!fillBlockState(record, key.state)) {
+            return false;
+        }
+        applyBERtoZero(key.state);
 
-    // parameter for the city districts
-    if (ptrDA.NUT == Usage::waterbody_G)
-    {
-        ptrDA.ETP = initValueOrReportedDefaultValue(
-            bez, code, initValues.hashEG, 775, "EG"
-        );
-    }
-    else
-    {
-        ptrDA.ETP = initValueOrReportedDefaultValue(
-            bez, code, initValues.hashETP, 660, "ETP"
-        );
+        key.climate.regenja = record.REGENJA;
+        key.climate.regenso = record.REGENSO;
+        getKLIMA(record.BEZIRK, record.CODE, key.state.usage, key.climate);
 
-        ptrDA.ETPS = initValueOrReportedDefaultValue(
-            bez, code, initValues.hashETPS, 530, "ETPS"
-        );
-    }
+        // The areas only scale the volumes
+        recordArea.append(key.state.fb + key.state.fs);
+        key.state.fb = 0.0F;
+        key.state.fs = 0.0F;
 
-    // declaration potential evaporation ep and precipitation p
-    ep = (float) ptrDA.ETP; /* Korrektur mit 1.1 gestrichen */
-    p = (float) ptrDA.P1 * initValues.getNiedKorrF(); /* ptrDA.KF */
+        QByteArray bytes(reinterpret_cast<const char*>(&key), sizeof(TupleKey));
 
-    /*
-     * Berechnung der Abfluesse RDV und R1V bis R4V fuer versiegelte
-     * Teilflaechen und unterschiedliche Bagrovwerte ND und N1 bis N4
-     */
+        int index = tupleIndex.value(bytes, -1);
 
-    // ratio precipitation to potential evaporation
-    x = p / ep;
+        if (index < 0) {
+            index = tuples.size();
+            tupleIndex.insert(bytes, index);
+            tuples.append(key);
+        }
 
-    Bagrov bagrov;
+        recordTuple.append(index);
+        recordCode.append(k);
 
-    /* Berechnung des Abflusses RxV fuer versiegelte Teilflaechen mittels
-       Umrechnung potentieller Verdunstungen ep zu realen über Umrechnungsfaktor y und
-       subtrahiert von Niederschlag p */
+        if (progressDue()) {
+            emit processSignal((int)((float) k / (float) counters.totalRecRead * 40.0), "Berechne");
+        }
+    }
 
-    RDV = p - bagrov.nbagro(initValues.getBagdach(), x) * ep;
-    R1V = p - bagrov.nbagro(initValues.getBagbel1(), x) * ep;
-    R2V = p - bagrov.nbagro(initValues.getBagbel2(), x) * ep;
-    R3V = p - bagrov.nbagro(initValues.getBagbel3(), x) * ep;
-    R4V = p - bagrov.nbagro(initValues.getBagbel4(), x) * ep;
+    // Calculate each unique parameter tuple once, unless its results are in
+    // the result cache
+    QVector<BlockResult> tupleResults(tuples.size());
+    QVector<int> order;
+    ResultCacheKey cacheKey;
 
-    // Calculate runoff RUV for unsealed partial surfaces
-    if (ptrDA.NUT == Usage::waterbody_G)
-    {
-        RUV = p - ep;
+    order.reserve(tuples.size());
+
+    for (int i = 0; i < tuples.size(); i++) {
+
+        if (usesResultCache()) {
+            fillCacheKey(tuples.at(i).state, tuples.at(i).climate, cacheKey);
+
+            if (resultCache->lookup(cacheKey, tupleResults[i])) {
+                continue;
+            }
+        }
+
+        order.append(i);
     }
-    else
-    {
-        // Determine effectiveness parameter bag for unsealed surfaces
-        bag = EffectivenessUnsealed::getNUV(ptrDA); /* Modul Raster abgespeckt */
 
-        if (ptrDA.P1S > 0 && ptrDA.ETPS > 0) {
-            bag *= getSummerModificationFactor(
-                (float) (ptrDA.P1S + ptrDA.BER + ptrDA.KR) / ptrDA.ETPS
+    // Warm start: sorted by the bag bucket and x of the unsealed surfaces,
+    // each Bagrov iteration starts close to its solution (see
+    // Bagrov::setWarmStart())
+    if (warmStart) {
+        QVector<int> buckets(tuples.size());
+        QVector<float> xs(tuples.size());
+
+        for (int i = 0; i < tuples.size(); i++) {
+
+            // no Bagrov relation for the unsealed part of waterbodies
+            if (tuples.at(i).state.usage == Usage::waterbody_G) {
+                buckets[i] = -1;
+                xs[i] = 0.0F;
+                continue;
+            }
+
+            float bag;
+            getUnsealedBagrovInput<LegacyFloatPolicy>(
+                tuples.at(i).state, tuples.at(i).climate, bag, xs[i]
             );
+            buckets[i] = Bagrov::getWarmStartBucket(bag);
         }
 
-        // Calculate the x-factor of bagrov relation: x = (P + KR + BER)/ETP
-        // Then get the y-factor: y = fbag(n, x)
-        y = bagrov.nbagro(bag, (p + ptrDA.KR + ptrDA.BER) / ep);
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            if (buckets.at(a) != buckets.at(b)) {
+                return buckets.at(a) < buckets.at(b);
+            }
+            return xs.at(a) < xs.at(b);
+        });
+    }
 
-        // Get the real evapotransporation using estimated y-factor
-        etr = y * ep;
+    QVector<BlockState> states(tuples.size());
+    QVector<BlockClimate> climates(tuples.size());
 
-        if (TAS < 0) {
-            etr += (ep - y * ep) * (float) exp(ptrDA.FLW / TAS);
-        }
+    for (int i = 0; i < tuples.size(); i++) {
+        states[i] = tuples.at(i).state;
+        climates[i] = tuples.at(i).climate;
+    }
 
-        RUV = p - etr;
+    evaluateBlocks(states, climates, order, tupleResults);
+
+    if (usesResultCache()) {
+        for (int i = 0; i < order.size(); i++) {
+            fillCacheKey(tuples.at(order.at(i)).state, tuples.at(order.at(i)).climate, cacheKey);
+            resultCache->insert(cacheKey, tupleResults.at(order.at(i)));
+        }
     }
-}
 
-float Calculation::initValueOrReportedDefaultValue(
-    int bez, QString code, QHash<int, int> &hash, int defaultValue, QString name
-)
-{
-    if (hash.contains(bez)) {
-        //take from xml
-        return hash.value(bez);
+    emit processSignal(45, "Berechne");
+
+    // Scatter the results to all records, scaling the volumes by the areas
+    DbaseWriter writer(fileOut, initValues);
+    writer.reserve(recordTuple.size());
+
+    for (int i = 0; i < recordTuple.size(); i++) {
+
+        result = tupleResults.at(recordTuple.at(i));
+
+        setVolumes(result, recordArea.at(i));
+
+        writeResultRecord(writer, dbReader->getCodes(), recordCode.at(i), result);
     }
 
-    //default
-    float result = hash.contains(0) ? hash.value(0) : defaultValue;
+    finishProtocol();
 
-    QString bezString;
-    bezString.setNum(bez);
+    if (debug) {
+        writeMemoryStatistics(writer);
+    }
 
-    QString string;
-    string.setNum(result);
+    counters.totalRecWrite = recordTuple.size();
 
-    protokollStream << "\r\n" + name + " unbekannt fuer " + code +
-        " von Bezirk " + bezString + "\r\n" + name +
-        "=" + string + " angenommen\r\n";
-    counters.protcount++;
+    protokollStream << "\r\nEindeutige Parameterkombinationen: " <<
+        tuples.size() << " von " << counters.totalRecWrite << " Bloecken (" <<
+        QString::number(
+            (tuples.size() > 0) ? (double) counters.totalRecWrite / tuples.size() : 0.0,
+            'f', 2
+        ) << "-fach dedupliziert)\r\n";
 
-    return result;
+    emit processSignal(50, "Schreibe Ergebnisse.");
+
+    return writeResults(writer);
 }
 
 // =============================================================================
-// Get factor to be applied for "summer"
+// Write the calculated variables of one block into a new output record
+// =============================================================================
+void Calculation::writeResultRecord(DbaseWriter &writer, QString code, BlockResult &result)
+{
+    writer.addRecord();
+    writer.setRecordField((int) ResultField::CODE, code);
+    writeResultValues(writer, result);
+}
+
+// Same as above with the code given by its id in a CODE arena (copied into
+// the output without a QString)
+void Calculation::writeResultRecord(
+    DbaseWriter &writer, const CodeArena &codes, int id, BlockResult &result
+)
+{
+    writer.addRecord();
+    writer.setRecordCode(codes, id);
+    writeResultValues(writer, result);
+}
+
+void Calculation::writeResultValues(DbaseWriter &writer, BlockResult &result)
+{
+    writer.setRecordField(ResultField::R, result.r);
+    writer.setRecordField(ResultField::ROW, result.row);
+    writer.setRecordField(ResultField::RI, result.ri);
+    writer.setRecordField(ResultField::RVOL, result.rvol);
+    writer.setRecordField(ResultField::ROWVOL, result.rowvol);
+    writer.setRecordField(ResultField::RIVOL, result.rivol);
+    writer.setRecordField(ResultField::FLAECHE, result.flaeche);
+// cls_5c:
+    writer.setRecordField(ResultField::VERDUNSTUN, result.verdunst);
+}
+
+// Memory taken by the text of the result values in this run (written to the
+// protocol when debugging)
+void Calculation::writeMemoryStatistics(const DbaseWriter &writer)
+{
+    const RunArenaStatistics &statistics = writer.getStatistics();
+
+    protokollStream << "\r\nSpeicher der Ergebniswerte: " << statistics.bytes <<
+        " Bytes in " << statistics.allocations << " Werten, " <<
+        statistics.heapAllocations << " Allokationen\r\n";
+}
+
+// =============================================================================
+// Compile the input file into a block model file (see BlockModel) holding the
+// climate independent state of each block. The state does not depend on
+// InitValues, so the model can be evaluated with any configuration.
+// =============================================================================
+bool Calculation::compile(QString fileOut, bool debug)
+{
+    abimoRecord record;
+    BlockModelHeader header;
+    QVector<BlockModelEntry> entries;
+    QByteArray codes;
+
+    if (dbReader == 0) {
+        error = "Keine Eingabedatei angegeben.";
+        return false;
+    }
+
+    memset(&header, 0, sizeof(BlockModelHeader));
+
+    startRun();
+    counters.totalRecRead = dbReader->getNumberOfRecords();
+
+    entries.reserve(counters.totalRecRead);
+
+    for (int k = 0; k < counters.totalRecRead; k++) {
+
+        if (! weiter.loadAcquire()) {
+            finishProtocol();
+            protokollStream << "Berechnungen abgebrochen.\r\n";
+            return true;
+        }
+
+        // not selected or NUTZUNG = 0, the record is not read (see isSelected())
+        if (!isSelected(k)) {
+            continue;
+        }
+
+        dbReader->fillRecord(k, record, debug);
+
+        BlockModelEntry entry;
+
+        // clear padding bytes so that the file content is reproducible
+        memset(&entry, 0, sizeof(BlockModelEntry));
+
+        if (!fillBlockState(record, entry.state)) {
+            return false;
+        }
+
+        entry.BEZIRK = record.BEZIRK;
+        entry.REGENJA = record.REGENJA;
+        entry.REGENSO = record.REGENSO;
+
+        // the bytes of the file, decoded as in calc() by BlockModel::getCode()
+        const CodeArena &arena = dbReader->getCodes();
+        entry.codeOffset = codes.size();
+        entry.codeLength = arena.getLength(k);
+        codes.append(arena.getData(k), arena.getLength(k));
+
+        entries.append(entry);
+
+        if (progressDue()) {
+            emit processSignal((int)((float) k / (float) counters.totalRecRead * 50.0), "Kompiliere");
+        }
+    }
+
+    finishProtocol();
+
+    counters.totalRecWrite = entries.size();
+
+    header.numberOfRecords = counters.totalRecRead;
+    header.nutzungIstNull = counters.nutzungIstNull;
+    header.keineFlaechenAngegeben = counters.keineFlaechenAngegeben;
+
+    emit processSignal(50, "Schreibe Blockmodell.");
+
+    if (!BlockModel::write(fileOut, header, entries, codes, error)) {
+        protokollStream << "Error: " + error + "\r\n";
+        return false;
+    }
+
+    return true;
+}
+
+// =============================================================================
+// Evaluate a compiled block model with the current InitValues. Usage lookups
+// and the parsing of the input file are skipped entirely.
+// =============================================================================
+bool Calculation::calcModel(BlockModel &model, QString fileOut)
+{
+    const BlockModelHeader &header = model.getHeader();
+    int n = model.getNumberOfBlocks();
+
+    QVector<BlockState> states(n);
+    QVector<BlockClimate> climates(n);
+    QVector<BlockResult> results(n);
+    QVector<int> order(n);
+
+    // the counters of the records are those of compile()
+    startRun();
+    counters.protcount = header.keineFlaechenAngegeben;
+    counters.keineFlaechenAngegeben = header.keineFlaechenAngegeben;
+    counters.nutzungIstNull = header.nutzungIstNull;
+    counters.totalRecRead = header.numberOfRecords;
+
+    DbaseWriter writer(fileOut, initValues);
+    writer.reserve(n);
+
+    for (int i = 0; i < n; i++) {
+
+        if (! weiter.loadAcquire()) {
+            finishProtocol();
+            protokollStream << "Berechnungen abgebrochen.\r\n";
+            return true;
+        }
+
+        const BlockModelEntry &entry = model.getEntry(i);
+
+        states[i] = entry.state;
+        applyBERtoZero(states[i]);
+
+        climates[i].regenja = entry.REGENJA;
+        climates[i].regenso = entry.REGENSO;
+        getKLIMA(entry.BEZIRK, model.getCode(i), states[i].usage, climates[i]);
+
+        order[i] = i;
+
+        if (progressDue()) {
+            emit processSignal((int)((float) i / (float) n * 40.0), "Berechne");
+        }
+    }
+
+    evaluateBlocks(states, climates, order, results);
+
+    emit processSignal(45, "Berechne");
+
+    for (int i = 0; i < n; i++) {
+        writeResultRecord(writer, model.getCode(i), results[i]);
+    }
+
+    finishProtocol();
+
+    counters.totalRecWrite = n;
+
+    emit processSignal(50, "Schreibe Ergebnisse.");
+
+    return writeResults(writer);
+}
+
+// =============================================================================
+// Incremental run: dbReader is the input of a previous run and previousOutput
+// its result file. Only the records of the delta file (changed or new blocks,
+// NUTZUNG = 0 for removed blocks) are calculated, all other results are taken
+// from the previous result file. Records of the delta file that are identical
+// to those of the previous input are skipped (see writeMerged()).
+// =============================================================================
+bool Calculation::calcDelta(DbaseReader &delta, DbaseReader &previousOutput, QString fileOut, bool debug)
+{
+    abimoRecord record;
+    BlockResult result;
+
+    if (dbReader == 0) {
+        error = "Keine Eingabedatei angegeben.";
+        return false;
+    }
+
+    if (!isPreviousResult(previousOutput)) {
+        return false;
+    }
+
+    startRun();
+    counters.totalRecRead = delta.getNumberOfRecords();
+
+    // each field of the delta file is compared with the same field of the
+    // previous input
+    QStringList deltaFields = delta.getFieldNames();
+    QVector<int> inputFields;
+
+    for (int i = 0; i < deltaFields.size(); i++) {
+
+        inputFields.append(dbReader->getFieldIndex(deltaFields.at(i)));
+
+        if (inputFields.last() < 0) {
+            error = "Feld " + deltaFields.at(i) + " fehlt in der Datei: '" +
+                dbReader->getFileName() + "'.";
+            return false;
+        }
+    }
+
+    // rows of the previous input and output by CODE, looked up in their code
+    // indexes (built once, see CodeIndex) instead of reading all codes
+    CodeIndex inputRows(dbReader->getFileName());
+    CodeIndex outputRows(previousOutput.getFileName());
+
+    if (!inputRows.open()) {
+        error = inputRows.getError();
+        return false;
+    }
+
+    if (!outputRows.open()) {
+        error = outputRows.getError();
+        return false;
+    }
+
+    const CodeArena &deltaCodes = delta.getCodes();
+
+    ResultChanges changes;
+    int unchanged = 0;
+
+    for (int k = 0; k < counters.totalRecRead; k++) {
+
+        if (! weiter.loadAcquire()) {
+            finishProtocol();
+            protokollStream << "Berechnungen abgebrochen.\r\n";
+            return true;
+        }
+
+        delta.fillRecord(k, record, debug);
+
+        int row = inputRows.find(deltaCodes.getData(k), deltaCodes.getLength(k));
+
+        if (row >= 0) {
+
+            bool same = true;
+
+            for (int i = 0; same && i < deltaFields.size(); i++) {
+                same = delta.getRecord(k, i) == dbReader->getRecord(row, inputFields.at(i));
+            }
+
+            if (same) {
+                unchanged++;
+                continue;
+            }
+        }
+
+        int outputRow = outputRows.find(deltaCodes.getData(k), deltaCodes.getLength(k));
+
+        if (record.NUTZUNG == 0) {
+            counters.nutzungIstNull++;
+            if (outputRow >= 0) {
+                changes.removed.insert(outputRow);
+            }
+            continue;
+        }
+
+        if (!calcRecord(record, result)) {
+            return false;
+        }
+
+        if (outputRow >= 0) {
+            changes.changed.insert(outputRow, result);
+        }
+        else {
+            changes.addedCodes.append(record.CODE);
+            changes.added.append(result);
+        }
+
+        if (progressDue()) {
+            emit processSignal((int)((float) k / (float) counters.totalRecRead * 50.0), "Berechne");
+        }
+    }
+
+    finishProtocol();
+
+    protokollStream << "\r\nDelta: " << changes.changed.size() << " geaendert, " <<
+        changes.added.size() << " neu, " << changes.removed.size() << " entfernt, " <<
+        unchanged << " unveraendert\r\n";
+
+    return writeMerged(previousOutput, changes, fileOut);
+}
+
+// =============================================================================
+// Configuration change: initValues differ from previousValues, the values of
+// the previous run on the same input file that wrote previousOutput. Only the
+// blocks affected by the differences (see ConfigDiff) are calculated, the
+// results of all other blocks are taken from the previous result file.
+// =============================================================================
+bool Calculation::calcConfigChange(InitValues &previousValues, DbaseReader &previousOutput, QString fileOut, bool debug)
+{
+    abimoRecord record;
+    BlockResult result;
+
+    ConfigDiff diff(previousValues, initValues);
+
+    protokollStream << "\r\nGeaenderte Parameter: " <<
+        (diff.isEmpty() ? QString("keine") : diff.getChanges().join(", ")) << "\r\n";
+
+    // e.g. other decimals, the fields of the previous result do not fit
+    if (diff.affectsAll()) {
+        return calc(fileOut, debug);
+    }
+
+    if (dbReader == 0) {
+        error = "Keine Eingabedatei angegeben.";
+        return false;
+    }
+
+    if (!isPreviousResult(previousOutput)) {
+        return false;
+    }
+
+    startRun();
+    counters.totalRecRead = dbReader->getNumberOfRecords();
+
+    // rows of the previous result by CODE (see calcDelta())
+    CodeIndex outputRows(previousOutput.getFileName());
+
+    if (!outputRows.open()) {
+        error = outputRows.getError();
+        return false;
+    }
+
+    const CodeArena &codes = dbReader->getCodes();
+
+    ResultChanges changes;
+
+    for (int k = 0; k < counters.totalRecRead; k++) {
+
+        if (! weiter.loadAcquire()) {
+            finishProtocol();
+            protokollStream << "Berechnungen abgebrochen.\r\n";
+            return true;
+        }
+
+        dbReader->fillRecord(k, record, debug);
+
+        if (record.NUTZUNG == 0) {
+            counters.nutzungIstNull++;
+            continue;
+        }
+
+        if (!diff.affects(record)) {
+            continue;
+        }
+
+        int outputRow = outputRows.find(codes.getData(k), codes.getLength(k));
+
+        if (outputRow < 0) {
+            finishProtocol();
+            error = "Block " + record.CODE + " fehlt in der Datei: '" +
+                previousOutput.getFileName() + "', bitte vollstaendig berechnen.";
+            return false;
+        }
+
+        if (!calcRecord(record, result)) {
+            return false;
+        }
+        changes.changed.insert(outputRow, result);
+
+        if (progressDue()) {
+            emit processSignal((int)((float) k / (float) counters.totalRecRead * 50.0), "Berechne");
+        }
+    }
+
+    finishProtocol();
+
+    protokollStream << "Neu berechnet: " << changes.changed.size() << " von " <<
+        previousOutput.getNumberOfRecords() << " Bloecken\r\n";
+
+    return writeMerged(previousOutput, changes, fileOut);
+}
+
+bool Calculation::isPreviousResult(DbaseReader &previousOutput)
+{
+    QString fileName = previousOutput.getFileName();
+
+    if (!DbaseWriter(fileName, initValues).hasSameFields(previousOutput)) {
+        error = "Die Datei: '" + previousOutput.getFileName() + "' ist kein Ergebnis "
+            "mit den aktuellen Einstellungen, bitte vollstaendig berechnen.";
+        return false;
+    }
+
+    return true;
+}
+
+// =============================================================================
+// Write the previous result file with the given changes to fileOut. If the
+// rows stay the same and the new values fit into the fields, the changed
+// rows are overwritten in a copy of the previous result file (or in the file
+// itself if fileOut is the previous result file), otherwise the file is
+// rewritten.
+// =============================================================================
+bool Calculation::writeMerged(DbaseReader &previousOutput, ResultChanges &changes, QString fileOut)
+{
+    emit processSignal(50, "Schreibe Ergebnisse.");
+
+    // Same rows as before: overwrite the changed rows only
+    if (changes.added.isEmpty() && changes.removed.isEmpty()) {
+
+        DbaseWriter patchWriter(fileOut, initValues);
+        QVector<int> rows;
+
+        for (QMap<int, BlockResult>::iterator it = changes.changed.begin(); it != changes.changed.end(); ++it) {
+            writeResultRecord(patchWriter, previousOutput.getCodes(), it.key(), it.value());
+            rows.append(it.key());
+        }
+
+        // otherwise values are too long for the fields, write a new file
+        if (patchWriter.fitsInto(previousOutput)) {
+
+            counters.totalRecWrite = rows.size();
+
+            if (!patchWriter.patch(previousOutput, rows)) {
+                protokollStream << "Error: "+ patchWriter.getError() +"\r\n";
+                error = "Fehler beim Schreiben der Ergebnisse.\n" + patchWriter.getError();
+                return false;
+            }
+
+            protokollStream << "Ergebnisdatei: " << rows.size() << " Zeilen ersetzt\r\n";
+            return true;
+        }
+    }
+
+    DbaseWriter writer(fileOut, initValues);
+
+    for (int k = 0; k < previousOutput.getNumberOfRecords(); k++) {
+
+        if (changes.removed.contains(k)) {
+            continue;
+        }
+
+        if (changes.changed.contains(k)) {
+            writeResultRecord(writer, previousOutput.getCodes(), k, changes.changed[k]);
+            continue;
+        }
+
+        writer.addRecord();
+        writer.setRecordCode(previousOutput.getCodes(), k);
+
+        // same fields as the writer (see isPreviousResult()), 0 is CODE
+        for (int i = 1; i < previousOutput.getCountFields(); i++) {
+            writer.setRecordField(i, previousOutput.getRecord(k, i));
+        }
+    }
+
+    for (int i = 0; i < changes.added.size(); i++) {
+        writeResultRecord(writer, changes.addedCodes.at(i), changes.added[i]);
+    }
+
+    counters.totalRecWrite =
+        previousOutput.getNumberOfRecords() - changes.removed.size() + changes.added.size();
+
+    if (!writeResults(writer)) {
+        return false;
+    }
+
+    protokollStream << "Ergebnisdatei neu geschrieben\r\n";
+
+    return true;
+}
+
+// =============================================================================
+// Calculate a series of years for each block partial area. The input file
+// must provide one column REGENJA_<year> per year and may provide columns
+// REGENSO_<year> (otherwise REGENSO is used for all years). The climate
+// independent block state is computed once per block and reused for all
+// years. Results are streamed to a CSV file, either one row per block and
+// year or one row per block with statistics over all years.
+// =============================================================================
+bool Calculation::calcSeries(QString fileOut, SeriesOutput mode, bool debug)
+{
+    abimoRecord record;
+    BlockState state;
+    BlockClimate climate;
+
+    if (dbReader == 0) {
+        error = "Keine Eingabedatei angegeben.";
+        return false;
+    }
+
+    // Find the columns with yearly precipitation
+    QStringList years;
+    QVector<int> columnsJA;
+    QVector<int> columnsSO;
+
+    const QStringList fieldNames = dbReader->getFieldNames();
+
+    for (int i = 0; i < fieldNames.size(); i++) {
+        if (fieldNames.at(i).startsWith("REGENJA_")) {
+            QString year = fieldNames.at(i).mid(8);
+            years << year;
+            columnsJA.append(i);
+            columnsSO.append(dbReader->getFieldIndex("REGENSO_" + year));
+        }
+    }
+
+    if (years.isEmpty()) {
+        error = "Keine Spalten REGENJA_<Jahr> in der Eingabedatei gefunden.";
+        protokollStream << "Error: " + error + "\r\n";
+        return false;
+    }
+
+    int n = years.size();
+
+    QVector<float> regenja(n);
+    QVector<float> regenso(n);
+    QVector<BlockResult> results(n);
+    NonIntegerValues nonInteger = {0L, QString()};
+
+    QFile file(fileOut);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = "kann Out-Datei: '" + fileOut + "' nicht oeffnen\n Grund: " +
+            file.errorString();
+        protokollStream << "Error: " + error + "\r\n";
+        return false;
+    }
+
+    QTextStream out(&file);
+
+    int decR = initValues.getDecR();
+    int decROW = initValues.getDecROW();
+    int decRI = initValues.getDecRI();
+    int decVERDUNSTUNG = initValues.getDecVERDUNSTUNG();
+
+    if (mode == SeriesOutput::years) {
+        out << "CODE,YEAR,R,ROW,RI,RVOL,ROWVOL,RIVOL,FLAECHE,VERDUNSTUN\n";
+    }
+    else {
+        out << "CODE,YEARS,R_MEAN,R_MIN,R_MAX,ROW_MEAN,ROW_MIN,ROW_MAX,"
+               "RI_MEAN,RI_MIN,RI_MAX,VERDUNSTUN_MEAN,VERDUNSTUN_MIN,"
+               "VERDUNSTUN_MAX,FLAECHE\n";
+    }
+
+    int index = 0;
+
+    startRun();
+    counters.totalRecRead = dbReader->getNumberOfRecords();
+
+    for (int k = 0; k < counters.totalRecRead; k++) {
+
+        if (! weiter.loadAcquire()) {
+            finishProtocol();
+            protokollStream << "Berechnungen abgebrochen.\r\n";
+            return true;
+        }
+
+        // not selected or NUTZUNG = 0, the record is not read (see isSelected())
+        if (!isSelected(k)) {
+            continue;
+        }
+
+        dbReader->fillRecord(k, record, debug);
+
+        if (!fillBlockState(record, state)) {
+            return false;
+        }
+        applyBERtoZero(state);
+
+        climate.regenja = record.REGENJA;
+        climate.regenso = record.REGENSO;
+        getKLIMA(record.BEZIRK, record.CODE, state.usage, climate);
+
+        for (int i = 0; i < n; i++) {
+            regenja[i] = getSeriesValue(k, columnsJA.at(i), record.CODE, nonInteger);
+            regenso[i] = (columnsSO.at(i) < 0) ?
+                climate.regenso :
+                getSeriesValue(k, columnsSO.at(i), record.CODE, nonInteger);
+        }
+
+        evaluateSeries(state, climate, regenja.data(), regenso.data(), n, results.data());
+
+        if (mode == SeriesOutput::years) {
+            for (int i = 0; i < n; i++) {
+                const BlockResult &result = results.at(i);
+                out << Helpers::csvField(record.CODE) << ',' << years.at(i) << ','
+                    << QString::number(result.r, 'f', decR) << ','
+                    << QString::number(result.row, 'f', decROW) << ','
+                    << QString::number(result.ri, 'f', decRI) << ','
+                    << QString::number(result.rvol, 'f', initValues.getDecRVOL()) << ','
+                    << QString::number(result.rowvol, 'f', initValues.getDecROWVOL()) << ','
+                    << QString::number(result.rivol, 'f', initValues.getDecRIVOL()) << ','
+                    << QString::number(result.flaeche, 'f', initValues.getDecFLAECHE()) << ','
+                    << QString::number(result.verdunst, 'f', decVERDUNSTUNG) << '\n';
+            }
+        }
+        else {
+            // sum, minimum and maximum of R, ROW, RI, VERDUNSTUN
+            double sum[4] = {0.0, 0.0, 0.0, 0.0};
+            float min[4];
+            float max[4];
+
+            for (int i = 0; i < n; i++) {
+                const BlockResult &result = results.at(i);
+                float values[4] = {result.r, result.row, result.ri, result.verdunst};
+                for (int j = 0; j < 4; j++) {
+                    sum[j] += values[j];
+                    min[j] = (i == 0) ? values[j] : MIN(min[j], values[j]);
+                    max[j] = (i == 0) ? values[j] : MAX(max[j], values[j]);
+                }
+            }
+
+            int decimals[4] = {decR, decROW, decRI, decVERDUNSTUNG};
+
+            out << Helpers::csvField(record.CODE) << ',' << n;
+
+            for (int j = 0; j < 4; j++) {
+                out << ',' << QString::number(sum[j] / n, 'f', decimals[j])
+                    << ',' << QString::number(min[j], 'f', decimals[j])
+                    << ',' << QString::number(max[j], 'f', decimals[j]);
+            }
+
+            out << ',' << QString::number(results.at(0).flaeche, 'f', initValues.getDecFLAECHE())
+                << '\n';
+        }
+
+        index++;
+
+        if (progressDue()) {
+            emit processSignal((int)((float) k / (float) counters.totalRecRead * 50.0), "Berechne");
+        }
+    }
+
+    finishProtocol();
+
+    if (nonInteger.count > 0) {
+        protokollStream << "\r\nNicht ganzzahlige Niederschlaege: " << nonInteger.count <<
+            " Werte, z.B. " << nonInteger.example << " (die Werte werden so verwendet)\r\n";
+    }
+
+    counters.totalRecWrite = index;
+
+    out.flush();
+    file.close();
+
+    if (out.status() != QTextStream::Ok || file.error() != QFile::NoError) {
+        error = "Fehler beim Schreiben in: '" + fileOut + "'\n Grund: " + file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+// Precipitation of one year (column field of record k). The values are read
+// as numbers with decimals, values that are not integers are counted.
+float Calculation::getSeriesValue(int k, int field, const QString &code, NonIntegerValues &nonInteger)
+{
+    float value = dbReader->getFloat(k, field);
+
+    if (value != floorf(value)) {
+        if (nonInteger.count == 0) {
+            nonInteger.example = QString("%1 = %2 in Block %3").arg(
+                dbReader->getFieldNames().at(field), QString::number(value), code
+            );
+        }
+        nonInteger.count++;
+    }
+
+    return value;
+}
+
+// =============================================================================
+// Fill the climate independent state of a block partial area: usage tuple,
+// soil parameters and the shares of sealed, canalized and paved areas.
+// Returns false (with error set) for an unknown usage.
+// =============================================================================
+bool Calculation::fillBlockState(abimoRecord &record, BlockState &state)
+{
+    // the state is part of the keys of calcDeduplicated() and of the result
+    // cache, all of its bytes are set (including BlockState::padding)
+    memset(&state, 0, sizeof(BlockState));
+
+    // depth to groundwater table 'FLUR'
+    ptrDA.FLW = record.FLUR;
+
+    bool known = getNUTZ(
+        record.NUTZUNG,
+        record.TYP,      // structure type
+        record.FELD_30,  // field capacity [%] for 0- 30cm below ground level
+        record.FELD_150, // field capacity [%] for 0-150cm below ground level
+        record.CODE
+    );
+
+    if (!known) {
+        return false;
+    }
+
+    /* cls_6a: an dieser Stelle muss garantiert werden, dass f30 und f150
+       als Parameter von getNUTZ einen definierten Wert erhalten und zwar 0.
+
+       FIXED: alle Werte sind definiert... wenn keine 0, sondern nichts bzw. Leerzeichen
+       angegeben wurden, wird nun eine 0 eingesetzt
+       aber eigentlich war das auch schon so ... ???
+    */
+
+    state.usage = ptrDA.NUT;
+    state.yield = ptrDA.ERT;
+    state.irrigation = ptrDA.BER;
+    state.FLW = ptrDA.FLW;
+
+    // nFK, TAS and KR are not needed (and not determined) for waterbodies
+    if (ptrDA.NUT == Usage::waterbody_G) {
+        state.nFK = 0.0F;
+        state.TAS = 0.0F;
+        state.KR = 0;
+        state.bag0 = 0.0F;
+    }
+    else {
+        state.nFK = ptrDA.nFK;
+        state.TAS = TAS;
+        state.KR = ptrDA.KR;
+        state.bag0 = EffectivenessUnsealed::getBag0(ptrDA.nFK, ptrDA.NUT, ptrDA.ERT);
+    }
+
+    // share of roof area [%] 'PROBAU'
+    state.vgd = record.PROBAU_fraction;
+
+    // share of other sealed areas (e.g. Hofflaechen) and calculate total sealed area
+    state.vgb = record.PROVGU_fraction;
+    state.VER = INT_ROUND(state.vgd * 100 + state.vgb * 100);
+
+    // share of sealed road area
+    state.vgs = record.VGSTRASSE_fraction;
+
+    // degree of canalization for roof / other sealed areas / sealed roads
+    state.kd = record.KAN_BEB_fraction;
+    state.kb = record.KAN_VGU_fraction;
+    state.ks = record.KAN_STR_fraction;
+
+    // share of each pavement class for surfaces except roads of block area
+    state.bl1 = record.BELAG1_fraction;
+    state.bl2 = record.BELAG2_fraction;
+    state.bl3 = record.BELAG3_fraction;
+    state.bl4 = record.BELAG4_fraction;
+
+    // share of each pavement class for roads of block area
+    state.bls1 = record.STR_BELAG1_fraction;
+    state.bls2 = record.STR_BELAG2_fraction;
+    state.bls3 = record.STR_BELAG3_fraction;
+    state.bls4 = record.STR_BELAG4_fraction;
+
+    state.fb = record.FLGES;
+    state.fs = record.STR_FLGES;
+
+    // if sum of total building development area and roads area is inconsiderably small
+    // it is assumed, that the area is unknown and 100 % building development area will be given by default
+    if (state.fb + state.fs < 0.0001)
+    {
+        //*protokollStream << "\r\nDie Flaeche des Elements " + record.CODE + " ist 0 \r\nund wird automatisch auf 100 gesetzt\r\n";
+        counters.protcount++;
+        counters.keineFlaechenAngegeben++;
+        state.fb = 100.0F;
+    }
+
+    // fbant = Verhaeltnis Bebauungsflaeche zu Gesamtflaeche
+    // fbant = ratio of building development area to total area
+    state.fbant = state.fb / (state.fb + state.fs);
+
+    // fsant = Verhaeltnis Strassenflaeche zu Gesamtflaeche
+    // fsant = ratio of roads area to total area
+    state.fsant = state.fs / (state.fb + state.fs);
+
+    return true;
+}
+
+// Effectiveness parameter bag and x = (P + KR + BER)/ETP of the Bagrov
+// relation for the unsealed surfaces (not for waterbodies)
+template <class P>
+void Calculation::getUnsealedBagrovInput(
+    const BlockState &state, const BlockClimate &climate,
+    typename P::real &bag, typename P::real &x
+)
+{
+    if (state.usage == Usage::forested_W) {
+        getUnsealedBagrovInput<P, Usage::forested_W>(state, climate, bag, x);
+    }
+    else {
+        getUnsealedBagrovInput<P, Usage::agricultural_L>(state, climate, bag, x);
+    }
+}
+
+// Same as above for blocks of the usage class U (see getKernelUsage())
+template <class P, Usage U>
+void Calculation::getUnsealedBagrovInput(
+    const BlockState &state, const BlockClimate &climate,
+    typename P::real &bag, typename P::real &x
+)
+{
+    typedef typename P::real real;
+
+    real ep = (real) climate.ETP;
+    real p = (real) climate.regenja * initValues.getNiedKorrF();
+
+    bag = state.bag0;
+
+    // Modifikation, wenn keine Sommerwerte
+    if (
+        U != Usage::forested_W && state.irrigation > 0 &&
+        climate.regenso == 0 && climate.ETPS == 0
+    ) {
+        bag = EffectivenessUnsealed::nonSummerCorrected<P>(bag, state.irrigation);
+    }
+
+    if (climate.regenso > 0 && climate.ETPS > 0) {
+        bag *= getSummerModificationFactor(
+            (float) (climate.regenso + state.irrigation + state.KR) / climate.ETPS
+        );
+    }
+
+    x = (p + state.KR + state.irrigation) / ep;
+}
+
 // =============================================================================
-float Calculation::getSummerModificationFactor(float wa)
+// Precipitation dependent part of the calculation: Bagrov relation for sealed
+// and unsealed surfaces and the resulting runoff and infiltration
+// =============================================================================
+void Calculation::evaluateBlock(
+    const BlockState &state, const BlockClimate &climate, BlockResult &result
+)
+{
+    switch (precision) {
+    case Precision::doublePrecision:
+        evaluateBlock<DoublePolicy>(state, climate, result);
+        break;
+    case Precision::fastFloat:
+        evaluateBlock<FastFloatPolicy>(state, climate, result);
+        break;
+    default:
+        evaluateBlock<LegacyFloatPolicy>(state, climate, result);
+    }
+}
+
+// evaluateBlock() with the arithmetic of the policy P (see precision.h)
+template <class P>
+void Calculation::evaluateBlock(
+    const BlockState &state, const BlockClimate &climate, BlockResult &result
+)
+{
+    typedef typename P::real real;
+
+    // y-factors of the Bagrov relation for the roofs and pavement classes
+    real ySealed[SEALED_CURVES];
+
+    getSealedBagrovY<P>(climate, ySealed);
+
+    evaluateBlock<P>(state, climate, ySealed, result);
+}
+
+// y-factors of the roofs and pavement classes (see sealedCurves)
+template <class P>
+void Calculation::getSealedBagrovY(const BlockClimate &climate, typename P::real *ySealed)
+{
+    typename P::real x = getSealedBagrovX<P>(climate);
+
+    for (int i = 0; i < SEALED_CURVES; i++) {
+        ySealed[i] = sealedCurves[i].evaluate<P>(x);
+    }
+}
+
+// ratio precipitation to potential evaporation (of the sealed surfaces)
+template <class P>
+typename P::real Calculation::getSealedBagrovX(const BlockClimate &climate)
+{
+    typedef typename P::real real;
+
+    real ep = (real) climate.ETP;
+    real p = (real) climate.regenja * initValues.getNiedKorrF();
+
+    return p / ep;
+}
+
+// Same as above with the y-factors of the sealed surfaces given
+template <class P>
+void Calculation::evaluateBlock(
+    const BlockState &state, const BlockClimate &climate, const typename P::real *ySealed,
+    BlockResult &result
+)
+{
+    switch (getKernelUsage(state.usage)) {
+    case Usage::waterbody_G:
+        evaluateBlock<P, Usage::waterbody_G>(state, climate, ySealed, result);
+        break;
+    case Usage::forested_W:
+        evaluateBlock<P, Usage::forested_W>(state, climate, ySealed, result);
+        break;
+    default:
+        evaluateBlock<P, Usage::agricultural_L>(state, climate, ySealed, result);
+    }
+}
+
+// Kernel for the blocks of the usage class U: the branches on the usage are
+// resolved at compile time (see getKernelUsage())
+template <class P, Usage U>
+void Calculation::evaluateBlock(
+    const BlockState &state, const BlockClimate &climate, const typename P::real *ySealed,
+    BlockResult &result
+)
 {
-    const float watab[] =
+    typedef typename P::real real;
+
+    // Abfluesse nach Bagrov fuer Dachflaechen (D) und Belagsklassen 1 bis 4
+    real RDV, R1V, R2V, R3V, R4V;
+
+    // Abfluss unversiegelter Flaechen
+    real RUV;
+
+    // Abflussvariablen der versiegelten Flaechen
+    // runoff variables of sealed surfaces
+    real row1, row2, row3, row4;
+
+    // Infiltrationsvariablen der versiegelten Flaechen
+    // infiltration variables of sealed surfaces
+    real ri1, ri2, ri3, ri4;
+
+    // Abfluss- / Infiltrationsvariablen der Dachflaechen
+    // runoff- / infiltration variables of roof surfaces
+    real rowd, rid;
+
+    // Abfluss- / Infiltrationsvariablen unversiegelter Strassenflaechen
+    // runoff- / infiltration variables of unsealed road surfaces
+    real rowuvs, riuvs;
+
+    // Infiltration unversiegelter Flaechen
+    // infiltratio of unsealed areas
+    real riuv;
+
+    // float-Zwischenwerte
+    // float interm values
+    real r, ri, row;
+
+    // declaration potential evaporation ep and precipitation p
+    real ep = (real) climate.ETP; /* Korrektur mit 1.1 gestrichen */
+    real p = (real) climate.regenja * initValues.getNiedKorrF(); /* ptrDA.KF */
+
+    /*
+     * Berechnung der Abfluesse RDV und R1V bis R4V fuer versiegelte
+     * Teilflaechen und unterschiedliche Bagrovwerte ND und N1 bis N4
+     */
+
+    /* Berechnung des Abflusses RxV fuer versiegelte Teilflaechen mittels
+       Umrechnung potentieller Verdunstungen ep zu realen über Umrechnungsfaktor y und
+       subtrahiert von Niederschlag p */
+
+    RDV = p - ySealed[0] * ep;
+    R1V = p - ySealed[1] * ep;
+    R2V = p - ySealed[2] * ep;
+    R3V = p - ySealed[3] * ep;
+    R4V = p - ySealed[4] * ep;
+
+    // Calculate runoff RUV for unsealed partial surfaces
+    if (U == Usage::waterbody_G)
     {
-        0.45F, 0.50F, 0.55F, 0.60F, 0.65F, 0.70F, 0.75F, // 0 ..  6
-        0.80F, 0.85F, 0.90F, 0.95F, 1.00F, 1.05F, 1.10F  // 7 .. 13
-    };
+        RUV = p - ep;
+    }
+    else
+    {
+        // Effectiveness parameter bag for unsealed surfaces and the x-factor
+        // of bagrov relation: x = (P + KR + BER)/ETP
+        real bag, xUnsealed;
+        getUnsealedBagrovInput<P, U>(state, climate, bag, xUnsealed);
+
+        // Then get the y-factor: y = fbag(n, x)
+        real y = unsealedBagrov.evaluate<P>(bag, xUnsealed);
+
+        // Get the real evapotransporation using estimated y-factor
+        real etr = y * ep;
+
+        if (state.TAS < 0) {
+            etr += (ep - y * ep) * (real) P::exp(state.FLW / state.TAS);
+        }
+
+        RUV = p - etr;
+    }
+
+    // Runoff for sealed surfaces
+    /* cls_1: Fehler a:
+       rowd = (1.0F - initValues.getInfdach()) * vgd * kb * fbant * RDV;
+       richtige Zeile folgt (kb ----> kd)
+    */
+
+    /*  Legende der Abflussberechnung der 4 Belagsklassen bzw. Dachklasse:
+        rowd / rowx: Abfluss Dachflaeche / Abfluss Belagsflaeche x
+        infdach / infbelx: Infiltrationsparameter Dachfl. / Belagsfl. x
+        belx: Anteil Belagsklasse x
+        blsx: Anteil Strassenbelagsklasse x
+        vgd / vgb: Anteil versiegelte Dachfl. / sonstige versiegelte Flaeche zu Gesamtblockteilflaeche
+        kd / kb / ks: Grad der Kanalisierung Dach / sonst. vers. Fl. / Strassenflaechen
+        fbant / fsant: ?
+        RDV / RxV: Gesamtabfluss versiegelte Flaeche
+    */
+    const real vgd = state.vgd, vgb = state.vgb, vgs = state.vgs;
+    const real kd = state.kd, kb = state.kb, ks = state.ks;
+    const real fbant = state.fbant, fsant = state.fsant;
+    const real infdach = initValues.getInfdach();
+    const real infbel1 = initValues.getInfbel1(), infbel2 = initValues.getInfbel2();
+    const real infbel3 = initValues.getInfbel3(), infbel4 = initValues.getInfbel4();
+
+    rowd = (1.0F - infdach) * vgd * kd * fbant * RDV;
+    row1 = (1.0F - infbel1) * (state.bl1 * kb * vgb * fbant + state.bls1 * ks * vgs * fsant) * R1V;
+    row2 = (1.0F - infbel2) * (state.bl2 * kb * vgb * fbant + state.bls2 * ks * vgs * fsant) * R2V;
+    row3 = (1.0F - infbel3) * (state.bl3 * kb * vgb * fbant + state.bls3 * ks * vgs * fsant) * R3V;
+    row4 = (1.0F - infbel4) * (state.bl4 * kb * vgb * fbant + state.bls4 * ks * vgs * fsant) * R4V;
+
+    // Infiltration for sealed surfaces
+    rid = (1 - kd) * vgd * fbant * RDV;
+    ri1 = (state.bl1 * vgb * fbant + state.bls1 * vgs * fsant) * R1V - row1;
+    ri2 = (state.bl2 * vgb * fbant + state.bls2 * vgs * fsant) * R2V - row2;
+    ri3 = (state.bl3 * vgb * fbant + state.bls3 * vgs * fsant) * R3V - row3;
+    ri4 = (state.bl4 * vgb * fbant + state.bls4 * vgs * fsant) * R4V - row4;
+
+    // consider unsealed road surfaces as pavement class 4
+    rowuvs = 0.0F;                   /* old: 0.11F * (1-vgs) * fsant * R4V; */
+    riuvs = (1 - vgs) * fsant * R4V; /* old: 0.89F * (1-vgs) * fsant * R4V; */
+
+    // runoff for unsealed surfaces rowuv = 0
+    riuv = (100.0F - (real) state.VER) / 100.0F * RUV;
+
+    // calculate runoff 'row' for entire block patial area (FLGES+STR_FLGES)
+    row = (row1 + row2 + row3 + row4 + rowd + rowuvs); // mm/a
+
+    // calculate volume 'rowvol' from runoff
+    result.rowvol = row * 3.171F * (state.fb + state.fs) / 100000.0F; // qcm/s
+
+    // calculate infiltration rate 'ri' for entire block partial area
+    ri = (ri1 + ri2 + ri3 + ri4 + rid + riuvs + riuv); // mm/a
+
+    // calculate volume 'rivol' from infiltration rate
+    result.rivol = ri * 3.171F * (state.fb + state.fs) / 100000.0F;   // qcm/s
+
+    // calculate total system losses 'r' due to runoff and infiltration for entire block partial area
+    r = row + ri;
+
+    // calculate volume of system losses 'rvol'due to runoff and infiltration
+    result.rvol = result.rowvol + result.rivol;
+
+    result.row = (float) row;
+    result.ri = (float) ri;
+    result.r = (float) r;
+
+    // calculate total area of building development area as well as roads area
+    result.flaeche = state.fb + state.fs;
+// cls_5b:
+    // calculate evaporation 'verdunst' by subtracting the sum of
+    // runoff and infiltration 'r' from precipitation of entire year
+    // 'regenja' multiplied by correction factor 'niedKorrFaktor'
+    result.verdunst = (float) (p - r);
+}
+
+// =============================================================================
+// Evaluate the blocks states[i], climates[i] for all i in order. A first pass
+// partitions the indices by usage class (keeping their order), then each
+// partition is calculated by the kernel of its class, see evaluatePartition().
+// The results are stored at the index of their block (results must have the
+// size of states).
+// =============================================================================
+void Calculation::evaluateBlocks(
+    const QVector<BlockState> &states, const QVector<BlockClimate> &climates,
+    const QVector<int> &order, QVector<BlockResult> &results
+)
+{
+    switch (precision) {
+    case Precision::doublePrecision:
+        evaluateBlocks<DoublePolicy>(states, climates, order, results);
+        break;
+    case Precision::fastFloat:
+        evaluateBlocks<FastFloatPolicy>(states, climates, order, results);
+        break;
+    default:
+        evaluateBlocks<LegacyFloatPolicy>(states, climates, order, results);
+    }
+}
+
+template <class P>
+void Calculation::evaluateBlocks(
+    const QVector<BlockState> &states, const QVector<BlockClimate> &climates,
+    const QVector<int> &order, QVector<BlockResult> &results
+)
+{
+    QVector<int> waterbodies;
+    QVector<int> forests;
+    QVector<int> others;
+
+    others.reserve(order.size());
+
+    for (int i = 0; i < order.size(); i++) {
+
+        int index = order.at(i);
+
+        switch (getKernelUsage(states.at(index).usage)) {
+        case Usage::waterbody_G:
+            waterbodies.append(index);
+            break;
+        case Usage::forested_W:
+            forests.append(index);
+            break;
+        default:
+            others.append(index);
+        }
+    }
+
+    evaluatePartition<P, Usage::waterbody_G>(states, climates, waterbodies, results);
+    evaluatePartition<P, Usage::forested_W>(states, climates, forests, results);
+    evaluatePartition<P, Usage::agricultural_L>(states, climates, others, results);
+}
+
+// Evaluate the blocks at the given indices, all of the usage class U
+template <class P, Usage U>
+void Calculation::evaluatePartition(
+    const QVector<BlockState> &states, const QVector<BlockClimate> &climates,
+    const QVector<int> &indices, QVector<BlockResult> &results
+)
+{
+    typename P::real ySealed[SEALED_CURVES];
+
+    for (int i = 0; i < indices.size(); i++) {
+
+        int index = indices.at(i);
+        const BlockClimate &climate = climates.at(index);
+
+        getSealedBagrovY<P>(climate, ySealed);
 
-    const float Ftab[] =
+        evaluateBlock<P, U>(states.at(index), climate, ySealed, results[index]);
+    }
+}
+
+// Usage class of the kernel for blocks of the given usage: waterbodies
+// (no Bagrov relation for the unsealed part), forests (no correction of bag
+// for missing summer values) and all others, represented by agricultural_L
+Usage Calculation::getKernelUsage(Usage usage)
+{
+    if (usage == Usage::waterbody_G || usage == Usage::forested_W) {
+        return usage;
+    }
+
+    return Usage::agricultural_L;
+}
+
+// =============================================================================
+// Evaluate one block for n years. Only precipitation differs between the
+// years, so the block state and the potential evaporation are reused.
+// =============================================================================
+void Calculation::evaluateSeries(
+    const BlockState &state, const BlockClimate &climate,
+    const float *regenja, const float *regenso, int n, BlockResult *results
+)
+{
+    switch (precision) {
+    case Precision::doublePrecision:
+        evaluateSeries<DoublePolicy>(state, climate, regenja, regenso, n, results);
+        break;
+    case Precision::fastFloat:
+        evaluateSeries<FastFloatPolicy>(state, climate, regenja, regenso, n, results);
+        break;
+    default:
+        evaluateSeries<LegacyFloatPolicy>(state, climate, regenja, regenso, n, results);
+    }
+}
+
+template <class P>
+void Calculation::evaluateSeries(
+    const BlockState &state, const BlockClimate &climate,
+    const float *regenja, const float *regenso, int n, BlockResult *results
+)
+{
+    typedef typename P::real real;
+
+    BlockClimate yearClimate = climate;
+
+    // y-factors of the sealed surfaces for all years, per surface class
+    QVector<real> xs(n);
+    QVector<real> ys(SEALED_CURVES * n);
+
+    for (int i = 0; i < n; i++) {
+        yearClimate.regenja = regenja[i];
+        xs[i] = getSealedBagrovX<P>(yearClimate);
+    }
+
+    for (int k = 0; k < SEALED_CURVES; k++) {
+        sealedCurves[k].evaluate<P>(xs.constData(), ys.data() + k * n, n);
+    }
+
+    real ySealed[SEALED_CURVES];
+
+    for (int i = 0; i < n; i++) {
+        yearClimate.regenja = regenja[i];
+        yearClimate.regenso = regenso[i];
+
+        for (int k = 0; k < SEALED_CURVES; k++) {
+            ySealed[k] = ys.at(k * n + i);
+        }
+
+        evaluateBlock<P>(state, yearClimate, ySealed, results[i]);
+    }
+}
+
+// =============================================================================
+// FIXME:
+// =============================================================================
+bool Calculation::getNUTZ(int nutz, int typ, int f30, int f150, QString code)
+{
+    // mittlere pot. kapillare Aufstiegsrate d. Sommerhalbjahres
+    float kr;
+
+    /*
+     * Tabellen iTAS und inFK_S, L, T, U (lookuptable.h)
+     */
+
+    // declaration of yield power (ERT) and irrigation (BER) for agricultural or gardening purposes
+    if (!setUsageYieldIrrigation(nutz, typ, code)) {
+        return false;
+    }
+
+    if (ptrDA.NUT != Usage::waterbody_G)
     {
-        0.65F, 0.75F, 0.82F, 0.90F, 1.00F, 1.06F, 1.15F, // 0 ..  6
-        1.22F, 1.30F, 1.38F, 1.47F, 1.55F, 1.63F, 1.70F  // 7 .. 13
-    };
+        /* pot. Aufstiegshoehe TAS = FLUR - mittl. Durchwurzelungstiefe TWS */
+        TAS = ptrDA.FLW - config.getTWS(ptrDA.ERT, ptrDA.NUT);
+
+        /* Feldkapazitaet */
+        /* cls_6b: der Fall der mit NULL belegten FELD_30 und FELD_150 Werte
+           wird hier im erten Fall behandelt - ich erwarte dann den Wert 0 */
+        ptrDA.nFK = PDR::estimateWaterHoldingCapacity(f30, f150, ptrDA.NUT == Usage::forested_W);
+
+        /*
+         * mittlere pot. kapillare Aufstiegsrate kr (mm/d) des Sommerhalbjahres ;
+         * switch (bod) { case S: case U: case L: case T: case LO: case HN: } wird
+         * eingefuegt, wenn die Bodenart in das Zahlenmaterial aufgenommen wird vorlaeufig
+         * wird Sande angenommen ;
+         * Sande
+         */
+        kr = (TAS <= 0.0) ?
+            7.0F :
+            ijkr_S.at(inFK_S.index(ptrDA.nFK), iTAS.index(TAS));
 
-    return Helpers::interpolate(wa, watab, Ftab, 14);
+        /* mittlere pot. kapillare Aufstiegsrate kr (mm/d) des Sommerhalbjahres */
+        ptrDA.KR = (int) (PDR::estimateDaysOfGrowth(ptrDA.NUT, ptrDA.ERT) * kr);
+    }
+
+    return true;
+}
+
+// =============================================================================
+// Force BER = 0 if requested in the configuration. This is not part of the
+// block state so that a compiled block model is independent of InitValues.
+// =============================================================================
+void Calculation::applyBERtoZero(BlockState &state)
+{
+    if (initValues.getBERtoZero() && state.irrigation != 0) {
+        //*protokollStream << "Erzwinge BER=0 fuer Code: " << code << ", Wert war:" << state.irrigation << " \r\n";
+        counters.totalBERtoZeroForced++;
+        state.irrigation = 0;
+    }
+}
+
+// Returns false (with error set) for an unknown usage
+bool Calculation::setUsageYieldIrrigation(int usage, int type, QString code)
+{
+    UsageResult result;
+
+    result = config.getUsageResult(usage, type, code);
+
+    if (result.tupleIndex < 0) {
+        finishProtocol();
+        protokollStream << result.message;
+        error = result.message;
+        return false;
+    }
+
+    if (result.assumedType >= 0) {
+        diagnostics.report(DiagnosticType::usageTypeUnknown, code, 0, result.assumedType);
+        counters.protcount++;
+    }
+
+    ptrDA.setUsageYieldIrrigation(config.getUsageTuple(result.tupleIndex));
+
+    return true;
+}
+
+// =============================================================================
+// Potential evaporation of the city district (for waterbodies: evaporation
+// of open water surfaces)
+// =============================================================================
+void Calculation::getKLIMA(int bez, QString code, Usage usage, BlockClimate &climate)
+{
+    // parameter for the city districts
+    if (usage == Usage::waterbody_G)
+    {
+        climate.ETP = districtValue(districtEG, bez, code, DiagnosticType::unknownEG);
+        climate.ETPS = 0;
+    }
+    else
+    {
+        climate.ETP = districtValue(districtETP, bez, code, DiagnosticType::unknownETP);
+        climate.ETPS = districtValue(districtETPS, bez, code, DiagnosticType::unknownETPS);
+    }
+}
+
+// Value of the district, the value of district 0 or the default value. The
+// missing value is reported once per district (with the first block as
+// example).
+int Calculation::districtValue(
+    DistrictValues &values, int bez, QString code, DiagnosticType type
+)
+{
+    int result = values.value(bez);
+
+    if (values.isDefaulted(bez) && values.markReported(bez)) {
+        diagnostics.report(type, code, bez, result);
+        counters.protcount++;
+    }
+
+    return result;
+}
+
+// Start of a run: the counters are reset and the values per district
+// compiled again (see initDistrictValues())
+void Calculation::startRun()
+{
+    counters.protcount = 0L;
+    counters.keineFlaechenAngegeben = 0L;
+    counters.nutzungIstNull = 0L;
+    notSelected = 0L;
+    initDistrictValues();
+}
+
+// Compile the values per district of initValues into dense arrays, this also
+// resets the districts reported by districtValue()
+void Calculation::initDistrictValues()
+{
+    districtETP.compile(initValues.hashETP, DEFAULT_ETP);
+    districtETPS.compile(initValues.hashETPS, DEFAULT_ETPS);
+    districtEG.compile(initValues.hashEG, DEFAULT_EG);
+}
+
+// =============================================================================
+// Get factor to be applied for "summer"
+// =============================================================================
+float Calculation::getSummerModificationFactor(float wa)
+{
+    return summerFactor.value(wa);
 }
 
 void Calculation::calculate(QString inputFile, QString configFile, QString outputFile, bool debug)
@@ -6,13 +6,46 @@
 #ifndef CALCULATION_H
 #define CALCULATION_H
 
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMap>
 #include <QObject>
+#include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QTextStream>
+#include <QVector>
 
+#include "bagrov.h"
 #include "dbaseReader.h"
 #include "initvalues.h"
 #include "config.h"
+#include "diagnosticsink.h"
+#include "districtvalues.h"
+#include "pdr.h"
+
+// minimum time in ms between two progress signals
+#define PROGRESS_INTERVAL 100
+
+// number of records calc() partitions and calculates at once (see
+// Calculation::evaluateBlocks()), only their states and results are kept
+#define CALCULATION_BATCH_SIZE (1 << 16)
+
+// potential evaporation [mm/a] of districts missing in the configuration
+// (if there is no entry for district 0 either)
+#define DEFAULT_ETP 660
+#define DEFAULT_ETPS 530
+#define DEFAULT_EG 775
+
+// number of sealed surface classes with an own Bagrov parameter: roofs and
+// pavement classes 1 to 4
+#define SEALED_CURVES 5
+
+class BlockModel;
+class RecordFilter;
+class ResultCache;
+struct ResultCacheKey;
+class DbaseWriter;
 
 struct Counters {
 
@@ -33,78 +66,258 @@ struct Counters {
     long protcount;
 };
 
+// Climate independent state of one block partial area. It only depends on
+// land use, soil and sealing inputs and is reused for any precipitation.
+// Its bytes are part of the keys of calcDeduplicated() and of the result
+// cache, so it has no implicit padding (which an assignment need not copy).
+struct BlockState {
+
+    // usage tuple (NUT, ERT, BER) and depth to groundwater table (FLW)
+    Usage usage;
+    char padding[3];
+    int yield;
+    int irrigation;
+    float FLW;
+
+    // water holding capacity, potential ascent TAS, capillary rise KR
+    float nFK;
+    float TAS;
+    int KR;
+
+    // effectiveness parameter of unsealed surfaces before any correction
+    // for (missing) summer values
+    float bag0;
+
+    // degree of sealing in percent of roof plus other sealed areas
+    int VER;
+
+    // sealing, canalization and pavement class shares (0..1)
+    float vgd, vgb, vgs;
+    float kd, kb, ks;
+    float bl1, bl2, bl3, bl4;
+    float bls1, bls2, bls3, bls4;
+
+    // areas of building development / roads and their shares of the total
+    float fb, fs;
+    float fbant, fsant;
+};
+
+static_assert(sizeof(BlockState) == 27 * 4, "BlockState has implicit padding");
+
+// Precipitation and potential evaporation for one block and one year
+struct BlockClimate {
+    float regenja;
+    float regenso;
+    int ETP;
+    int ETPS;
+};
+
+static_assert(sizeof(BlockClimate) == 4 * 4, "BlockClimate has implicit padding");
+
+// Results for one block and one year (mm/a, volumes in qcm/s)
+struct BlockResult {
+    float row;
+    float ri;
+    float r;
+    float rowvol;
+    float rivol;
+    float rvol;
+    float flaeche;
+    float verdunst;
+};
+
+// Changes of a previous result file (see Calculation::writeMerged())
+struct ResultChanges {
+    // new results by row of the previous result file
+    QMap<int, BlockResult> changed;
+
+    // rows of removed blocks
+    QSet<int> removed;
+
+    // new blocks, appended in this order
+    QStringList addedCodes;
+    QVector<BlockResult> added;
+};
+
+// Output modes of Calculation::calcSeries()
+enum struct SeriesOutput {
+    // one row per block and year
+    years,
+    // one row per block with mean, minimum and maximum over all years
+    statistics
+};
+
+// Values of the precipitation columns of calcSeries() that are not integers
+struct NonIntegerValues {
+    long count;
+    // the first of them, for the protocol
+    QString example;
+};
+
 class Calculation: public QObject
 {
     Q_OBJECT
 
 public:
     Calculation(DbaseReader & dbR, InitValues & init, QTextStream & protoStream);
+    Calculation(InitValues & init, QTextStream & protoStream);
     bool calc(QString fileOut, bool debug = false);
+    bool calcSeries(QString fileOut, SeriesOutput mode, bool debug = false);
+    bool compile(QString fileOut, bool debug = false);
+    bool calcModel(BlockModel &model, QString fileOut);
+    bool calcDelta(DbaseReader &delta, DbaseReader &previousOutput, QString fileOut, bool debug = false);
+    bool calcConfigChange(InitValues &previousValues, DbaseReader &previousOutput, QString fileOut, bool debug = false);
+    bool calcRecord(abimoRecord &record, BlockResult &result);
     long getProtCount();
     long getKeineFlaechenAngegeben();
     long getNutzungIstNull();
     Counters getCounters();
     QString getError();
     void stop();
+    void setDeduplicate(bool value);
+    void setWarmStart(bool value);
+    void setPrecision(Precision value);
+    void setDiagnosticMode(DiagnosticMode mode, int maxExamples = 10);
+    void setResultCache(ResultCache *cache);
+    void setFilter(const RecordFilter *value);
     static void calculate(QString inputFile, QString configFile, QString outputFile, bool debug = false);
 
 signals:
     void processSignal(int, QString);
 
 private:
-    Config *config;
-    const static float iTAS[];
-    const static float inFK_S[];
-    const static float ijkr_S[];
+    Config config;
     InitValues & initValues;
     QTextStream & protokollStream;
-    DbaseReader & dbReader;
+
+    // messages reported per block, written to protokollStream
+    DiagnosticSink diagnostics;
+
+    DbaseReader *dbReader;
     PDR ptrDA;
     QString error;
 
-    // ******vorlaeufig aus Teilblock 0 wird fuer die Folgeblocks genommen
-    float regenja, regenso;
+    // potentielle Aufstiegshoehe
+    float TAS;
 
-    // Abfluesse nach Bagrov fuer N1 bis N4
-    float RDV, R1V, R2V, R3V, R4V;
+    // ETP, ETPS and EG per district (see initDistrictValues())
+    DistrictValues districtETP;
+    DistrictValues districtETPS;
+    DistrictValues districtEG;
 
-    float RUV;
+    Counters counters;
 
-    // Regenwasserabfluss in Qubikzentimeter pro Sekunde
-    float ROWVOL;
+    // Bagrov solvers for the sealed and the unsealed surfaces, they count
+    // the calls and iterations of their procedures
+    Bagrov bagrov;
+    Bagrov unsealedBagrov;
 
-    // unterirdischer Gesamtabfluss in qcm/s
-    float RIVOL;
+    // Bagrov relation of the roofs (0) and pavement classes 1 to 4, the
+    // parameters bagdach, bagbel1..4 are constant for a run
+    BagrovCurve sealedCurves[SEALED_CURVES];
 
-    // Gesamtabfluss in qcm/s
-    float RVOL;
+    // to stop calc (set by stop(), possibly from another thread)
+    QAtomicInt weiter;
 
-    // potentielle Aufstiegshoehe
-    float TAS;
+    // time of the last progress signal
+    QElapsedTimer progressTimer;
 
-    // Feldlaenge von iTAS
-    int lenTAS;
+    // calculate identical parameter tuples only once
+    bool deduplicate;
 
-    // Feldlaenge von inFK_S
-    int lenS;
+    // sort the blocks and start the Bagrov iterations at the previous solution
+    bool warmStart;
 
-    Counters counters;
+    // arithmetic of evaluateBlock()
+    Precision precision;
 
-    // to stop calc
-    bool weiter;
+    // results of blocks calculated before (optional, see setResultCache())
+    ResultCache *resultCache;
+
+    // selection of the records to calculate (optional, see setFilter()) and
+    // number of records not selected in the current run
+    const RecordFilter *filter;
+    long notSelected;
 
     // functions
+    bool calcDeduplicated(QString fileOut, bool debug);
+    void calcBatch(
+        DbaseWriter &writer, QVector<BlockState> &states, QVector<BlockClimate> &climates,
+        QVector<int> &codes
+    );
+    bool isSelected(int k);
+    bool isPreviousResult(DbaseReader &previousOutput);
+    void evaluateCached(BlockState &state, BlockClimate &climate, BlockResult &result);
+    bool usesResultCache();
+    void fillCacheKey(const BlockState &state, const BlockClimate &climate, ResultCacheKey &key);
+    static void setVolumes(BlockResult &result, float area);
+    bool writeMerged(DbaseReader &previousOutput, ResultChanges &changes, QString fileOut);
     float getNUV(PDR &B);
     float getSummerModificationFactor(float wa);
     float getG02 (int nFK);
-    void getNUTZ(int nutz, int typ, int f30, int f150, QString code);
-    void setUsageYieldIrrigation(int usage, int type, QString code);
+    bool getNUTZ(int nutz, int typ, int f30, int f150, QString code);
+    bool setUsageYieldIrrigation(int usage, int type, QString code);
     void logNotDefined(QString code, int type);
-    void getKLIMA(int bez, QString codestr);
-    float initValueOrReportedDefaultValue(
-        int bez, QString code, QHash<int, int> &hash, int defaultValue,
-        QString name
+    void finishProtocol();
+    bool writeResults(DbaseWriter &writer);
+    bool progressDue();
+    bool fillBlockState(abimoRecord &record, BlockState &state);
+    void applyBERtoZero(BlockState &state);
+    void writeResultRecord(DbaseWriter &writer, QString code, BlockResult &result);
+    void writeResultRecord(DbaseWriter &writer, const CodeArena &codes, int id, BlockResult &result);
+    void writeResultValues(DbaseWriter &writer, BlockResult &result);
+    void writeMemoryStatistics(const DbaseWriter &writer);
+    void getKLIMA(int bez, QString codestr, Usage usage, BlockClimate &climate);
+    void initSealedCurves();
+    template <class P> typename P::real getSealedBagrovX(const BlockClimate &climate);
+    template <class P> void getSealedBagrovY(
+        const BlockClimate &climate, typename P::real *ySealed
+    );
+    template <class P> void getUnsealedBagrovInput(
+        const BlockState &state, const BlockClimate &climate,
+        typename P::real &bag, typename P::real &x
+    );
+    template <class P, Usage U> void getUnsealedBagrovInput(
+        const BlockState &state, const BlockClimate &climate,
+        typename P::real &bag, typename P::real &x
+    );
+    void evaluateBlock(const BlockState &state, const BlockClimate &climate, BlockResult &result);
+    template <class P> void evaluateBlock(
+        const BlockState &state, const BlockClimate &climate, BlockResult &result
+    );
+    template <class P> void evaluateBlock(
+        const BlockState &state, const BlockClimate &climate, const typename P::real *ySealed,
+        BlockResult &result
+    );
+    template <class P, Usage U> void evaluateBlock(
+        const BlockState &state, const BlockClimate &climate, const typename P::real *ySealed,
+        BlockResult &result
+    );
+    void evaluateBlocks(
+        const QVector<BlockState> &states, const QVector<BlockClimate> &climates,
+        const QVector<int> &order, QVector<BlockResult> &results
+    );
+    template <class P> void evaluateBlocks(
+        const QVector<BlockState> &states, const QVector<BlockClimate> &climates,
+        const QVector<int> &order, QVector<BlockResult> &results
+    );
+    template <class P, Usage U> void evaluatePartition(
+        const QVector<BlockState> &states, const QVector<BlockClimate> &climates,
+        const QVector<int> &indices, QVector<BlockResult> &results
+    );
+    static Usage getKernelUsage(Usage usage);
+    void evaluateSeries(
+        const BlockState &state, const BlockClimate &climate,
+        const float *regenja, const float *regenso, int n, BlockResult *results
+    );
+    template <class P> void evaluateSeries(
+        const BlockState &state, const BlockClimate &climate,
+        const float *regenja, const float *regenso, int n, BlockResult *results
     );
+    float getSeriesValue(int k, int field, const QString &code, NonIntegerValues &nonInteger);
+    int districtValue(DistrictValues &values, int bez, QString code, DiagnosticType type);
+    void startRun();
+    void initDistrictValues();
 };
 
 #endif
@@ -0,0 +1,174 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QString>
+#include <QTextStream>
+
+#include "calculation.h"
+#include "calculationworker.h"
+#include "dbaseReader.h"
+#include "helpers.h"
+#include "initvalues.h"
+
+CalculationWorker::CalculationWorker(QString inputFile, QString configFile, QString outputFile):
+    QObject(),
+    inputFile(inputFile),
+    configFile(configFile),
+    outputFile(outputFile),
+    calc(0),
+    cancelled(false)
+{
+}
+
+// Called from the GUI thread
+void CalculationWorker::stop()
+{
+    QMutexLocker locker(&mutex);
+
+    cancelled = true;
+
+    if (calc != 0) {
+        calc->stop();
+    }
+}
+
+bool CalculationWorker::isCancelled()
+{
+    QMutexLocker locker(&mutex);
+    return cancelled;
+}
+
+void CalculationWorker::run()
+{
+    emit processSignal(0, "Lese Datei.");
+
+    // Open a DBASE File
+    DbaseReader dbReader(inputFile);
+
+    if (! dbReader.checkAndRead()) {
+        emit finished(false, false, dbReader.getFullError());
+        return;
+    }
+
+    if (isCancelled()) {
+        emit finished(true, true, QString());
+        return;
+    }
+
+    // Update default initial values with values given in config.xml
+    InitValues initValues;
+    QString errorMessage = InitValues::updateFromConfig(initValues, configFile);
+
+    if (! errorMessage.isEmpty()) {
+        emit warning(errorMessage);
+    }
+
+    // Protokoll
+    QString protokollFileName = Helpers::defaultLogFileName(outputFile);
+
+    QFile protokollFile(protokollFileName);
+
+    if (! protokollFile.open(QFile::WriteOnly)) {
+        emit finished(false, false,
+            "Konnte Datei: " + Helpers::singleQuote(protokollFileName) +
+            " nicht oeffnen.\n" + protokollFile.error()
+        );
+        return;
+    }
+
+    QTextStream protokollStream(&protokollFile);
+
+    // Start the Calculation
+    protokollStream << "Start der Berechnung " + Helpers::nowString() + "\r\n";
+
+    // Create calculator object
+    Calculation calculation(dbReader, initValues, protokollStream);
+
+    connect(
+        &calculation,
+        SIGNAL(processSignal(int, QString)),
+        this,
+        SIGNAL(processSignal(int, QString))
+    );
+
+    mutex.lock();
+    calc = &calculation;
+    if (cancelled) {
+        calc->stop();
+    }
+    mutex.unlock();
+
+    // Do the calculation
+    bool success = calculation.calc(outputFile);
+
+    mutex.lock();
+    calc = 0;
+    mutex.unlock();
+
+    // Report about success or failure
+    if (! success) {
+        emit finished(false, false, calculation.getError());
+    }
+    else if (isCancelled()) {
+        emit finished(true, true, QString());
+    }
+    else {
+        emit finished(true, false, reportSuccess(
+            calculation.getCounters(), protokollStream, protokollFileName
+        ));
+    }
+
+    protokollFile.close();
+}
+
+QString CalculationWorker::reportSuccess(
+    Counters counters,
+    QTextStream &protokollStream,
+    QString protokollFileName
+)
+{
+    QString protCount;
+    QString nutzungIstNull;
+    QString keineFlaechenAngegeben;
+    QString readRecCount;
+    QString writeRecCount;
+
+    protCount.setNum(counters.protcount);
+    nutzungIstNull.setNum(counters.nutzungIstNull);
+    keineFlaechenAngegeben.setNum(counters.keineFlaechenAngegeben);
+    readRecCount.setNum(counters.totalRecRead);
+    writeRecCount.setNum(counters.totalRecWrite);
+
+    protokollStream << "\r\nBei der Berechnung traten " << protCount <<
+        " Fehler auf.\r\n";
+
+    if (counters.keineFlaechenAngegeben != 0) {
+        protokollStream << "\r\nBei " + keineFlaechenAngegeben +
+            " Flaechen deren Wert 0 war wurde 100 eingesetzt.\r\n";
+    }
+
+    if (counters.nutzungIstNull != 0) {
+        protokollStream << "\r\nBei " + nutzungIstNull +
+            " Records war die Nutzung 0, diese wurden ignoriert.\r\n";
+    }
+
+    if (counters.totalBERtoZeroForced != 0) {
+        protokollStream << "\r\nBei " << counters.totalBERtoZeroForced <<
+            " Records wurde BER==0 erzwungen.\r\n";
+    }
+
+    protokollStream << "\r\nEingelesene Records: " + readRecCount + "\r\n";
+    protokollStream << "\r\nGeschriebene Records: " + writeRecCount + "\r\n";
+    protokollStream << "\r\nEnde der Berechnung " + Helpers::nowString() + "\r\n";
+
+    return
+        "Berechnungen mit " + protCount + " Fehlern beendet.\n" +
+        "Eingelesene Records: " + readRecCount +"\n" +
+        "Geschriebene Records: " + writeRecCount +"\n" +
+        "Ergebnisse in Datei: '" + outputFile + "' geschrieben.\n" +
+        "Protokoll in Datei: '" + protokollFileName + "' geschrieben.";
+}
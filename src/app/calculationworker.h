@@ -0,0 +1,51 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef CALCULATIONWORKER_H
+#define CALCULATIONWORKER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTextStream>
+
+#include "calculation.h"
+
+// Reads the input file and runs the calculation for the GUI. The worker is
+// moved to its own thread, run() is started by QThread::started(). All
+// signals are delivered (queued) to the GUI thread.
+class CalculationWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    CalculationWorker(QString inputFile, QString configFile, QString outputFile);
+    void stop();
+
+public slots:
+    void run();
+
+signals:
+    void processSignal(int, QString);
+    void warning(QString);
+
+    // text: summary of the calculation or error message
+    void finished(bool success, bool cancelled, QString text);
+
+private:
+    QString inputFile;
+    QString configFile;
+    QString outputFile;
+
+    // protects calc and cancelled, stop() is called from the GUI thread
+    QMutex mutex;
+    Calculation *calc;
+    bool cancelled;
+
+    bool isCancelled();
+    QString reportSuccess(Counters counters, QTextStream &protokollStream, QString protokollFileName);
+};
+
+#endif
@@ -0,0 +1,126 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <string.h> // for memcmp()
+
+#include "codearena.h"
+
+CodeArena::CodeArena():
+    maxLength(0)
+{
+}
+
+void CodeArena::reserve(int n, int bytes)
+{
+    offsets.reserve(n);
+    lengths.reserve(n);
+    this->bytes.reserve(bytes);
+}
+
+// Append a code and return its id
+int CodeArena::add(const char *data, int length)
+{
+    offsets.append(bytes.size());
+    lengths.append(length);
+    bytes.append(data, length);
+
+    if (length > maxLength) {
+        maxLength = length;
+    }
+
+    return offsets.size() - 1;
+}
+
+int CodeArena::size() const
+{
+    return offsets.size();
+}
+
+void CodeArena::clear()
+{
+    bytes.clear();
+    offsets.clear();
+    lengths.clear();
+    maxLength = 0;
+}
+
+const char *CodeArena::getData(int id) const
+{
+    return bytes.constData() + offsets.at(id);
+}
+
+quint32 CodeArena::getOffset(int id) const
+{
+    return offsets.at(id);
+}
+
+const QByteArray &CodeArena::getBuffer() const
+{
+    return bytes;
+}
+
+int CodeArena::getLength(int id) const
+{
+    return lengths.at(id);
+}
+
+int CodeArena::getMaxLength() const
+{
+    return maxLength;
+}
+
+qint64 CodeArena::getBytes() const
+{
+    return bytes.size() + (qint64) offsets.size() * 2 * sizeof(quint32);
+}
+
+QString CodeArena::getString(int id) const
+{
+    return QString::fromUtf8(getData(id), getLength(id));
+}
+
+// string = getString(id), written into the buffer of string if it is not
+// shared and large enough (no allocation for the codes of a whole file)
+void CodeArena::assignTo(int id, QString &string) const
+{
+    if (!isAscii(id)) {
+        string = getString(id);
+        return;
+    }
+
+    const char *data = getData(id);
+    int length = getLength(id);
+
+    string.resize(length);
+    QChar *chars = string.data();
+
+    for (int i = 0; i < length; i++) {
+        chars[i] = QLatin1Char(data[i]);
+    }
+}
+
+bool CodeArena::isAscii(int id) const
+{
+    const char *data = getData(id);
+
+    for (int i = 0; i < getLength(id); i++) {
+        if ((quint8) data[i] >= 0x80) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int CodeArena::compare(const char *a, int lengthA, const char *b, int lengthB)
+{
+    int order = memcmp(a, b, qMin(lengthA, lengthB));
+
+    if (order != 0) {
+        return order;
+    }
+
+    return lengthA - lengthB;
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef CODEARENA_H
+#define CODEARENA_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Block codes (CODE) stored once in one contiguous buffer, as raw bytes of
+// the dbf file. A code is identified by its index (the record number when
+// filled by DbaseReader). DbaseWriter copies the bytes of a code directly
+// into the CODE field of the output (see DbaseWriter::setRecordCode()).
+class CodeArena
+{
+public:
+    CodeArena();
+    void reserve(int n, int bytes);
+    int add(const char *data, int length);
+    int size() const;
+    void clear();
+
+    const char *getData(int id) const;
+    int getLength(int id) const;
+    int getMaxLength() const;
+    qint64 getBytes() const;
+
+    // all codes one after another, code id starts at getOffset(id)
+    const QByteArray &getBuffer() const;
+    quint32 getOffset(int id) const;
+
+    // the code as QString (UTF-8, as the dbf values were read before)
+    QString getString(int id) const;
+    void assignTo(int id, QString &string) const;
+
+    // all bytes below 0x80, i.e. the same in UTF-8 and Latin-1
+    bool isAscii(int id) const;
+
+    // byte-wise order of two codes (a prefix comes first), < 0, 0 or > 0
+    static int compare(const char *a, int lengthA, const char *b, int lengthB);
+
+private:
+    QByteArray bytes;
+    QVector<quint32> offsets;
+    QVector<quint32> lengths;
+    int maxLength;
+};
+
+#endif // CODEARENA_H
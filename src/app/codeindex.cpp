@@ -0,0 +1,303 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <algorithm> // for std::stable_sort()
+#include <string.h> // for memcpy(), strncmp()
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+
+#include "codeindex.h"
+#include "dbaseReader.h"
+
+CodeIndex::CodeIndex(const QString &dbfFileName):
+    dbfFileName(dbfFileName),
+    file(indexFileName(dbfFileName)),
+    data(0),
+    header(0),
+    entries(0),
+    codes(0)
+{}
+
+CodeIndex::~CodeIndex()
+{
+    close();
+}
+
+QString CodeIndex::getError()
+{
+    return error;
+}
+
+QString CodeIndex::indexFileName(const QString &dbfFileName)
+{
+    return dbfFileName + ".codeindex";
+}
+
+// Map the index, build it first if it is missing or out of date (and build
+// is true)
+bool CodeIndex::open(bool build)
+{
+    close();
+
+    if (file.exists() && map() && isCurrent()) {
+        return true;
+    }
+
+    close();
+
+    if (!build) {
+        if (error.isEmpty()) {
+            error = "Index passt nicht zur Datei '" + dbfFileName + "'.";
+        }
+        return false;
+    }
+
+    error.clear();
+
+    if (!CodeIndex::build(dbfFileName, error)) {
+        return false;
+    }
+
+    return map();
+}
+
+bool CodeIndex::map()
+{
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = "Kann die Datei nicht oeffnen\n" + file.errorString();
+        return false;
+    }
+
+    qint64 size = file.size();
+
+    if (size < (qint64) sizeof(CodeIndexHeader)) {
+        error = "Datei unbekannten Formats.";
+        file.close();
+        return false;
+    }
+
+    data = file.map(0, size);
+
+    if (data == 0) {
+        error = "Kann die Datei nicht in den Speicher abbilden\n" + file.errorString();
+        file.close();
+        return false;
+    }
+
+    header = reinterpret_cast<const CodeIndexHeader*>(data);
+
+    if (strncmp(header->magic, CODEINDEX_MAGIC, sizeof(header->magic)) != 0) {
+        error = "Datei ist kein CODE-Index.";
+        close();
+        return false;
+    }
+
+    if (
+        header->version != CODEINDEX_VERSION ||
+        header->entrySize != sizeof(CodeIndexEntry)
+    ) {
+        error = "CODE-Index wurde mit einer anderen Programmversion erstellt.";
+        close();
+        return false;
+    }
+
+    qint64 expectedSize = sizeof(CodeIndexHeader) +
+        (qint64) header->numberOfEntries * sizeof(CodeIndexEntry) +
+        (qint64) header->codeAreaSize;
+
+    if (size != expectedSize) {
+        error = "CODE-Index unbekannten Formats, falsche Groesse.";
+        close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const CodeIndexEntry*>(data + sizeof(CodeIndexHeader));
+    codes = reinterpret_cast<const char*>(entries + header->numberOfEntries);
+
+    return true;
+}
+
+// The dbf file was not changed since the index was written (e.g. by
+// DbaseWriter::patch())
+bool CodeIndex::isCurrent()
+{
+    QFileInfo info(dbfFileName);
+
+    return info.exists() &&
+        info.size() == header->dbfSize &&
+        info.lastModified().toMSecsSinceEpoch() == header->dbfModified;
+}
+
+void CodeIndex::close()
+{
+    if (data != 0) {
+        file.unmap(data);
+        data = 0;
+    }
+
+    header = 0;
+    entries = 0;
+    codes = 0;
+
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+int CodeIndex::getNumberOfEntries()
+{
+    return (header == 0) ? 0 : (int) header->numberOfEntries;
+}
+
+// Number of the (first) record with the given CODE, -1 if there is none. The
+// code is compared with the trimmed bytes of the field (see
+// DbaseReader::getCodes()).
+int CodeIndex::find(const char *code, int length)
+{
+    int low = 0;
+    int high = getNumberOfEntries();
+
+    // first entry not less than code
+    while (low < high) {
+
+        int middle = low + (high - low) / 2;
+        const CodeIndexEntry &entry = entries[middle];
+
+        if (CodeArena::compare(codes + entry.codeOffset, entry.codeLength, code, length) < 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if (low == getNumberOfEntries()) {
+        return -1;
+    }
+
+    const CodeIndexEntry &entry = entries[low];
+
+    if (CodeArena::compare(codes + entry.codeOffset, entry.codeLength, code, length) != 0) {
+        return -1;
+    }
+
+    return (int) entry.record;
+}
+
+int CodeIndex::find(const QByteArray &code)
+{
+    return find(code.constData(), code.size());
+}
+
+// Read the codes of the dbf file and write its index
+bool CodeIndex::build(const QString &dbfFileName, QString &error)
+{
+    DbaseReader reader(dbfFileName);
+
+    if (!reader.read()) {
+        error = reader.getError();
+        return false;
+    }
+
+    if (reader.getFieldIndex("CODE") < 0) {
+        error = "Datei '" + dbfFileName + "' hat kein Feld CODE.";
+        return false;
+    }
+
+    return write(dbfFileName, reader.getCodes(), error);
+}
+
+// Write the index of a dbf file, the code with id i is the CODE of record i.
+// The dbf file must be complete (its size and time are stored).
+bool CodeIndex::write(const QString &dbfFileName, const CodeArena &codes, QString &error)
+{
+    return write(dbfFileName, codes, QVector<int>(), error);
+}
+
+// Same with the code with id ids[i] as CODE of record i. The code area is
+// the buffer of the arena as it is (see CodeArena::getBuffer()), codes not
+// referred to by ids stay unused.
+bool CodeIndex::write(
+    const QString &dbfFileName, const CodeArena &codes, const QVector<int> &ids,
+    QString &error
+)
+{
+    QFileInfo info(dbfFileName);
+
+    if (!info.exists()) {
+        error = "Datei '" + dbfFileName + "' nicht gefunden.";
+        return false;
+    }
+
+    CodeIndexHeader header;
+
+    memcpy(header.magic, CODEINDEX_MAGIC, sizeof(header.magic));
+    header.version = CODEINDEX_VERSION;
+    header.entrySize = sizeof(CodeIndexEntry);
+    header.numberOfEntries = ids.isEmpty() ? codes.size() : ids.size();
+    header.reserved = 0;
+    header.dbfSize = info.size();
+    header.dbfModified = info.lastModified().toMSecsSinceEpoch();
+
+    QVector<CodeIndexEntry> entries(header.numberOfEntries);
+    const QByteArray &area = codes.getBuffer();
+
+    for (int i = 0; i < entries.size(); i++) {
+        int id = ids.isEmpty() ? i : ids.at(i);
+        entries[i].record = i;
+        entries[i].codeOffset = codes.getOffset(id);
+        entries[i].codeLength = codes.getLength(id);
+    }
+
+    header.codeAreaSize = area.size();
+
+    // stable: of equal codes the first record is found
+    const char *bytes = area.constData();
+
+    std::stable_sort(
+        entries.begin(), entries.end(),
+        [bytes](const CodeIndexEntry &a, const CodeIndexEntry &b) {
+            return CodeArena::compare(
+                bytes + a.codeOffset, a.codeLength, bytes + b.codeOffset, b.codeLength
+            ) < 0;
+        }
+    );
+
+    QFile out(indexFileName(dbfFileName));
+
+    if (!out.open(QIODevice::WriteOnly)) {
+        error = "kann Out-Datei: '" + out.fileName() + "' nicht oeffnen\n Grund: " +
+            out.errorString();
+        return false;
+    }
+
+    qint64 entriesSize = (qint64) entries.size() * sizeof(CodeIndexEntry);
+
+    bool ok =
+        out.write(reinterpret_cast<const char*>(&header), sizeof(CodeIndexHeader)) ==
+            (qint64) sizeof(CodeIndexHeader) &&
+        out.write(reinterpret_cast<const char*>(entries.constData()), entriesSize) ==
+            entriesSize &&
+        out.write(area) == area.size() &&
+        out.flush();
+
+    if (!ok) {
+        error = "Fehler beim Schreiben in: '" + out.fileName() + "'\n Grund: " +
+            out.errorString();
+        out.close();
+        out.remove();
+        return false;
+    }
+
+    out.close();
+
+    return true;
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef CODEINDEX_H
+#define CODEINDEX_H
+
+#include <limits.h> // for INT_MAX
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "codearena.h"
+
+// A code index is a sidecar file of a dbf file (<dbf>.codeindex) mapping the
+// values of the field CODE to record numbers. It consists of a
+// CodeIndexHeader, numberOfEntries CodeIndexEntry structures sorted by code
+// (see CodeArena::compare()) and an area with the codes as raw bytes of the
+// dbf file. As a compiled block model (see BlockModel) it is stored in the
+// byte order of the machine that wrote it and memory mapped when it is used,
+// a lookup is a binary search without parsing. The index is written with the
+// result file (see DbaseWriter::write()) or built on first use, it is built
+// again if the size or the modification time of the dbf file have changed.
+
+#define CODEINDEX_MAGIC "ABIMOCI"
+#define CODEINDEX_VERSION 1
+
+struct CodeIndexHeader {
+    char magic[8];
+    quint32 version;
+
+    // size of one CodeIndexEntry, changes if the layout changes
+    quint32 entrySize;
+
+    // number of records of the dbf file
+    quint32 numberOfEntries;
+    quint32 reserved;
+
+    // size and modification time (ms since epoch) of the indexed dbf file
+    qint64 dbfSize;
+    qint64 dbfModified;
+
+    // size of the area holding the CODE strings
+    quint64 codeAreaSize;
+};
+
+struct CodeIndexEntry {
+    quint32 record;
+
+    // position of CODE within the code area
+    quint32 codeOffset;
+    quint32 codeLength;
+};
+
+// number of records an index can hold (its entries are sorted in memory)
+#define CODEINDEX_MAX_ENTRIES ((int) (INT_MAX / sizeof(CodeIndexEntry)))
+
+class CodeIndex
+{
+
+public:
+    CodeIndex(const QString &dbfFileName);
+    ~CodeIndex();
+    bool open(bool build = true);
+    void close();
+    QString getError();
+    int getNumberOfEntries();
+    int find(const char *code, int length);
+    int find(const QByteArray &code);
+    static QString indexFileName(const QString &dbfFileName);
+    static bool build(const QString &dbfFileName, QString &error);
+    static bool write(const QString &dbfFileName, const CodeArena &codes, QString &error);
+    static bool write(
+        const QString &dbfFileName, const CodeArena &codes, const QVector<int> &ids,
+        QString &error
+    );
+
+private:
+    QString dbfFileName;
+    QFile file;
+    QString error;
+    uchar* data;
+    const CodeIndexHeader* header;
+    const CodeIndexEntry* entries;
+    const char* codes;
+
+    bool map();
+    bool isCurrent();
+};
+
+#endif // CODEINDEX_H
@@ -195,32 +195,33 @@ float Config::getTWS(int ert, Usage nutz)
 
 UsageResult Config::getUsageResult(int usage, int type, QString code)
 {
-    if (!usageHash.contains(usage)) {
+    QHash<int,QHash<int,int>>::const_iterator types = usageHash.constFind(usage);
+
+    if (types == usageHash.constEnd()) {
         return {
-            -1,
+            -1, -1,
             QString("\r\nDiese  Meldung sollte nie erscheinen: \r\n") +
                 "Nutzung nicht definiert fuer Element " + code + "\r\n"
         };
     }
 
-    return lookup(usageHash[usage], type, code);
+    return lookup(types.value(), type);
 }
 
-UsageResult Config::lookup(QHash<int,int>hash, int type, QString code)
+// The hash is only read (a non-const copy would be detached for each block)
+UsageResult Config::lookup(const QHash<int,int> &hash, int type)
 {
     if (hash.contains(type)) {
-        return {hash[type], ""};
+        return {hash.value(type), -1, QString()};
     }
 
     if (hash.contains(-1)) {
-        int defaultType = hash[-1];
-        QString message = "\r\nNutzungstyp nicht definiert fuer Element " +
-            code + "\r\nTyp=" + QString::number(defaultType) +
-            " angenommen\r\n";
-        return {hash[defaultType], message};
+        // the message is rendered by the caller (see DiagnosticSink)
+        int defaultType = hash.value(-1);
+        return {hash.value(defaultType), defaultType, QString()};
     }
 
-    return {hash[-2], ""};
+    return {hash.value(-2), -1, QString()};
 }
 
 UsageTuple Config::getUsageTuple(int tupleID)
@@ -4,7 +4,14 @@
 #include <QHash>
 #include <QString>
 
-#include "pdr.h" // for MainUsage, UsageResult, UsageTuple
+#include "pdr.h" // for Usage, UsageTuple
+
+struct UsageResult {
+    int tupleIndex;
+    // type that was assumed for an undefined usage type (-1: none)
+    int assumedType;
+    QString message;
+};
 
 class Config
 {
@@ -23,7 +30,7 @@ private:
     void initUsageYieldIrrigationTuples();
     void initUsageAndTypeToTupleHash();
 
-    UsageResult lookup(QHash<int,int>hash, int type, QString code);
+    UsageResult lookup(const QHash<int,int> &hash, int type);
 };
 
 #endif // CONFIG_H
@@ -0,0 +1,136 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include "calculation.h"
+#include "configdiff.h"
+
+ConfigDiff::ConfigDiff(InitValues &before, InitValues &after):
+    before(before),
+    after(after),
+    all(false),
+    roof(false),
+    unsealedRoads(false),
+    irrigation(false)
+{
+    for (int i = 0; i < 4; i++) {
+        pavement[i] = false;
+    }
+
+    compare("infdach", before.getInfdach(), after.getInfdach(), roof);
+    compare("bagdach", before.getBagdach(), after.getBagdach(), roof);
+    compare("infbel1", before.getInfbel1(), after.getInfbel1(), pavement[0]);
+    compare("infbel2", before.getInfbel2(), after.getInfbel2(), pavement[1]);
+    compare("infbel3", before.getInfbel3(), after.getInfbel3(), pavement[2]);
+    compare("infbel4", before.getInfbel4(), after.getInfbel4(), pavement[3]);
+    compare("bagbel1", before.getBagbel1(), after.getBagbel1(), pavement[0]);
+    compare("bagbel2", before.getBagbel2(), after.getBagbel2(), pavement[1]);
+    compare("bagbel3", before.getBagbel3(), after.getBagbel3(), pavement[2]);
+    compare("bagbel4", before.getBagbel4(), after.getBagbel4(), pavement[3]);
+    compare("BERtoZero", before.getBERtoZero(), after.getBERtoZero(), irrigation);
+    compare("niedKorrF", before.getNiedKorrF(), after.getNiedKorrF(), all);
+    compare("decR", before.getDecR(), after.getDecR(), all);
+    compare("decROW", before.getDecROW(), after.getDecROW(), all);
+    compare("decRI", before.getDecRI(), after.getDecRI(), all);
+    compare("decRVOL", before.getDecRVOL(), after.getDecRVOL(), all);
+    compare("decROWVOL", before.getDecROWVOL(), after.getDecROWVOL(), all);
+    compare("decRIVOL", before.getDecRIVOL(), after.getDecRIVOL(), all);
+    compare("decFLAECHE", before.getDecFLAECHE(), after.getDecFLAECHE(), all);
+    compare("decVERDUNSTUNG", before.getDecVERDUNSTUNG(), after.getDecVERDUNSTUNG(), all);
+
+    // the runoff of pavement class 4 is also used for the unsealed part of roads
+    unsealedRoads = before.getBagbel4() != after.getBagbel4();
+
+    if (before.hashETP != after.hashETP) changes << "ETP";
+    if (before.hashETPS != after.hashETPS) changes << "ETPS";
+    if (before.hashEG != after.hashEG) changes << "EG";
+}
+
+bool ConfigDiff::isEmpty()
+{
+    return changes.isEmpty();
+}
+
+bool ConfigDiff::affectsAll()
+{
+    return all;
+}
+
+QStringList ConfigDiff::getChanges()
+{
+    return changes;
+}
+
+bool ConfigDiff::affects(const abimoRecord &record)
+{
+    if (all) {
+        return true;
+    }
+
+    if (roof && record.PROBAU_fraction != 0) {
+        return true;
+    }
+
+    const float shares[4][2] = {
+        {record.BELAG1_fraction, record.STR_BELAG1_fraction},
+        {record.BELAG2_fraction, record.STR_BELAG2_fraction},
+        {record.BELAG3_fraction, record.STR_BELAG3_fraction},
+        {record.BELAG4_fraction, record.STR_BELAG4_fraction}
+    };
+
+    for (int i = 0; i < 4; i++) {
+        if (pavement[i] && (shares[i][0] != 0 || shares[i][1] != 0)) {
+            return true;
+        }
+    }
+
+    if (unsealedRoads && record.STR_FLGES != 0 && record.VGSTRASSE_fraction < 1) {
+        return true;
+    }
+
+    UsageResult usageResult = config.getUsageResult(record.NUTZUNG, record.TYP, record.CODE);
+
+    // unknown usage: calculate, the calculation reports the error
+    if (usageResult.tupleIndex < 0) {
+        return true;
+    }
+
+    UsageTuple tuple = config.getUsageTuple(usageResult.tupleIndex);
+
+    if (irrigation && tuple.irrigation != 0) {
+        return true;
+    }
+
+    // potential evaporation of the district, see Calculation::getKLIMA()
+    int bez = record.BEZIRK;
+
+    if (tuple.usage == Usage::waterbody_G) {
+        return
+            districtValue(before.hashEG, bez, DEFAULT_EG) !=
+            districtValue(after.hashEG, bez, DEFAULT_EG);
+    }
+
+    return
+        districtValue(before.hashETP, bez, DEFAULT_ETP) !=
+        districtValue(after.hashETP, bez, DEFAULT_ETP) ||
+        districtValue(before.hashETPS, bez, DEFAULT_ETPS) !=
+        districtValue(after.hashETPS, bez, DEFAULT_ETPS);
+}
+
+void ConfigDiff::compare(QString name, float valueBefore, float valueAfter, bool &flag)
+{
+    if (valueBefore != valueAfter) {
+        changes << name;
+        flag = true;
+    }
+}
+
+int ConfigDiff::districtValue(QHash<int, int> &hash, int district, int defaultValue)
+{
+    if (hash.contains(district)) {
+        return hash.value(district);
+    }
+
+    return hash.contains(0) ? hash.value(0) : defaultValue;
+}
@@ -0,0 +1,49 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef CONFIGDIFF_H
+#define CONFIGDIFF_H
+
+#include <QHash>
+#include <QStringList>
+
+#include "config.h"
+#include "dbaseReader.h"
+#include "initvalues.h"
+
+// Differences between two configurations and the blocks whose results they
+// change (see Calculation::calcConfigChange()). A block is affected if it
+// has a share of a changed surface class, lies in a district with changed
+// potential evaporation or is irrigated when BERtoZero changed. Changes of
+// the precipitation correction or of the number of decimals affect all
+// blocks.
+class ConfigDiff
+{
+public:
+    ConfigDiff(InitValues &before, InitValues &after);
+    bool isEmpty();
+    bool affectsAll();
+    bool affects(const abimoRecord &record);
+    QStringList getChanges();
+
+private:
+    InitValues &before;
+    InitValues &after;
+    Config config;
+    QStringList changes;
+    bool all;
+
+    // infdach/bagdach, infbel<i>/bagbel<i> (index i - 1) and bagbel4 for
+    // unsealed roads
+    bool roof;
+    bool pavement[4];
+    bool unsealedRoads;
+    bool irrigation;
+
+    void compare(QString name, float valueBefore, float valueAfter, bool &flag);
+    static int districtValue(QHash<int, int> &hash, int district, int defaultValue);
+};
+
+#endif
@@ -3,7 +3,8 @@
  * of this repository (https://github.com/KWB-R/abimo).
  ***************************************************************************/
 
-#include <QBuffer>
+#include <limits.h> // for INT_MAX
+#include <string.h>
 #include <QDebug>
 #include <QHash>
 #include <QIODevice>
@@ -11,13 +12,16 @@
 #include <QtGlobal>
 #include <QVector>
 
+#include "codeindex.h"
 #include "dbaseField.h"
 #include "dbaseReader.h"
 #include "helpers.h"
 
 DbaseReader::DbaseReader(const QString &i_file):
     file(i_file),
-    vals(0),
+    step(0),
+    chunkShift(0),
+    codeField(-1),
     numberOfRecords(0),
     lengthOfHeader(0),
     lengthOfEachRecord(0),
@@ -26,9 +30,6 @@ DbaseReader::DbaseReader(const QString &i_file):
 
 DbaseReader::~DbaseReader()
 {
-    if (vals != 0) {
-        delete[] vals;
-    }
 }
 
 QString DbaseReader::getError()
@@ -41,15 +42,16 @@ QString DbaseReader::getFullError()
     return fullError;
 }
 
-QString* DbaseReader::getVals()
+// Values of the field CODE, the id of a value is the number of its record
+const CodeArena& DbaseReader::getCodes()
 {
-    return vals;
+    return codes;
 }
 
 QStringList DbaseReader::requiredFields()
 {
     // The conversion function used in calculation.cpp to convert string to
-    // numeric is given as a comment
+    // numeric is given as a comment (the order is that of AbimoField)
 
     return {
         "NUTZUNG",    // toInt()
@@ -108,6 +110,148 @@ bool DbaseReader::checkAndRead()
 }
 
 bool DbaseReader::read()
+{
+    if (!readHeader()) {
+        return false;
+    }
+
+    // the records are kept as they are, the values are converted when they
+    // are accessed (see getBytes()). They are read chunk by chunk, a
+    // QByteArray cannot hold more than 2 GiB.
+    chunks.clear();
+
+    for (qint64 first = 0; first < numberOfRecords; first += recordsPerChunk()) {
+        qint64 n = qMin((qint64) recordsPerChunk(), numberOfRecords - first);
+        chunks.append(file.read(n * step));
+    }
+
+    file.close();
+
+    initRecords();
+    return true;
+}
+
+// Read only the records with the given numbers (e.g. found by a CodeIndex):
+// record i of the reader is record numbers[i] of the file. Each record is
+// read at its position in the file, all others are skipped.
+bool DbaseReader::readRecords(const QVector<int> &numbers)
+{
+    if (!readHeader()) {
+        return false;
+    }
+
+    // the records are read as by read(), i.e. from the first field on
+    qint64 start = file.pos();
+
+    chunks.clear();
+
+    for (int i = 0; i < numbers.size(); i++) {
+
+        int num = numbers.at(i);
+
+        if (num < 0 || num >= numberOfRecords) {
+            error = QString("Record %1 ist nicht in der Datei vorhanden.").arg(num);
+            file.close();
+            return false;
+        }
+
+        if ((i & chunkMask()) == 0) {
+            chunks.append(QByteArray());
+            chunks.last().reserve(qMin(recordsPerChunk(), numbers.size() - i) * step);
+        }
+
+        file.seek(start + (qint64) num * step);
+        chunks.last().append(file.read(step));
+    }
+
+    file.close();
+
+    numberOfRecords = numbers.size();
+    initRecords();
+    return true;
+}
+
+// Read only the records with the given codes, looked up in the code index of
+// the file (built if it is missing or out of date, see CodeIndex::open()).
+// numbers[i] is set to the record number of codes[i] (-1 if there is no such
+// record), the records found are read in the order of the codes.
+bool DbaseReader::readRecordsByCode(const QVector<QByteArray> &codes, QVector<int> &numbers)
+{
+    if (!readIndexedRecords(codes, numbers)) {
+        return false;
+    }
+
+    if (hasCodes(codes, numbers)) {
+        return true;
+    }
+
+    // The index does not fit the file although its size and modification
+    // time are the same (e.g. the file was replaced by a copy), build it
+    // again
+    if (!CodeIndex::build(file.fileName(), error) || !readIndexedRecords(codes, numbers)) {
+        return false;
+    }
+
+    if (!hasCodes(codes, numbers)) {
+        error = "Index passt nicht zur Datei '" + file.fileName() + "'.";
+        return false;
+    }
+
+    return true;
+}
+
+bool DbaseReader::readIndexedRecords(const QVector<QByteArray> &wanted, QVector<int> &numbers)
+{
+    CodeIndex index(file.fileName());
+
+    if (!index.open()) {
+        error = index.getError();
+        return false;
+    }
+
+    QVector<int> found;
+
+    numbers.resize(wanted.size());
+
+    for (int i = 0; i < wanted.size(); i++) {
+        numbers[i] = index.find(wanted.at(i));
+        if (numbers.at(i) >= 0) {
+            found.append(numbers.at(i));
+        }
+    }
+
+    index.close();
+
+    return readRecords(found);
+}
+
+// The records read by readIndexedRecords() have the codes they were looked up
+// with
+bool DbaseReader::hasCodes(const QVector<QByteArray> &wanted, const QVector<int> &numbers)
+{
+    int k = 0;
+
+    for (int i = 0; i < wanted.size(); i++) {
+
+        if (numbers.at(i) < 0) {
+            continue;
+        }
+
+        const QByteArray &code = wanted.at(i);
+
+        if (CodeArena::compare(codes.getData(k), codes.getLength(k), code.constData(), code.size()) != 0) {
+            return false;
+        }
+
+        k++;
+    }
+
+    return true;
+}
+
+// Read and check the header and the field descriptions, the file stays open
+// at the first record
+bool DbaseReader::readHeader()
 {
     if (!file.open(QIODevice::ReadOnly)) {
         error = "Kann die Datei nicht oeffnen\n" + file.errorString();
@@ -165,7 +309,6 @@ bool DbaseReader::read()
     }
 
     //rest of header are field information
-    QVector<DbaseField> fields;
     fields.resize(countFields);
 
     for (int i = 0; i < countFields; i++) {
@@ -176,29 +319,80 @@ bool DbaseReader::read()
     //Terminator
     file.read(2);
 
-    QByteArray arr = file.read(lengthOfEachRecord * numberOfRecords);
-    file.close();
+    fieldOffsets.resize(countFields);
+    fieldLengths.resize(countFields);
+    step = 0;
 
-    QBuffer buffer(&arr);
-    buffer.open(QIODevice::ReadOnly);
+    for (int j = 0; j < countFields; j++) {
+        fieldOffsets[j] = step;
+        fieldLengths[j] = fields[j].getFieldLength();
+        step += fieldLengths[j];
+    }
 
-    vals = new QString[numberOfRecords * countFields];
+    // deletion flag of the next record
+    step++;
 
-    for (int i = 0; i < numberOfRecords; i++) {
-        for (int j = 0; j < countFields; j++) {
-            QString s = buffer.read(fields[j].getFieldLength()).trimmed();
-            vals[i * countFields + j] = ((s.size() > 0) ? s : "0");
-        }
-        buffer.read(1);
+    // as many records per chunk as fit into DBASE_READER_CHUNK_SIZE bytes
+    chunkShift = 0;
+
+    while ((step << (chunkShift + 1)) <= DBASE_READER_CHUNK_SIZE) {
+        chunkShift++;
     }
 
-    buffer.close();
     return true;
 }
 
-int DbaseReader::expectedFileSize()
+// Prepare the access to the records in chunks
+void DbaseReader::initRecords()
+{
+    // missing bytes at the end are read as empty values
+    for (int c = 0; c < chunks.size(); c++) {
+
+        int size = qMin(recordsPerChunk(), numberOfRecords - (c << chunkShift)) * step;
+
+        if (chunks.at(c).size() < size) {
+            chunks[c].append(QByteArray(size - chunks.at(c).size(), ' '));
+        }
+    }
+
+    QStringList names = requiredFields();
+    abimoFields.resize(names.size());
+
+    for (int i = 0; i < names.size(); i++) {
+        abimoFields[i] = hash.value(names.at(i), -1);
+    }
+
+    // the codes are kept in an arena of their own (see getCodes())
+    codeField = hash.value("CODE", -1);
+    codes.clear();
+
+    if (codeField >= 0) {
+        codes.reserve(
+            numberOfRecords,
+            (int) qMin((qint64) numberOfRecords * fieldLengths[codeField], (qint64) INT_MAX)
+        );
+
+        for (int i = 0; i < numberOfRecords; i++) {
+            int length;
+            const char *bytes = getBytes(i, codeField, length);
+            codes.add(bytes, length);
+        }
+    }
+}
+
+qint64 DbaseReader::expectedFileSize()
+{
+    return lengthOfHeader + ((qint64) numberOfRecords * lengthOfEachRecord) + 1;
+}
+
+int DbaseReader::recordsPerChunk()
 {
-    return lengthOfHeader + (numberOfRecords * lengthOfEachRecord) + 1;
+    return 1 << chunkShift;
+}
+
+int DbaseReader::chunkMask()
+{
+    return recordsPerChunk() - 1;
 }
 
 QString DbaseReader::getRecord(int num, const QString & name)
@@ -207,7 +401,7 @@ QString DbaseReader::getRecord(int num, const QString & name)
         return 0;
     }
 
-    return getRecord(num, hash[name]);
+    return getRecord(num, hash.value(name));
 }
 
 QString DbaseReader::getRecord(int num, int field)
@@ -216,7 +410,171 @@ QString DbaseReader::getRecord(int num, int field)
         return 0;
     }
 
-    return vals[num * countFields + field];
+    if (field == codeField) {
+        return codes.getString(num);
+    }
+
+    int length;
+    const char *bytes = getBytes(num, field, length);
+
+    return QString::fromUtf8(bytes, length);
+}
+
+// Bytes of a value without leading and trailing whitespace, up to the first
+// NUL byte, or "0" if none are left (as the values were converted to QString
+// when the file was read)
+const char *DbaseReader::getBytes(int num, int field, int &length)
+{
+    length = fieldLengths.at(field);
+    const char *record = chunks.at(num >> chunkShift).constData() + (num & chunkMask()) * step;
+    return trimmed(record + fieldOffsets.at(field), length);
+}
+
+// Bytes of a field of length bytes as getBytes() takes them (length is set
+// to their number)
+const char *DbaseReader::trimmed(const char *bytes, int &length)
+{
+    while (length > 0 && (bytes[0] == ' ' || (bytes[0] >= '\t' && bytes[0] <= '\r'))) {
+        bytes++;
+        length--;
+    }
+
+    while (
+        length > 0 &&
+        (bytes[length - 1] == ' ' || (bytes[length - 1] >= '\t' && bytes[length - 1] <= '\r'))
+    ) {
+        length--;
+    }
+
+    const char *end = (const char *) memchr(bytes, 0, length);
+
+    if (end != 0) {
+        length = end - bytes;
+    }
+
+    if (length == 0) {
+        length = 1;
+        return "0";
+    }
+
+    return bytes;
+}
+
+// getRecord(num, field).toInt() (0 for a missing field)
+int DbaseReader::getInt(int num, AbimoField field)
+{
+    return getInt(num, abimoFields.at((int) field));
+}
+
+// getRecord(num, field).toFloat() (0 for a missing field)
+float DbaseReader::getFloat(int num, AbimoField field)
+{
+    return getFloat(num, abimoFields.at((int) field));
+}
+
+// Same for the field with the given index (e.g. a column REGENJA_<year>)
+int DbaseReader::getInt(int num, int field)
+{
+    if (field < 0 || field >= countFields || num >= numberOfRecords) {
+        return 0;
+    }
+
+    int length;
+    const char *bytes = getBytes(num, field, length);
+
+    return parseInt(bytes, length);
+}
+
+float DbaseReader::getFloat(int num, int field)
+{
+    if (field < 0 || field >= countFields || num >= numberOfRecords) {
+        return 0.0F;
+    }
+
+    int length;
+    const char *bytes = getBytes(num, field, length);
+
+    return parseFloat(bytes, length);
+}
+
+// Plain decimal integers ([-]d, at most 9 digits) are converted here, all
+// others by QString::toInt()
+int DbaseReader::parseInt(const char *text, int length)
+{
+    bool negative = (text[0] == '-');
+    int i = negative ? 1 : 0;
+    int result = 0;
+
+    if (length - i < 1 || length - i > 9) {
+        return QString::fromUtf8(text, length).toInt();
+    }
+
+    for (; i < length; i++) {
+
+        if (text[i] < '0' || text[i] > '9') {
+            return QString::fromUtf8(text, length).toInt();
+        }
+
+        result = result * 10 + (text[i] - '0');
+    }
+
+    return negative ? -result : result;
+}
+
+// Plain decimal numbers ([-]d[.d], at most 15 digits) are converted here, all
+// others by QString::toFloat(). The digits and the power of ten are exact
+// doubles, so the quotient is the correctly rounded double that toFloat()
+// rounds to float as well.
+float DbaseReader::parseFloat(const char *text, int length)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+        1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+    };
+
+    bool negative = (text[0] == '-');
+    qint64 mantissa = 0;
+    int digits = 0;
+
+    // number of digits after the point (-1: no point)
+    int decimals = -1;
+
+    for (int i = negative ? 1 : 0; i < length; i++) {
+
+        if (text[i] == '.' && decimals < 0 && digits > 0) {
+            decimals = 0;
+            continue;
+        }
+
+        if (text[i] < '0' || text[i] > '9' || digits == 15) {
+            return QString::fromUtf8(text, length).toFloat();
+        }
+
+        mantissa = mantissa * 10 + (text[i] - '0');
+        digits++;
+
+        if (decimals >= 0) {
+            decimals++;
+        }
+    }
+
+    if (digits == 0 || decimals == 0) {
+        return QString::fromUtf8(text, length).toFloat();
+    }
+
+    double value = (double) mantissa / powers[qMax(decimals, 0)];
+
+    return (float) (negative ? -value : value);
+}
+
+DbaseField DbaseReader::getField(int field)
+{
+    return fields.value(field);
+}
+
+QString DbaseReader::getFileName()
+{
+    return file.fileName();
 }
 
 int DbaseReader::getCountFields()
@@ -224,6 +582,24 @@ int DbaseReader::getCountFields()
     return countFields;
 }
 
+// Names of all fields, in the order of the columns in the file
+QStringList DbaseReader::getFieldNames()
+{
+    QStringList names;
+
+    for (int i = 0; i < countFields; i++) {
+        names << hash.key(i);
+    }
+
+    return names;
+}
+
+// Column index of the field with the given name or -1 if there is no such field
+int DbaseReader::getFieldIndex(const QString& name)
+{
+    return hash.value(name, -1);
+}
+
 QDate DbaseReader::getDate()
 {
     return date;
@@ -345,44 +721,70 @@ int DbaseReader::computeCountFields(int headerLength)
     return (headerLength - 32 - 1)/32;
 }
 
+// Fill record with the values of row k. The values are converted from the
+// bytes of the file as getRecord() and QString would do it, without
+// allocating memory (the CODE takes the buffer of record.CODE if it is large
+// enough and not shared).
 void DbaseReader::fillRecord(int k, abimoRecord& record, bool debug)
 {
-    record.BELAG1_fraction = floatFraction(getRecord(k, "BELAG1"));
-    record.BELAG2_fraction = floatFraction(getRecord(k, "BELAG2"));
-    record.BELAG3_fraction = floatFraction(getRecord(k, "BELAG3"));
-    record.BELAG4_fraction = floatFraction(getRecord(k, "BELAG4"));
-    record.BEZIRK = getRecord(k, "BEZIRK").toInt();
-    record.CODE = getRecord(k, "CODE");
-    record.FELD_150 = getRecord(k, "FELD_150").toInt();
-    record.FELD_30 = getRecord(k, "FELD_30").toInt();
-    record.FLGES = getRecord(k, "FLGES").toFloat();
-    record.FLUR = getRecord(k, "FLUR").toFloat();
-    record.KAN_BEB_fraction = floatFraction(getRecord(k, "KAN_BEB"));
-    record.KAN_STR_fraction = floatFraction(getRecord(k, "KAN_STR"));
-    record.KAN_VGU_fraction = floatFraction(getRecord(k, "KAN_VGU"));
-    record.NUTZUNG = Helpers::stringToInt(
-        getRecord(k, "NUTZUNG"),
-        QString("k: %1, NUTZUNG = ").arg(QString::number(k)),
-        debug
-    );
-    record.PROBAU_fraction = Helpers::stringToFloat(
-        getRecord(k, "PROBAU"),
-        QString("k: %1, PROBAU = ").arg(QString::number(k)),
-        debug
-    ) / 100.0F;
-    record.PROVGU_fraction = floatFraction(getRecord(k, "PROVGU"));
-    record.REGENJA = getRecord(k, "REGENJA").toInt();
-    record.REGENSO = getRecord(k, "REGENSO").toInt();
-    record.STR_BELAG1_fraction = floatFraction(getRecord(k, "STR_BELAG1"));
-    record.STR_BELAG2_fraction = floatFraction(getRecord(k, "STR_BELAG2"));
-    record.STR_BELAG3_fraction = floatFraction(getRecord(k, "STR_BELAG3"));
-    record.STR_BELAG4_fraction = floatFraction(getRecord(k, "STR_BELAG4"));
-    record.TYP = getRecord(k, "TYP").toInt();
-    record.VGSTRASSE_fraction = floatFraction(getRecord(k, "VGSTRASSE"));
-    record.STR_FLGES = getRecord(k, "STR_FLGES").toFloat();
+    record.BELAG1_fraction = floatFraction(getFloat(k, AbimoField::BELAG1));
+    record.BELAG2_fraction = floatFraction(getFloat(k, AbimoField::BELAG2));
+    record.BELAG3_fraction = floatFraction(getFloat(k, AbimoField::BELAG3));
+    record.BELAG4_fraction = floatFraction(getFloat(k, AbimoField::BELAG4));
+    record.BEZIRK = getInt(k, AbimoField::BEZIRK);
+
+    if (codeField >= 0 && k < numberOfRecords) {
+        codes.assignTo(k, record.CODE);
+    }
+    else {
+        record.CODE = QString();
+    }
+
+    record.FELD_150 = getInt(k, AbimoField::FELD_150);
+    record.FELD_30 = getInt(k, AbimoField::FELD_30);
+    record.FLGES = getFloat(k, AbimoField::FLGES);
+    record.FLUR = getFloat(k, AbimoField::FLUR);
+    record.KAN_BEB_fraction = floatFraction(getFloat(k, AbimoField::KAN_BEB));
+    record.KAN_STR_fraction = floatFraction(getFloat(k, AbimoField::KAN_STR));
+    record.KAN_VGU_fraction = floatFraction(getFloat(k, AbimoField::KAN_VGU));
+
+    if (debug) {
+        record.NUTZUNG = Helpers::stringToInt(
+            getRecord(k, "NUTZUNG"),
+            QString("k: %1, NUTZUNG = ").arg(QString::number(k)),
+            debug
+        );
+        record.PROBAU_fraction = Helpers::stringToFloat(
+            getRecord(k, "PROBAU"),
+            QString("k: %1, PROBAU = ").arg(QString::number(k)),
+            debug
+        ) / 100.0F;
+    }
+    else {
+        record.NUTZUNG = getInt(k, AbimoField::NUTZUNG);
+        record.PROBAU_fraction = getFloat(k, AbimoField::PROBAU) / 100.0F;
+    }
+
+    record.PROVGU_fraction = floatFraction(getFloat(k, AbimoField::PROVGU));
+    record.REGENJA = getInt(k, AbimoField::REGENJA);
+    record.REGENSO = getInt(k, AbimoField::REGENSO);
+    record.STR_BELAG1_fraction = floatFraction(getFloat(k, AbimoField::STR_BELAG1));
+    record.STR_BELAG2_fraction = floatFraction(getFloat(k, AbimoField::STR_BELAG2));
+    record.STR_BELAG3_fraction = floatFraction(getFloat(k, AbimoField::STR_BELAG3));
+    record.STR_BELAG4_fraction = floatFraction(getFloat(k, AbimoField::STR_BELAG4));
+    record.TYP = getInt(k, AbimoField::TYP);
+    record.VGSTRASSE_fraction = floatFraction(getFloat(k, AbimoField::VGSTRASSE));
+    record.STR_FLGES = getFloat(k, AbimoField::STR_FLGES);
 }
 
 float DbaseReader::floatFraction(QString string)
 {
-    return (string.toFloat() / 100.0);
+    return floatFraction(string.toFloat());
+}
+
+// Convert a percentage into a fraction (as done for all percentage fields
+// except PROBAU when reading a record)
+float DbaseReader::floatFraction(float value)
+{
+    return (value / 100.0);
 }
@@ -6,10 +6,15 @@
 #ifndef DBASEREADER_H
 #define DBASEREADER_H
 
+#include <QByteArray>
 #include <QDate>
 #include <QFile>
 #include <QHash>
 #include <QString>
+#include <QVector>
+
+#include "codearena.h"
+#include "dbaseField.h"
 
 // _fraction indicates numbers between 0 and 1 (instead of percentages)
 struct abimoRecord {
@@ -40,6 +45,19 @@ struct abimoRecord {
     float STR_FLGES;
 };
 
+// Fields of an input file, in the order of DbaseReader::requiredFields()
+enum class AbimoField {
+    NUTZUNG, CODE, REGENJA, REGENSO, FLUR, TYP, FELD_30, FELD_150, BEZIRK,
+    PROBAU, PROVGU, VGSTRASSE, KAN_BEB, KAN_VGU, KAN_STR,
+    BELAG1, BELAG2, BELAG3, BELAG4,
+    STR_BELAG1, STR_BELAG2, STR_BELAG3, STR_BELAG4,
+    FLGES, STR_FLGES
+};
+
+// Maximum size of the QByteArray holding a chunk of records (see
+// DbaseReader::read()), files of more than 2 GiB are read in several chunks
+#define DBASE_READER_CHUNK_SIZE (64 << 20)
+
 class DbaseReader
 {
 
@@ -47,6 +65,8 @@ public:
     DbaseReader(const QString&);
     ~DbaseReader();
     bool read();
+    bool readRecords(const QVector<int> &numbers);
+    bool readRecordsByCode(const QVector<QByteArray> &codes, QVector<int> &numbers);
     QString getVersion();
     QString getLanguageDriver();
     QDate getDate();
@@ -54,6 +74,10 @@ public:
     int getLengthOfHeader();
     int getLengthOfEachRecord();
     int getCountFields();
+    QStringList getFieldNames();
+    DbaseField getField(int field);
+    QString getFileName();
+    int getFieldIndex(const QString& name);
     QString getRecord(int num, int field);
     QString getRecord(int num, const QString& name);
     QString getError();
@@ -61,8 +85,14 @@ public:
     static QStringList requiredFields();
     bool isAbimoFile();
     bool checkAndRead();
-    QString* getVals();
+    const CodeArena& getCodes();
     void fillRecord(int k, abimoRecord& record, bool debug = false);
+    int getInt(int num, AbimoField field);
+    float getFloat(int num, AbimoField field);
+    int getInt(int num, int field);
+    float getFloat(int num, int field);
+    static const char *trimmed(const char *bytes, int &length);
+    static float floatFraction(float value);
 
 private:
     // VARIABLES:
@@ -72,9 +102,25 @@ private:
     QString languageDriver;
     QDate date;
     QHash<QString, int> hash;
+    QVector<DbaseField> fields;
     QString error;
     QString fullError;
-    QString* vals;
+
+    // the records as read from the file (without the deletion flag of the
+    // first one), step bytes from one record to the next. Record num is in
+    // chunk num >> chunkShift (see recordsPerChunk()).
+    QVector<QByteArray> chunks;
+    int step;
+    int chunkShift;
+    QVector<int> fieldOffsets;
+    QVector<int> fieldLengths;
+
+    // column of each AbimoField (-1 if there is none), see fillRecord()
+    QVector<int> abimoFields;
+
+    // values of the field CODE (index codeField, -1 if there is none)
+    CodeArena codes;
+    int codeField;
 
     // count of records in file
     int numberOfRecords;
@@ -91,7 +137,13 @@ private:
     // FUNCTIONS:
     /////////////
 
-    int expectedFileSize();
+    qint64 expectedFileSize();
+    int recordsPerChunk();
+    int chunkMask();
+    bool readHeader();
+    bool readIndexedRecords(const QVector<QByteArray> &wanted, QVector<int> &numbers);
+    bool hasCodes(const QVector<QByteArray> &wanted, const QVector<int> &numbers);
+    void initRecords();
 
     // 1 byte unsigned give the version
     QString checkVersion(quint8, bool debug = true);
@@ -113,6 +165,11 @@ private:
 
     // convert string to float and divide by 100
     float floatFraction(QString string);
+
+    // value of a field as it is converted by getRecord() (see getBytes())
+    const char *getBytes(int num, int field, int &length);
+    static int parseInt(const char *text, int length);
+    static float parseFloat(const char *text, int length);
 };
 
 #endif
@@ -3,23 +3,29 @@
  * of this repository (https://github.com/KWB-R/abimo).
  ***************************************************************************/
 
+#include <limits.h> // for INT_MAX
 #include <math.h>
+#include <string.h>
 #include <QByteArray>
-#include <QChar>
 #include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QHash>
 #include <QIODevice>
 #include <QString>
-#include <QStringList>
 #include <QTextStream>
 #include <QVector>
 
+#include "codeindex.h"
 #include "dbaseWriter.h"
 #include "initvalues.h"
 
 DbaseWriter::DbaseWriter(QString &file, InitValues &initValues):
     fileName(file),
+    codeArena(0),
+    spool(file + ".XXXXXX"),
+    spooledStatistics({0L, 0L, 0L}),
+    failed(false),
     recNum(0)
 {
     // Felder mit Namen, Typ, Nachkommastellen
@@ -46,8 +52,74 @@ QString DbaseWriter::getError()
     return error;
 }
 
+QString DbaseWriter::getIndexError()
+{
+    return indexError;
+}
+
+// Call function(record, codeId) for each record in the order of addRecord():
+// first the spooled records, then the records in memory. Stops as soon as
+// function returns false.
+template <class F>
+bool DbaseWriter::forEachRecord(F function)
+{
+    FieldText record[countFields];
+    int codeId;
+
+    if (spool.isOpen()) {
+
+        if (!spool.flush() || !spool.seek(0)) {
+            error = "Fehler beim Lesen von: '" + spool.fileName() + "'\n Grund: " +
+                spool.errorString();
+            return false;
+        }
+
+        // a record may continue in the next block read from the file
+        QByteArray block;
+        int pos = 0;
+
+        while (!spool.atEnd()) {
+
+            QByteArray next = spool.read(DBASE_WRITER_CHUNK_SIZE);
+
+            if (next.isEmpty()) {
+                break;
+            }
+
+            block = block.mid(pos) + next;
+            pos = 0;
+
+            while (readSpooled(block, pos, record, codeId)) {
+                if (!function(record, codeId)) {
+                    return false;
+                }
+            }
+        }
+
+        if (pos != block.size()) {
+            error = "Fehler beim Lesen von: '" + spool.fileName() + "'\n Grund: " +
+                spool.errorString();
+            return false;
+        }
+    }
+
+    for (int i = 0; i < codeIds.size(); i++) {
+        if (!function(values.constData() + i * countFields, codeIds.at(i))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool DbaseWriter::write()
 {
+    if (failed) {
+        return false;
+    }
+
+    error.clear();
+
     QByteArray data;
 
     data.resize(lengthOfHeader);
@@ -55,9 +127,6 @@ bool DbaseWriter::write()
     // Write the file header containing e.g. names and types of fields
     writeFileHeader(data);
 
-    // Append the actual data
-    writeFileData(data);
-
     QFile o_file(fileName);
 
     if (!o_file.open(QIODevice::WriteOnly)) {
@@ -65,9 +134,92 @@ bool DbaseWriter::write()
         return false;
     }
 
-    o_file.write(data);
+    // The index of the file (see CodeIndex) refers to the arena of
+    // setRecordCode() as long as the codes are written as they are in it
+    // (ids), else the codes are kept as they are written
+    int codeLength = fields[(int) ResultField::CODE].getFieldLength();
+    bool withIndex = recNum <= CODEINDEX_MAX_ENTRIES;
+    bool arenaCodes = codeArena != 0;
+    QVector<int> ids;
+    CodeArena written;
+
+    // Append the actual data, chunk by chunk
+    QByteArray chunk;
+    chunk.reserve(DBASE_WRITER_CHUNK_SIZE + lengthOfEachRecord + 1);
+
+    bool ok = o_file.write(data) == data.size() && forEachRecord(
+        [&](const FieldText *record, int codeId) {
+
+            int start = chunk.size();
+            chunk.append((char) 0x20);
+
+            for (int field = 0; field < countFields; field++) {
+                formatField(chunk, record, codeId, field, fields[field].getFieldLength());
+            }
+
+            if (withIndex && arenaCodes && isArenaCode(codeId, codeLength)) {
+                ids.append(codeId);
+            }
+            else if (withIndex) {
+
+                // from here on the codes are kept, also those of the ids
+                if (arenaCodes) {
+                    arenaCodes = false;
+                    for (int i = 0; i < ids.size(); i++) {
+                        written.add(codeArena->getData(ids.at(i)), codeArena->getLength(ids.at(i)));
+                    }
+                    ids = QVector<int>();
+                }
+
+                // CODE is the first field, after the deletion flag
+                int length = codeLength;
+                const char *bytes = DbaseReader::trimmed(chunk.constData() + start + 1, length);
+
+                if (written.getBuffer().size() > INT_MAX - length) {
+                    withIndex = false;
+                    written.clear();
+                }
+                else {
+                    written.add(bytes, length);
+                }
+            }
+
+            if (chunk.size() >= DBASE_WRITER_CHUNK_SIZE) {
+                if (o_file.write(chunk) != chunk.size()) {
+                    return false;
+                }
+                chunk.resize(0);
+            }
+
+            return true;
+        }
+    );
+
+    chunk.append((char) 0x1A);
+
+    if (!ok || o_file.write(chunk) != chunk.size() || !o_file.flush()) {
+        if (error.isEmpty()) {
+            error = "Fehler beim Schreiben in: '" + fileName + "'\n Grund: " +
+                o_file.errorString();
+        }
+        return false;
+    }
+
     o_file.close();
 
+    // The index is built on first use if it cannot be written here
+    indexError.clear();
+
+    if (!withIndex) {
+        indexError = "Zu viele Datensaetze fuer einen CODE-Index.";
+    }
+    else if (arenaCodes && !ids.isEmpty()) {
+        CodeIndex::write(fileName, *codeArena, ids, indexError);
+    }
+    else {
+        CodeIndex::write(fileName, written, indexError);
+    }
+
     return true;
 }
 
@@ -132,40 +284,291 @@ int DbaseWriter::writeFileHeader(QByteArray &data)
     return index;
 }
 
-void DbaseWriter::writeFileData(QByteArray &data)
+// Move the records in memory to the spool file: the code id, then length and
+// bytes of each value. The memory is reused for the next records, also if
+// the file cannot be written (write() fails then).
+bool DbaseWriter::spoolRecords()
 {
-    QVector<QString> strings;
+    if (!failed && !spool.isOpen() && !spool.open()) {
+        error = "kann Datei: '" + spool.fileName() + "' nicht anlegen\n Grund: " +
+            spool.errorString();
+        failed = true;
+    }
 
-    for (int rec = 0; rec < recNum; rec++) {
+    // write() may have read the file
+    if (!failed && !spool.seek(spool.size())) {
+        error = "Fehler beim Schreiben in: '" + spool.fileName() + "'\n Grund: " +
+            spool.errorString();
+        failed = true;
+    }
 
-        strings = record.at(rec);
-        data.append(QChar(0x20));
+    QByteArray chunk;
 
-        for (int field = 0; field < countFields; field++) {
+    if (!failed) {
+        chunk.reserve(DBASE_WRITER_CHUNK_SIZE + lengthOfHeader);
+    }
 
-            int fieldLength = fields[field].getFieldLength();
+    for (int i = 0; i < codeIds.size() && !failed; i++) {
 
-            if (fields[field].getDecimalCount() > 0) {
-                QString str = strings.at(field);
-                QStringList strlist = str.split(".");
-                int frontLength = fieldLength - 1 - fields[field].getDecimalCount();
-                if (strlist.at(0).contains('-')) {
-                    data.append(QString("-"));
-                    data.append(strlist.at(0).right(strlist.at(0).length() - 1).rightJustified(frontLength-1, QChar(0x30)));
-                }
-                else {
-                    data.append(strlist.at(0).rightJustified(frontLength, QChar(0x30)));
-                }
-                data.append(".");
-                data.append(strlist.at(1).leftJustified(fields[field].getDecimalCount(), QChar(0x30)));
-            }
-            else {
-                data.append(strings.at(field).rightJustified(fieldLength, QChar(0x30)));
+        int codeId = codeIds.at(i);
+        chunk.append(reinterpret_cast<const char*>(&codeId), sizeof(int));
+
+        for (int field = 0; field < countFields; field++) {
+            const FieldText &value = values.at(i * countFields + field);
+            chunk.append(reinterpret_cast<const char*>(&value.length), sizeof(int));
+            chunk.append(value.data, value.length);
+        }
+
+        if (chunk.size() >= DBASE_WRITER_CHUNK_SIZE || i == codeIds.size() - 1) {
+            if (spool.write(chunk) != chunk.size()) {
+                error = "Fehler beim Schreiben in: '" + spool.fileName() + "'\n Grund: " +
+                    spool.errorString();
+                failed = true;
             }
+            chunk.resize(0);
+        }
+    }
+
+    const RunArenaStatistics &statistics = arena.getStatistics();
+    spooledStatistics.bytes += statistics.bytes;
+    spooledStatistics.allocations += statistics.allocations;
+    spooledStatistics.heapAllocations += statistics.heapAllocations;
+
+    values.resize(0);
+    codeIds.resize(0);
+    arena.reset();
+
+    return !failed;
+}
+
+// Next record of the spool file in block at pos, false if the block ends
+// before the record (see spoolRecords()). The values point into block.
+bool DbaseWriter::readSpooled(const QByteArray &block, int &pos, FieldText *record, int &codeId)
+{
+    int next = pos;
+
+    if (block.size() - next < (int) sizeof(int)) {
+        return false;
+    }
+
+    memcpy(&codeId, block.constData() + next, sizeof(int));
+    next += sizeof(int);
+
+    for (int field = 0; field < countFields; field++) {
+
+        if (block.size() - next < (int) sizeof(int)) {
+            return false;
+        }
+
+        memcpy(&record[field].length, block.constData() + next, sizeof(int));
+        next += sizeof(int);
+
+        if (block.size() - next < record[field].length) {
+            return false;
         }
+
+        record[field].data = block.constData() + next;
+        next += record[field].length;
+    }
+
+    pos = next;
+
+    return true;
+}
+
+// The code with the given id is written as it is in the arena of
+// setRecordCode(): not padded and nothing that DbaseReader trims
+bool DbaseWriter::isArenaCode(int id, int codeLength)
+{
+    if (id < 0 || codeArena->getLength(id) != codeLength) {
+        return false;
+    }
+
+    int length = codeLength;
+    const char *bytes = codeArena->getData(id);
+
+    return DbaseReader::trimmed(bytes, length) == bytes && length == codeLength;
+}
+
+// Append text padded with '0' to width characters, on the left (right) or on
+// the right (!right). Longer text is not cut.
+static void appendJustified(QByteArray &data, const char *text, int length, int width, bool right)
+{
+    if (!right) {
+        data.append(text, length);
     }
 
-    data.append(QChar(0x1A));
+    for (int i = length; i < width; i++) {
+        data.append('0');
+    }
+
+    if (right) {
+        data.append(text, length);
+    }
+}
+
+// Append a value in the format of the field: the integer part is padded with
+// '0' on the left (after a minus sign), the decimals on the right
+void DbaseWriter::formatField(QByteArray &data, int field, int fieldLength, const char *text, int length)
+{
+    int decimalCount = fields[field].getDecimalCount();
+
+    if (decimalCount <= 0) {
+        appendJustified(data, text, length, fieldLength, true);
+        return;
+    }
+
+    const char *point = (const char *) memchr(text, '.', length);
+    int frontLength = fieldLength - 1 - decimalCount;
+    int front = (point != 0) ? point - text : length;
+
+    if (memchr(text, '-', front) != 0) {
+        data.append('-');
+        appendJustified(data, text + 1, front - 1, frontLength - 1, true);
+    }
+    else {
+        appendJustified(data, text, front, frontLength, true);
+    }
+
+    data.append('.');
+
+    // decimals up to the next point, if any
+    const char *decimals = (point != 0) ? point + 1 : text + length;
+    int decimalsLength = text + length - decimals;
+    const char *next = (const char *) memchr(decimals, '.', decimalsLength);
+
+    if (next != 0) {
+        decimalsLength = next - decimals;
+    }
+
+    appendJustified(data, decimals, decimalsLength, decimalCount, false);
+}
+
+// Value of a field of a record. A CODE given by setRecordCode() is copied as
+// it is, padded with '0' like all other values.
+void DbaseWriter::formatField(
+    QByteArray &data, const FieldText *record, int codeId, int field, int fieldLength
+)
+{
+    if (field == 0 && codeId >= 0) {
+        appendJustified(
+            data, codeArena->getData(codeId), codeArena->getLength(codeId), fieldLength, true
+        );
+        return;
+    }
+
+    formatField(data, field, fieldLength, record[field].data, record[field].length);
+}
+
+// Same field names, types and decimal counts as the given result file
+bool DbaseWriter::hasSameFields(DbaseReader &previous)
+{
+    if (previous.getCountFields() != countFields) {
+        return false;
+    }
+
+    for (int i = 0; i < countFields; i++) {
+        DbaseField field = previous.getField(i);
+        if (
+            field.getName() != fields[i].getName() ||
+            field.getType() != fields[i].getType() ||
+            field.getDecimalCount() != fields[i].getDecimalCount()
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// All values of the records fit into the field lengths of the given file
+bool DbaseWriter::fitsInto(DbaseReader &previous)
+{
+    if (!hasSameFields(previous)) {
+        return false;
+    }
+
+    for (int i = 0; i < countFields; i++) {
+        if (fields[i].getFieldLength() > previous.getField(i).getFieldLength()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Only the date of last edit and the given rows are written, the file is
+// copied first if it is not the file to write (see fitsInto())
+bool DbaseWriter::patch(DbaseReader &previous, const QVector<int> &rows)
+{
+    if (!fitsInto(previous) || rows.size() != recNum) {
+        error = "Ergebnisse passen nicht in die Datei: '" + previous.getFileName() + "'";
+        return false;
+    }
+
+    QString previousName = QFileInfo(previous.getFileName()).absoluteFilePath();
+
+    if (QFileInfo(fileName).absoluteFilePath() != previousName) {
+        QFile::remove(fileName);
+        if (!QFile::copy(previousName, fileName)) {
+            error = "kann Datei: '" + previousName + "' nicht nach '" + fileName + "' kopieren";
+            return false;
+        }
+    }
+
+    QFile o_file(fileName);
+
+    if (!o_file.open(QIODevice::ReadWrite)) {
+        error = "kann Out-Datei: '" + fileName + "' nicht oeffnen\n Grund: " + o_file.errorString();
+        return false;
+    }
+
+    QByteArray data(3, 0);
+    writeThreeByteDate(data, 0, date);
+
+    if (!o_file.seek(1) || o_file.write(data) != data.size()) {
+        error = "Fehler beim Schreiben in: '" + fileName + "'\n Grund: " + o_file.errorString();
+        return false;
+    }
+
+    // one row, the buffer is reused for all rows
+    QByteArray row;
+    row.reserve(previous.getLengthOfEachRecord());
+    int rec = 0;
+
+    bool ok = forEachRecord([&](const FieldText *record, int codeId) {
+
+        row.resize(0);
+
+        for (int field = 0; field < countFields; field++) {
+            formatField(row, record, codeId, field, previous.getField(field).getFieldLength());
+        }
+
+        // skip the deletion flag at the start of the row
+        qint64 offset = (qint64) previous.getLengthOfHeader() +
+            (qint64) rows.at(rec++) * previous.getLengthOfEachRecord() + 1;
+
+        if (!o_file.seek(offset) || o_file.write(row) != row.size()) {
+            error = "Fehler beim Schreiben in: '" + fileName + "'\n Grund: " +
+                o_file.errorString();
+            return false;
+        }
+
+        return true;
+    });
+
+    if (!ok) {
+        return false;
+    }
+
+    if (!o_file.flush()) {
+        error = "Fehler beim Schreiben in: '" + fileName + "'\n Grund: " + o_file.errorString();
+        return false;
+    }
+
+    o_file.close();
+
+    return true;
 }
 
 int DbaseWriter::writeBytes(QByteArray &data, int index, int value, int n_values)
@@ -216,16 +619,78 @@ int DbaseWriter::writeTwoByteInteger(QByteArray &data, int index, int value)
 
 void DbaseWriter::addRecord()
 {
-    QVector<QString> v(countFields);
-    record.append(v);
+    FieldText empty = {0, 0};
+
+    // A failure is reported by write()
+    if (codeIds.size() == DBASE_WRITER_BUFFER_RECORDS) {
+        spoolRecords();
+    }
+
+    for (int i = 0; i < countFields; i++) {
+        values.append(empty);
+    }
+
+    codeIds.append(-1);
     recNum ++;
 }
 
+// Reserve the memory for n records (e.g. the number of input records), at
+// most for the records kept in memory
+void DbaseWriter::reserve(int n)
+{
+    n = qMin(n, DBASE_WRITER_BUFFER_RECORDS);
+
+    values.reserve(n * countFields);
+    codeIds.reserve(n);
+}
+
+// Memory taken by the text of the values
+RunArenaStatistics DbaseWriter::getStatistics() const
+{
+    RunArenaStatistics statistics = spooledStatistics;
+    const RunArenaStatistics &current = arena.getStatistics();
+
+    statistics.bytes += current.bytes;
+    statistics.allocations += current.allocations;
+    statistics.heapAllocations += current.heapAllocations;
+
+    return statistics;
+}
+
 void DbaseWriter::setRecordField(int num, QString value)
 {
-    ((record.last()))[num] = QString(value);
-    if (value.size() > fields[num].getFieldLength()) {
-        fields[num].setFieldLength(value.size());
+    QByteArray text = value.toLatin1();
+    setRecordText(num, text.constData(), text.size());
+}
+
+// Value of field num of the last record as Latin-1 text
+void DbaseWriter::setRecordText(int num, const char *text, int length)
+{
+    FieldText &value = values[(codeIds.size() - 1) * countFields + num];
+
+    value.data = (length > 0) ? arena.copy(text, length) : 0;
+    value.length = length;
+
+    if (length > fields[num].getFieldLength()) {
+        fields[num].setFieldLength(length);
+    }
+}
+
+// CODE of the last record as id in the given arena. The arena must exist
+// until the file is written. Codes of another arena than the first one and
+// codes with non-ASCII bytes (written in Latin-1) are stored as QString.
+void DbaseWriter::setRecordCode(const CodeArena &arena, int id)
+{
+    if ((codeArena != 0 && codeArena != &arena) || !arena.isAscii(id)) {
+        setRecordField(0, arena.getString(id));
+        return;
+    }
+
+    codeArena = &arena;
+    codeIds.last() = id;
+
+    if (arena.getLength(id) > fields[0].getFieldLength()) {
+        fields[0].setFieldLength(arena.getLength(id));
     }
 }
 
@@ -238,9 +703,75 @@ void DbaseWriter::setRecordField(int num, float value)
     value = round(value);
     value *= pow(10, -decimalCount);
 
-    QString valueStr;
-    valueStr.setNum(value, 'f', decimalCount);
-    setRecordField(num, valueStr);
+    char text[32];
+    int length = formatNumber(value, decimalCount, text);
+
+    if (length < 0) {
+        QString valueStr;
+        valueStr.setNum(value, 'f', decimalCount);
+        setRecordField(num, valueStr);
+        return;
+    }
+
+    setRecordText(num, text, length);
+}
+
+void DbaseWriter::setRecordField(ResultField field, float value)
+{
+    setRecordField((int) field, value);
+}
+
+// Write value with decimalCount decimals into text as QString::setNum(value,
+// 'f', decimalCount) does and return the length. Values that are not
+// formatted here return -1: more than 12 decimals or 16 digits, negative
+// zero and values exactly halfway between two results.
+int DbaseWriter::formatNumber(float value, int decimalCount, char *text)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12
+    };
+
+    if (decimalCount < 0 || decimalCount > 12) {
+        return -1;
+    }
+
+    // exact product (24 bit mantissa times 5^12 < 2^28), so that rounding it
+    // rounds the decimal value of the float (NaN fails the comparison)
+    double scaled = fabs((double) value) * powers[decimalCount];
+
+    if (!(scaled < 9007199254740992.0) || scaled - floor(scaled) == 0.5) {
+        return -1;
+    }
+
+    quint64 digits = (quint64) round(scaled);
+
+    if (signbit(value) && digits == 0) {
+        return -1;
+    }
+
+    // digits from the right, at least one before the point
+    char reversed[24];
+    int n = 0;
+
+    do {
+        reversed[n++] = (char) ('0' + digits % 10);
+        digits /= 10;
+    } while (digits > 0 || n <= decimalCount);
+
+    int length = 0;
+
+    if (value < 0) {
+        text[length++] = '-';
+    }
+
+    for (int i = n - 1; i >= 0; i--) {
+        if (i == decimalCount - 1) {
+            text[length++] = '.';
+        }
+        text[length++] = reversed[i];
+    }
+
+    return length;
 }
 
 void DbaseWriter::setRecordField(QString name, QString value)
@@ -8,16 +8,34 @@
 
 #include <QByteArray>
 #include <QDate>
+#include <QFile>
 #include <QHash>
 #include <QString>
+#include <QTemporaryFile>
 #include <QVector>
 
+#include "codearena.h"
 #include "dbaseField.h"
+#include "dbaseReader.h"
 #include "initvalues.h"
+#include "runarena.h"
 
 const int countFields = 9;
 const int lengthOfHeader = countFields * 32 + 32 + 1;
 
+// Size from which the buffered records are written to the file (see
+// DbaseWriter::write())
+#define DBASE_WRITER_CHUNK_SIZE (4 << 20)
+
+// Number of records kept in memory, older records are moved to a spool file
+// next to the result file (see DbaseWriter::addRecord())
+#define DBASE_WRITER_BUFFER_RECORDS (1 << 18)
+
+// Numbers of the fields of a result file (see DbaseWriter::DbaseWriter())
+enum class ResultField {
+    CODE, R, ROW, RI, RVOL, ROWVOL, RIVOL, FLAECHE, VERDUNSTUN
+};
+
 class DbaseWriter
 {
 
@@ -29,19 +47,66 @@ public:
     void setRecordField(QString name, QString value);
     void setRecordField(int num, float value);
     void setRecordField(QString name, float value);
+    void setRecordField(ResultField field, float value);
+    void setRecordCode(const CodeArena &arena, int id);
     QString getError();
 
+    // why write() could not write the code index (the result file is
+    // complete, the index is built on first use, see CodeIndex)
+    QString getIndexError();
+    void reserve(int n);
+    RunArenaStatistics getStatistics() const;
+
+    // Write the records into the rows of an existing result file instead
+    // (record i into row rows[i]), all other bytes stay as they are
+    bool hasSameFields(DbaseReader &previous);
+    bool fitsInto(DbaseReader &previous);
+    bool patch(DbaseReader &previous, const QVector<int> &rows);
+
 private:
     QString fileName;
-    QVector< QVector<QString> > record;
+
+    // Text of the values (Latin-1) of the records in memory, record by
+    // record and field by field. The bytes are kept in arena, a value that
+    // was not set has length 0.
+    struct FieldText {
+        const char *data;
+        int length;
+    };
+
+    QVector<FieldText> values;
+    RunArena arena;
+
+    // CODE of each record in memory given as id in codeArena (-1: in record)
+    const CodeArena *codeArena;
+    QVector<int> codeIds;
+
+    // Records moved out of memory, in the order they were added (see
+    // spoolRecords()), and the memory their values took
+    QTemporaryFile spool;
+    RunArenaStatistics spooledStatistics;
+
+    // spooling failed, error is set
+    bool failed;
+
     QDate date;
     QHash<QString, int> hash;
     QString error;
+    QString indexError;
     int lengthOfEachRecord;
     int recNum;
     DbaseField fields[countFields];
     int writeFileHeader(QByteArray &data);
-    void writeFileData(QByteArray &data);
+    bool spoolRecords();
+    template <class F> bool forEachRecord(F function);
+    static bool readSpooled(const QByteArray &block, int &pos, FieldText *record, int &codeId);
+    bool isArenaCode(int id, int codeLength);
+    void setRecordText(int num, const char *text, int length);
+    static int formatNumber(float value, int decimalCount, char *text);
+    void formatField(QByteArray &data, int field, int fieldLength, const char *text, int length);
+    void formatField(
+        QByteArray &data, const FieldText *record, int codeId, int field, int fieldLength
+    );
     int writeBytes(QByteArray &data, int index, int value, int n_values);
     int writeThreeByteDate(QByteArray &data, int index, QDate date);
     int writeFourByteInteger(QByteArray &data, int index, int value);
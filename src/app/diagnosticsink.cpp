@@ -0,0 +1,203 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <QMutexLocker>
+#include <QtAlgorithms>
+
+#include "diagnosticsink.h"
+
+DiagnosticSink::DiagnosticSink(QTextStream & stream):
+    stream(stream),
+    mode(DiagnosticMode::full),
+    maxExamples(10),
+    writing(false),
+    stopping(false)
+{
+    for (int i = 0; i < DIAGNOSTIC_TYPES; i++) {
+        counts[i] = 0L;
+    }
+}
+
+DiagnosticSink::~DiagnosticSink()
+{
+    flush();
+
+    mutex.lock();
+    stopping = true;
+    batchAvailable.wakeAll();
+    mutex.unlock();
+
+    wait();
+
+    qDeleteAll(buffers);
+}
+
+void DiagnosticSink::setMode(DiagnosticMode mode, int maxExamples)
+{
+    this->mode = mode;
+    this->maxExamples = maxExamples;
+}
+
+void DiagnosticSink::report(DiagnosticType type, QString code, int district, float value)
+{
+    QVector<DiagnosticEvent> *buffer = getLocalBuffer();
+
+    buffer->append({type, district, value, code});
+
+    if (buffer->size() >= DIAGNOSTIC_BATCH_SIZE) {
+        QMutexLocker locker(&mutex);
+        enqueue(buffer);
+    }
+}
+
+void DiagnosticSink::flush()
+{
+    QMutexLocker locker(&mutex);
+
+    for (int i = 0; i < buffers.size(); i++) {
+        enqueue(buffers.at(i));
+    }
+
+    while (!queue.isEmpty() || writing) {
+        batchWritten.wait(&mutex);
+    }
+}
+
+void DiagnosticSink::writeSummary()
+{
+    if (mode != DiagnosticMode::aggregated) {
+        return;
+    }
+
+    for (int i = 0; i < DIAGNOSTIC_TYPES; i++) {
+
+        if (counts[i] == 0) {
+            continue;
+        }
+
+        DiagnosticType type = static_cast<DiagnosticType>(i);
+
+        stream << "\r\n" << ((type == DiagnosticType::usageTypeUnknown) ?
+            QString("Nutzungstyp nicht definiert") :
+            fieldName(type) + " unbekannt") <<
+            ": " << counts[i] << " Meldungen, davon die ersten " <<
+            examples[i].size() << ":\r\n";
+
+        for (int j = 0; j < examples[i].size(); j++) {
+            stream << examples[i].at(j);
+        }
+
+        counts[i] = 0L;
+        examples[i].clear();
+    }
+}
+
+QString DiagnosticSink::render(const DiagnosticEvent & event)
+{
+    if (event.type == DiagnosticType::usageTypeUnknown) {
+        return "\r\nNutzungstyp nicht definiert fuer Element " + event.code +
+            "\r\nTyp=" + QString::number((int) event.value) + " angenommen\r\n";
+    }
+
+    QString name = fieldName(event.type);
+
+    return "\r\n" + name + " unbekannt fuer " + event.code + " von Bezirk " +
+        QString::number(event.district) + "\r\n" + name + "=" +
+        QString::number(event.value) + " angenommen\r\n";
+}
+
+void DiagnosticSink::run()
+{
+    QMutexLocker locker(&mutex);
+
+    while (true) {
+
+        while (queue.isEmpty() && !stopping) {
+            batchAvailable.wait(&mutex);
+        }
+
+        if (queue.isEmpty()) {
+            break;
+        }
+
+        QVector<DiagnosticEvent> batch = queue.dequeue();
+        writing = true;
+
+        // render without blocking the reporting threads
+        locker.unlock();
+        write(batch);
+        locker.relock();
+
+        writing = false;
+
+        if (queue.isEmpty()) {
+            batchWritten.wakeAll();
+        }
+    }
+}
+
+QVector<DiagnosticEvent> *DiagnosticSink::getLocalBuffer()
+{
+    if (!localBuffer.hasLocalData()) {
+
+        QVector<DiagnosticEvent> *buffer = new QVector<DiagnosticEvent>();
+        buffer->reserve(DIAGNOSTIC_BATCH_SIZE);
+
+        QMutexLocker locker(&mutex);
+        buffers.append(buffer);
+        localBuffer.setLocalData({buffer});
+    }
+
+    return localBuffer.localData().buffer;
+}
+
+// Pass the events of a buffer to the writer thread. The mutex must be locked.
+void DiagnosticSink::enqueue(QVector<DiagnosticEvent> *buffer)
+{
+    if (buffer->isEmpty()) {
+        return;
+    }
+
+    queue.enqueue(QVector<DiagnosticEvent>());
+    queue.last().swap(*buffer);
+    buffer->reserve(DIAGNOSTIC_BATCH_SIZE);
+
+    if (!isRunning()) {
+        start();
+    }
+
+    batchAvailable.wakeOne();
+}
+
+void DiagnosticSink::write(const QVector<DiagnosticEvent> & batch)
+{
+    for (int i = 0; i < batch.size(); i++) {
+
+        const DiagnosticEvent &event = batch.at(i);
+
+        if (mode == DiagnosticMode::full) {
+            stream << render(event);
+            continue;
+        }
+
+        int type = static_cast<int>(event.type);
+
+        counts[type]++;
+
+        if (examples[type].size() < maxExamples) {
+            examples[type] << render(event);
+        }
+    }
+}
+
+QString DiagnosticSink::fieldName(DiagnosticType type)
+{
+    switch (type) {
+        case DiagnosticType::unknownETP: return "ETP";
+        case DiagnosticType::unknownETPS: return "ETPS";
+        case DiagnosticType::unknownEG: return "EG";
+        default: return "";
+    }
+}
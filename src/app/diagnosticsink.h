@@ -0,0 +1,107 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef DIAGNOSTICSINK_H
+#define DIAGNOSTICSINK_H
+
+#include <QList>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+#include <QWaitCondition>
+
+// Messages that may be reported once per block partial area
+enum struct DiagnosticType {
+    // usage type not defined, value = assumed type
+    usageTypeUnknown = 0,
+    // no value given for the district, value = assumed value (reported
+    // once per district, see Calculation::districtValue())
+    unknownETP = 1,
+    unknownETPS = 2,
+    unknownEG = 3
+};
+
+#define DIAGNOSTIC_TYPES 4
+
+// number of events that are collected per thread before they are passed
+// to the writer thread
+#define DIAGNOSTIC_BATCH_SIZE 4096
+
+struct DiagnosticEvent {
+    DiagnosticType type;
+    int district;
+    float value;
+    QString code;
+};
+
+enum struct DiagnosticMode {
+    // one paragraph per event (as written by earlier versions)
+    full,
+    // number of events per type and the first examples of each type
+    aggregated
+};
+
+// Collects diagnostic events of the calculation. Events are stored in compact
+// form in a buffer of the reporting thread and rendered into the protocol
+// stream by a background thread. The stream must not be written by others
+// until flush() has returned.
+class DiagnosticSink : public QThread
+{
+public:
+    DiagnosticSink(QTextStream & stream);
+    ~DiagnosticSink();
+    void setMode(DiagnosticMode mode, int maxExamples = 10);
+    void report(DiagnosticType type, QString code, int district, float value);
+
+    // Write all pending events. Must not be called while other threads
+    // report events.
+    void flush();
+
+    // Write the counts and examples collected in aggregated mode and reset
+    // them. Call flush() before.
+    void writeSummary();
+
+    static QString render(const DiagnosticEvent & event);
+
+protected:
+    void run();
+
+private:
+    // buffer of the reporting thread (owned by the sink, not by the thread)
+    struct BufferRef {
+        QVector<DiagnosticEvent> *buffer;
+    };
+
+    QTextStream & stream;
+    DiagnosticMode mode;
+    int maxExamples;
+
+    QThreadStorage<BufferRef> localBuffer;
+    QList<QVector<DiagnosticEvent>*> buffers;
+
+    // batches waiting for the writer thread
+    QQueue<QVector<DiagnosticEvent> > queue;
+    QMutex mutex;
+    QWaitCondition batchAvailable;
+    QWaitCondition batchWritten;
+    bool writing;
+    bool stopping;
+
+    // aggregated mode
+    long counts[DIAGNOSTIC_TYPES];
+    QStringList examples[DIAGNOSTIC_TYPES];
+
+    QVector<DiagnosticEvent> *getLocalBuffer();
+    void enqueue(QVector<DiagnosticEvent> *buffer);
+    void write(const QVector<DiagnosticEvent> & batch);
+    static QString fieldName(DiagnosticType type);
+};
+
+#endif
@@ -0,0 +1,55 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include "districtvalues.h"
+
+DistrictValues::DistrictValues():
+    fallback(0)
+{
+}
+
+void DistrictValues::compile(const QHash<int, int> &hash, int defaultValue)
+{
+    int size = 0;
+
+    this->hash = hash;
+    fallback = hash.contains(0) ? hash.value(0) : defaultValue;
+
+    for (QHash<int, int>::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it) {
+        if (it.key() >= size) {
+            size = it.key() + 1;
+        }
+    }
+
+    values.fill(fallback, size);
+    defaulted.fill(true, size);
+    reported.fill(false, size);
+    reportedOutside.clear();
+
+    for (QHash<int, int>::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it) {
+        if (it.key() >= 0) {
+            values[it.key()] = it.value();
+            defaulted[it.key()] = false;
+        }
+    }
+}
+
+bool DistrictValues::markReported(int district)
+{
+    if (district >= 0 && district < reported.size()) {
+        if (reported.at(district)) {
+            return false;
+        }
+        reported[district] = true;
+        return true;
+    }
+
+    if (reportedOutside.contains(district)) {
+        return false;
+    }
+
+    reportedOutside.insert(district);
+    return true;
+}
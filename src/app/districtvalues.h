@@ -0,0 +1,56 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef DISTRICTVALUES_H
+#define DISTRICTVALUES_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+// Parameter given per district (ETP, ETPS or EG of InitValues), compiled into
+// dense arrays indexed by the district number (BEZIRK). Districts without a
+// value get the value of district 0 or, if there is none, the default value
+// and are flagged as defaulted, as in Calculation::getKLIMA() before.
+// Districts outside of the arrays (negative or above the highest district of
+// the hash) are looked up in the hash.
+class DistrictValues
+{
+public:
+    DistrictValues();
+    void compile(const QHash<int, int> &hash, int defaultValue);
+
+    int value(int district) const
+    {
+        if (district >= 0 && district < values.size()) {
+            return values.at(district);
+        }
+
+        return hash.value(district, fallback);
+    }
+
+    bool isDefaulted(int district) const
+    {
+        if (district >= 0 && district < defaulted.size()) {
+            return defaulted.at(district);
+        }
+
+        return !hash.contains(district);
+    }
+
+    // true on the first call for a district since compile()
+    bool markReported(int district);
+
+private:
+    QHash<int, int> hash;
+    int fallback;
+
+    QVector<int> values;
+    QVector<bool> defaulted;
+    QVector<bool> reported;
+    QSet<int> reportedOutside;
+};
+
+#endif // DISTRICTVALUES_H
@@ -1,11 +1,13 @@
 #include "effectivenessunsealed.h"
 
 #include "constants.h"
+#include "lookuptable.h"
 #include "pdr.h"
 
 // parameter values x1, x2, x3, x4 and x5 (one column each)
 // for calculating the effectiveness parameter n for unsealed surfaces
-const float EffectivenessUnsealed::EKA[]= {
+// (one row per yield class)
+static constexpr LookupMatrix<13, 5> EKA(
     0.04176F, -0.647F , 0.218F  ,  0.01472F, 0.0002089F,
     0.04594F, -0.314F , 0.417F  ,  0.02463F, 0.0001143F,
     0.05177F, -0.010F , 0.596F  ,  0.02656F, 0.0002786F,
@@ -19,7 +21,14 @@ const float EffectivenessUnsealed::EKA[]= {
     0.155F  ,  1.5F   , 2.64999F,  0.0725F , 0.001249F ,
     0.20041F,  2.0918F, 3.69999F,  0.08F   , 0.001999F ,
     0.33895F,  3.721F , 6.69999F, -0.07F   , 0.013F
-};
+);
+
+// G02 (available water in the root zone) by usable field capacity nFK (0..30)
+static constexpr LookupTable<31> G02tab(
+    0.0F,   0.0F,  0.0F,  0.0F,  0.3F,  0.8F,  1.4F,  2.4F,  3.7F,  5.0F,
+    6.3F,   7.7F,  9.3F, 11.0F, 12.4F, 14.7F, 17.4F, 21.0F, 26.0F, 32.0F,
+    39.4F, 44.7F, 48.0F, 50.7F, 52.7F, 54.0F, 55.0F, 55.0F, 55.0F, 55.0F, 55.0F
+);
 
 EffectivenessUnsealed::EffectivenessUnsealed()
 {
@@ -32,25 +41,35 @@ EffectivenessUnsealed::EffectivenessUnsealed()
  */
 float EffectivenessUnsealed::getNUV(PDR &record)
 {
-    float G020 = getG02((int) (record.nFK + 0.5));
-    Usage usage = record.NUT;
+    float result = getBag0(record.nFK, record.NUT, record.ERT);
+
+    // Modifikation, wenn keine Sommerwerte
+    if (
+        record.NUT != Usage::forested_W && record.BER > 0 &&
+        record.P1S == 0 && record.ETPS == 0
+    ) {
+        result = nonSummerCorrected(result, record.BER);
+    }
+
+    return result;
+}
+
+// Effectiveness parameter of unsealed surfaces that only depends on soil and
+// usage. getNUV() applies the correction for missing summer values on top.
+float EffectivenessUnsealed::getBag0(float nFK, Usage usage, int yield)
+{
+    float G020 = getG02((int) (nFK + 0.5));
 
     if (usage == Usage::forested_W) {
         return bag0_forest(G020);
     }
 
-    return bag0_default(G020, record.ERT, record.BER, (record.P1S == 0 && record.ETPS == 0));
+    return bag0_default(G020, yield);
 }
 
 float EffectivenessUnsealed::getG02(int nFK)
 {
-    const float G02tab [] = {
-        0.0F,   0.0F,  0.0F,  0.0F,  0.3F,  0.8F,  1.4F,  2.4F,  3.7F,  5.0F,
-        6.3F,   7.7F,  9.3F, 11.0F, 12.4F, 14.7F, 17.4F, 21.0F, 26.0F, 32.0F,
-        39.4F, 44.7F, 48.0F, 50.7F, 52.7F, 54.0F, 55.0F, 55.0F, 55.0F, 55.0F, 55.0F
-    };
-
-    return G02tab[nFK];
+    return G02tab.at(nFK);
 }
 
 float EffectivenessUnsealed::bag0_forest(float G020)
@@ -66,7 +85,7 @@ float EffectivenessUnsealed::bag0_forest(float G020)
     return 8.0F;
 }
 
-float EffectivenessUnsealed::bag0_default(float G020, int yield, int irrigation, bool notSummer)
+float EffectivenessUnsealed::bag0_default(float G020, int yield)
 {
     int k;
     float result;
@@ -82,20 +101,16 @@ float EffectivenessUnsealed::bag0_default(float G020, int yield, int irrigation,
         k--;
     }
 
-    k = 5 * MIN(k, 13) - 2;
+    // row of EKA
+    k = MIN(k, 13) - 1;
 
-    result = EKA[k - 1] + EKA[k] * G020 + EKA[k + 1] * G020 * G020;
+    result = EKA.at(k, 2) + EKA.at(k, 3) * G020 + EKA.at(k, 4) * G020 * G020;
 
     condition_1 = (result >= 2.0) && (yield < 60);
     condition_2 = (G020 >= 20.0) && (yield >= 60);
 
     if (condition_1 || condition_2) {
-        result = EKA[k - 3] * G020 + EKA[k - 2];
-    }
-
-    // Modifikation, wenn keine Sommerwerte
-    if (irrigation > 0 && notSummer) {
-        result = nonSummerCorrected(result, irrigation);
+        result = EKA.at(k, 0) * G020 + EKA.at(k, 1);
     }
 
     return result;
@@ -103,5 +118,5 @@ float EffectivenessUnsealed::bag0_default(float G020, int yield, int irrigation,
 
 float EffectivenessUnsealed::nonSummerCorrected(float x, int irrigation)
 {
-    return x * (0.9985F + 0.00284F * irrigation - 0.00000379762F * irrigation * irrigation);
+    return nonSummerCorrected<LegacyFloatPolicy>(x, irrigation);
 }
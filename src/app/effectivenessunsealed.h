@@ -2,19 +2,30 @@
 #define EFFECTIVENESSUNSEALED_H
 
 #include "pdr.h"
+#include "precision.h"
 
 class EffectivenessUnsealed
 {
 private:
-    const static float EKA[];
     static float getG02(int nFK);
     static float bag0_forest(float G020);
-    static float bag0_default(float G020, int yield, int irrigation, bool notSummer);
-    static float nonSummerCorrected(float x, int irrigation);
+    static float bag0_default(float G020, int yield);
 
 public:
     EffectivenessUnsealed();
     static float getNUV(PDR &record);
+    static float getBag0(float nFK, Usage usage, int yield);
+    static float nonSummerCorrected(float x, int irrigation);
+
+    // with the arithmetic of the policy P (see precision.h)
+    template <class P>
+    static typename P::real nonSummerCorrected(typename P::real x, int irrigation)
+    {
+        typedef typename P::real real;
+
+        return x * ((real) 0.9985F + (real) 0.00284F * irrigation -
+            (real) 0.00000379762F * irrigation * irrigation);
+    }
 };
 
 #endif // EFFECTIVENESSUNSEALED_H
@@ -39,6 +39,23 @@ QString Helpers::singleQuote(QString string)
     return "'" + string + "'";
 }
 
+// Value as field of a CSV line, quoted (with doubled quotes) if it contains
+// a comma, a quote or a line break
+QString Helpers::csvField(const QString &value)
+{
+    if (
+        !value.contains(',') && !value.contains('"') &&
+        !value.contains('\n') && !value.contains('\r')
+    ) {
+        return value;
+    }
+
+    QString quoted = value;
+    quoted.replace("\"", "\"\"");
+
+    return "\"" + quoted + "\"";
+}
+
 QString Helpers::patternDbfFile()
 {
     return QString("dBase (*.dbf)");
@@ -59,6 +76,16 @@ QString Helpers::defaultLogFileName(QString outputFileName)
     return Helpers::removeFileExtension(outputFileName)  + ".log";
 }
 
+QString Helpers::defaultSeriesFileName(QString inputFileName)
+{
+    return Helpers::removeFileExtension(inputFileName)  + "_series.csv";
+}
+
+QString Helpers::defaultModelFileName(QString inputFileName)
+{
+    return Helpers::removeFileExtension(inputFileName)  + ".abm";
+}
+
 // Return true if all keys are contained in the hash, else false
 bool Helpers::containsAll(QHash<QString, int> hash, QStringList keys)
 {
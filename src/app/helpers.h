@@ -14,10 +14,13 @@ public:
     static QString nowString();
     static QString positionalArgOrNULL(QCommandLineParser*, int);
     static QString singleQuote(QString);
+    static QString csvField(const QString &value);
     static QString patternDbfFile();
     static QString patternXmlFile();
     static QString defaultOutputFileName(QString inputFileName);
     static QString defaultLogFileName(QString outputFileName);
+    static QString defaultSeriesFileName(QString inputFileName);
+    static QString defaultModelFileName(QString inputFileName);
     static bool containsAll(QHash<QString, int> hash, QStringList keys);
     static void openFileOrAbort(QFile& file, QIODevice::OpenModeFlag mode = QIODevice::ReadOnly);
     static bool filesAreIdentical(QString file_1, QString file_2, bool debug = true, int maxDiffs = 5);
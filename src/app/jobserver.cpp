@@ -0,0 +1,349 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QTextStream>
+
+#include "calculation.h"
+#include "diagnosticsink.h"
+#include "helpers.h"
+#include "jobserver.h"
+
+namespace {
+
+// One calculation job, same as a batch run of main_batch()
+class ServerJob : public QRunnable
+{
+public:
+    ServerJob(
+        JobServer *server, int id, QString input, QString config,
+        QString output, bool deduplicate, int logSummary
+    ):
+        server(server), id(id), input(input), config(config), output(output),
+        deduplicate(deduplicate), logSummary(logSummary)
+    {
+    }
+
+    void run()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        JobStatus status = {JobState::running, QString(), {0, 0, 0, 0L, 0L, 0L}, 0};
+        server->setStatus(id, status);
+
+        status.state = JobState::failed;
+
+        QSharedPointer<DbaseReader> dbReader = server->loadInput(input, status.error);
+
+        if (!dbReader.isNull()) {
+            calculate(*dbReader, *server->loadConfig(config), status);
+        }
+
+        status.milliseconds = timer.elapsed();
+        server->setStatus(id, status);
+
+        QMetaObject::invokeMethod(server, "jobFinished", Qt::QueuedConnection, Q_ARG(int, id));
+    }
+
+private:
+    JobServer *server;
+    int id;
+    QString input;
+    QString config;
+    QString output;
+    bool deduplicate;
+    int logSummary;
+
+    void calculate(DbaseReader &dbReader, InitValues &initValues, JobStatus &status)
+    {
+        QFile logFile(Helpers::defaultLogFileName(output));
+
+        if (!logFile.open(QFile::WriteOnly)) {
+            status.error = "Konnte Datei: '" + logFile.fileName() + "' nicht oeffnen.";
+            return;
+        }
+
+        QTextStream logStream(&logFile);
+
+        logStream << "Start der Berechnung " + Helpers::nowString() + "\r\n";
+
+        Calculation calculator(dbReader, initValues, logStream);
+        calculator.setDeduplicate(deduplicate);
+
+        if (logSummary >= 0) {
+            calculator.setDiagnosticMode(DiagnosticMode::aggregated, logSummary);
+        }
+
+        if (calculator.calc(output)) {
+            status.state = JobState::finished;
+        }
+
+        status.error = calculator.getError();
+        status.counters = calculator.getCounters();
+
+        logFile.close();
+    }
+};
+
+QString stateName(JobState state)
+{
+    switch (state) {
+        case JobState::queued: return "queued";
+        case JobState::running: return "running";
+        case JobState::finished: return "finished";
+        default: return "failed";
+    }
+}
+
+} // namespace
+
+JobServer::JobServer(int cacheSize, int finishedJobs, QObject *parent):
+    QObject(parent),
+    inputs(cacheSize),
+    configs(cacheSize),
+    lastJobId(0),
+    finishedJobs(finishedJobs)
+{
+    connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+
+// Keep running and calculate the jobs sent by clients (see --serve)
+int JobServer::serve(QCoreApplication &app, QString name)
+{
+    JobServer server;
+
+    if (!server.listen(name)) {
+        qDebug() << "Error: " << server.getError();
+        return 1;
+    }
+
+    qDebug() << "Job server listening on " << server.fullServerName();
+
+    return app.exec();
+}
+
+bool JobServer::listen(QString name)
+{
+    // remove the socket file of a server that was not shut down properly
+    QLocalServer::removeServer(name);
+
+    if (!server.listen(name)) {
+        error = server.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+QString JobServer::getError()
+{
+    return error;
+}
+
+QString JobServer::fullServerName()
+{
+    return server.fullServerName();
+}
+
+QSharedPointer<DbaseReader> JobServer::loadInput(QString fileName, QString &error)
+{
+    QFileInfo info(fileName);
+    QString key = info.absoluteFilePath();
+
+    QSharedPointer<DbaseReader> dbReader = inputs.get(key, info.lastModified());
+
+    if (!dbReader.isNull()) {
+        return dbReader;
+    }
+
+    // Read outside of the cache lock, other jobs continue meanwhile
+    dbReader = QSharedPointer<DbaseReader>(new DbaseReader(fileName));
+
+    if (!dbReader->checkAndRead()) {
+        error = dbReader->getFullError();
+        return QSharedPointer<DbaseReader>();
+    }
+
+    inputs.put(key, info.lastModified(), dbReader);
+
+    return dbReader;
+}
+
+// As in main_batch(), a missing or incomplete configuration file is not an
+// error, default values are used instead
+QSharedPointer<InitValues> JobServer::loadConfig(QString fileName)
+{
+    QFileInfo info(fileName);
+    QString key = fileName.isEmpty() ? QString() : info.absoluteFilePath();
+
+    QSharedPointer<InitValues> initValues = configs.get(key, info.lastModified());
+
+    if (!initValues.isNull()) {
+        return initValues;
+    }
+
+    initValues = QSharedPointer<InitValues>(new InitValues());
+
+    if (!fileName.isEmpty()) {
+        InitValues::updateFromConfig(*initValues, fileName);
+    }
+
+    configs.put(key, info.lastModified(), initValues);
+
+    return initValues;
+}
+
+void JobServer::setStatus(int id, JobStatus status)
+{
+    QMutexLocker locker(&mutex);
+    jobs.insert(id, status);
+}
+
+void JobServer::newConnection()
+{
+    QLocalSocket *socket;
+
+    while ((socket = server.nextPendingConnection()) != 0) {
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+void JobServer::readRequests()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+
+    while (socket != 0 && socket->canReadLine()) {
+
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(socket->readLine(), &parseError);
+
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+            reply(socket, {{"error", "invalid request: " + parseError.errorString()}});
+            continue;
+        }
+
+        QJsonObject request = document.object();
+        QString command = request.value("command").toString();
+
+        if (command == "submit") {
+            bool deferred = false;
+            QJsonObject result = submit(request, socket, deferred);
+            if (!deferred) {
+                reply(socket, result);
+            }
+        }
+        else if (command == "status") {
+            reply(socket, statusObject(request.value("job").toInt()));
+        }
+        else {
+            reply(socket, {{"error", "unknown command: " + command}});
+        }
+    }
+}
+
+QJsonObject JobServer::submit(QJsonObject request, QLocalSocket *socket, bool &deferred)
+{
+    QString input = request.value("input").toString();
+    QString output = request.value("output").toString();
+
+    if (input.isEmpty()) {
+        return {{"error", "no input given"}};
+    }
+
+    if (output.isEmpty()) {
+        output = Helpers::defaultOutputFileName(input);
+    }
+
+    QString outputKey = QFileInfo(output).absoluteFilePath();
+
+    if (outputs.contains(outputKey)) {
+        return {{"error", "output in use by job " + QString::number(outputs.value(outputKey))}};
+    }
+
+    QJsonObject options = request.value("options").toObject();
+
+    int id;
+
+    mutex.lock();
+    id = ++lastJobId;
+    jobs.insert(id, {JobState::queued, QString(), {0, 0, 0, 0L, 0L, 0L}, 0});
+    mutex.unlock();
+
+    outputs.insert(outputKey, id);
+
+    if (request.value("wait").toBool()) {
+        waiting[id].append(QPointer<QLocalSocket>(socket));
+        deferred = true;
+    }
+
+    pool.start(new ServerJob(
+        this, id, input, request.value("config").toString(), output,
+        options.value("dedup").toBool(), options.value("logSummary").toInt(-1)
+    ));
+
+    return statusObject(id);
+}
+
+void JobServer::jobFinished(int id)
+{
+    outputs.remove(outputs.key(id));
+
+    // the status of the oldest finished jobs is dropped
+    mutex.lock();
+    finished.append(id);
+    while (finished.size() > finishedJobs) {
+        jobs.remove(finished.takeFirst());
+    }
+    mutex.unlock();
+
+    QList<QPointer<QLocalSocket> > sockets = waiting.take(id);
+
+    for (int i = 0; i < sockets.size(); i++) {
+        if (!sockets.at(i).isNull()) {
+            reply(sockets.at(i), statusObject(id));
+        }
+    }
+}
+
+QJsonObject JobServer::statusObject(int id)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!jobs.contains(id)) {
+        return {{"job", id}, {"error", "unknown job"}};
+    }
+
+    const JobStatus &status = jobs[id];
+
+    QJsonObject object = {
+        {"job", id},
+        {"status", stateName(status.state)},
+        {"recordsRead", status.counters.totalRecRead},
+        {"recordsWritten", status.counters.totalRecWrite},
+        {"messages", (double) status.counters.protcount},
+        {"milliseconds", (double) status.milliseconds}
+    };
+
+    if (!status.error.isEmpty()) {
+        object.insert("error", status.error);
+    }
+
+    return object;
+}
+
+void JobServer::reply(QLocalSocket *socket, QJsonObject object)
+{
+    socket->write(QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n');
+    socket->flush();
+}
@@ -0,0 +1,160 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "calculation.h"
+#include "dbaseReader.h"
+#include "initvalues.h"
+
+// Least recently used cache of files loaded by the job server. An entry is
+// only returned if the file has not been modified since it was loaded.
+// Values are shared, an evicted value lives as long as a job uses it.
+template<class T>
+class LruCache
+{
+public:
+    LruCache(int capacity): capacity(capacity) {}
+
+    QSharedPointer<T> get(QString key, QDateTime modified)
+    {
+        QMutexLocker locker(&mutex);
+
+        if (!entries.contains(key) || entries.value(key).modified != modified) {
+            return QSharedPointer<T>();
+        }
+
+        // most recently used first
+        order.removeOne(key);
+        order.prepend(key);
+
+        return entries.value(key).value;
+    }
+
+    void put(QString key, QDateTime modified, QSharedPointer<T> value)
+    {
+        QMutexLocker locker(&mutex);
+
+        order.removeOne(key);
+        order.prepend(key);
+        entries.insert(key, {modified, value});
+
+        while (order.size() > capacity) {
+            entries.remove(order.takeLast());
+        }
+    }
+
+private:
+    struct Entry {
+        QDateTime modified;
+        QSharedPointer<T> value;
+    };
+
+    int capacity;
+    QMutex mutex;
+    QHash<QString, Entry> entries;
+    QStringList order;
+};
+
+// number of finished jobs whose status is kept, the status of older jobs is
+// no longer known
+#define JOBSERVER_FINISHED_JOBS 1000
+
+enum struct JobState {
+    queued,
+    running,
+    finished,
+    failed
+};
+
+struct JobStatus {
+    JobState state;
+    QString error;
+    Counters counters;
+    qint64 milliseconds;
+};
+
+// Runs calculation jobs received as JSON over a local socket (see --serve).
+// Each request is one line with a JSON object, each reply as well:
+//
+//   {"command": "submit", "input": "in.dbf", "config": "config.xml",
+//    "output": "out.dbf", "options": {"dedup": true, "logSummary": 10},
+//    "wait": true}
+//   {"command": "status", "job": 1}
+//
+// Jobs run concurrently on a thread pool. Input files and configurations
+// are kept in LRU caches, so repeated jobs on the same data do not read or
+// parse any file except when it was modified. A job is rejected while
+// another job writes the same output file (and with it the same protocol).
+class JobServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    JobServer(
+        int cacheSize = 4, int finishedJobs = JOBSERVER_FINISHED_JOBS, QObject *parent = 0
+    );
+    static int serve(QCoreApplication &app, QString name);
+    bool listen(QString name);
+    QString getError();
+    QString fullServerName();
+
+    // Used by the jobs (from any thread)
+    QSharedPointer<DbaseReader> loadInput(QString fileName, QString &error);
+    QSharedPointer<InitValues> loadConfig(QString fileName);
+    void setStatus(int id, JobStatus status);
+
+private slots:
+    void newConnection();
+    void readRequests();
+    void jobFinished(int id);
+
+private:
+    QLocalServer server;
+    QThreadPool pool;
+    LruCache<DbaseReader> inputs;
+    LruCache<InitValues> configs;
+    QString error;
+
+    // status of all jobs, protected by mutex
+    QMutex mutex;
+    QHash<int, JobStatus> jobs;
+    int lastJobId;
+
+    // ids of the finished jobs still in jobs, oldest first (server thread
+    // only)
+    QList<int> finished;
+    int finishedJobs;
+
+    // absolute output file name of each queued or running job (server
+    // thread only)
+    QHash<QString, int> outputs;
+
+    // sockets waiting for the end of a job (server thread only)
+    QHash<int, QList<QPointer<QLocalSocket> > > waiting;
+
+    QJsonObject submit(QJsonObject request, QLocalSocket *socket, bool &deferred);
+    QJsonObject statusObject(int id);
+    void reply(QLocalSocket *socket, QJsonObject object);
+};
+
+#endif
@@ -0,0 +1,220 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef LOOKUPTABLE_H
+#define LOOKUPTABLE_H
+
+#include <assert.h>
+
+// Indices are checked in debug builds only (see common.pri)
+#ifdef ABIMO_CHECK_BOUNDS
+#define LOOKUP_CHECK(condition) assert(condition)
+#else
+#define LOOKUP_CHECK(condition)
+#endif
+
+// Empirical tables of the model (usable field capacity, potential ascent,
+// capillary rise, effectiveness parameters). All tables are built at compile
+// time.
+
+// Values v[0..N-1], e.g. a column of a table given per integer value
+template <int N>
+class LookupTable
+{
+public:
+    template <typename... T>
+    constexpr LookupTable(T... values): v{values...}
+    {
+        static_assert(sizeof...(T) == N, "wrong number of table values");
+    }
+
+    float at(int i) const
+    {
+        LOOKUP_CHECK(i >= 0 && i < N);
+        return v[i];
+    }
+
+    // ys[k] = at(is[k]) for k = 0..n-1
+    void at(const int *is, float *ys, int n) const
+    {
+        for (int k = 0; k < n; k++) {
+            ys[k] = at(is[k]);
+        }
+    }
+
+    static constexpr int size() { return N; }
+
+private:
+    float v[N];
+};
+
+// Matrix of R rows and C columns, given row by row
+template <int R, int C>
+class LookupMatrix
+{
+public:
+    template <typename... T>
+    constexpr LookupMatrix(T... values): v{values...}
+    {
+        static_assert(sizeof...(T) == R * C, "wrong number of matrix values");
+    }
+
+    float at(int row, int column) const
+    {
+        LOOKUP_CHECK(row >= 0 && row < R && column >= 0 && column < C);
+        return v[row * C + column];
+    }
+
+private:
+    float v[R * C];
+};
+
+// Sorted breakpoints x[0] < ... < x[N-1] (e.g. the row or column labels of a
+// LookupMatrix). index() returns the first i with xi <= x[i] + epsilon or
+// N - 1 if there is none, as Helpers::index() does. The bin of a value is
+// found in constant time: the range of the breakpoints is divided into
+// LOOKUP_BUCKETS_PER_BREAKPOINT * N buckets of equal width, each bucket holds
+// the first candidate index of its values. The comparisons that finally
+// decide the index are the same as in Helpers::index(), so the results are
+// identical for all values.
+#define LOOKUP_BUCKETS_PER_BREAKPOINT 4
+
+template <int N>
+class LookupAxis
+{
+public:
+    template <typename... T>
+    constexpr LookupAxis(float epsilon, T... values):
+        x{values...},
+        epsilon(epsilon),
+        lower(0.0F),
+        scale(0.0F),
+        first{}
+    {
+        static_assert(sizeof...(T) == N, "wrong number of breakpoints");
+
+        lower = x[0] + epsilon;
+        scale = BUCKETS / ((x[N - 1] + epsilon) - lower);
+
+        // first candidate of bucket b: first breakpoint at or above its lower
+        // bound (the candidate is corrected in index() if the bucket of a
+        // value is rounded differently)
+        int i = 0;
+
+        for (int b = 0; b < BUCKETS; b++) {
+
+            float bound = lower + b / scale;
+
+            while (i < N - 1 && x[i] + epsilon < bound) {
+                i++;
+            }
+
+            first[b] = i;
+        }
+    }
+
+    int index(float xi) const
+    {
+        if (xi <= x[0] + epsilon) {
+            return 0;
+        }
+
+        // above the last breakpoint or NaN
+        if (!(xi <= x[N - 1] + epsilon)) {
+            return N - 1;
+        }
+
+        int b = (int) ((xi - lower) * scale);
+
+        if (b >= BUCKETS) {
+            b = BUCKETS - 1;
+        }
+
+        int i = first[b];
+
+        while (i > 0 && xi <= x[i - 1] + epsilon) {
+            i--;
+        }
+
+        while (i < N - 1 && !(xi <= x[i] + epsilon)) {
+            i++;
+        }
+
+        return i;
+    }
+
+    // is[k] = index(xs[k]) for k = 0..n-1
+    void index(const float *xs, int *is, int n) const
+    {
+        for (int k = 0; k < n; k++) {
+            is[k] = index(xs[k]);
+        }
+    }
+
+    float at(int i) const
+    {
+        LOOKUP_CHECK(i >= 0 && i < N);
+        return x[i];
+    }
+
+    static constexpr int size() { return N; }
+
+private:
+    static constexpr int BUCKETS = LOOKUP_BUCKETS_PER_BREAKPOINT * N;
+
+    float x[N];
+    float epsilon;
+    float lower;
+    float scale;
+    int first[BUCKETS];
+};
+
+// Step function y(x) given by N breakpoints x and N values y: y[0] up to
+// x[0], y[N-1] from x[N-1] on and the mean of the two neighbouring values
+// within a bin, as Helpers::interpolate() does.
+template <int N>
+class LookupSteps
+{
+public:
+    constexpr LookupSteps(const LookupAxis<N> &x, const LookupTable<N> &y):
+        x(x),
+        y(y)
+    {
+    }
+
+    float value(float xi) const
+    {
+        if (xi <= x.at(0)) {
+            return y.at(0);
+        }
+
+        if (xi >= x.at(N - 1)) {
+            return y.at(N - 1);
+        }
+
+        // NaN
+        if (xi != xi) {
+            return 0.0F;
+        }
+
+        int i = x.index(xi);
+
+        return (y.at(i - 1) + y.at(i)) / 2;
+    }
+
+    // ys[k] = value(xs[k]) for k = 0..n-1
+    void value(const float *xs, float *ys, int n) const
+    {
+        for (int k = 0; k < n; k++) {
+            ys[k] = value(xs[k]);
+        }
+    }
+
+private:
+    LookupAxis<N> x;
+    LookupTable<N> y;
+};
+
+#endif // LOOKUPTABLE_H
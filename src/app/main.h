@@ -4,13 +4,7 @@
 //#include <QString>
 //void calculate(QString inputFile, QString configFile, QString outputFile);
 
-void writeBagrovTable(
-    float bag_min = 0.1F,
-    float bag_max = 10.0F,
-    float bag_step = 0.1F,
-    float x_min = 0.1F,
-    float x_max = 15.1F,
-    float x_step = 0.1F
-);
+bool parseForBatch(int &argc, char** argv);
+int main_gui(int argc, char *argv[]);
 
 #endif // MAIN_H
@@ -6,7 +6,6 @@
 #include <QAction>
 #include <QApplication>
 #include <QCommandLineParser>
-#include <QEventLoop>
 #include <QFont>
 #include <QFile>
 #include <QFileDialog>
@@ -16,12 +15,11 @@
 #include <QMessageBox>
 #include <QProgressDialog>
 #include <QString>
-#include <QTextStream>
+#include <QThread>
 #include <QWidget>
 
-#include "calculation.h"
+#include "calculationworker.h"
 #include "constants.h"
-#include "dbaseReader.h"
 #include "helpers.h"
 #include "initvalues.h"
 #include "mainwindow.h"
@@ -30,7 +28,8 @@ MainWindow::MainWindow(QApplication* app, QCommandLineParser* arguments):
     QMainWindow(),
     programName(tr(PROGRAM_NAME)),
     userStop(false),
-    calc(0),
+    worker(0),
+    workerThread(0),
     app(app),
     arguments(arguments),
     folder("/")
@@ -69,6 +68,19 @@ MainWindow::MainWindow(QApplication* app, QCommandLineParser* arguments):
 
 MainWindow::~MainWindow()
 {
+    // Wait for a running calculation. Its deleteLater() calls are not
+    // processed any more, the worker and its thread are deleted here.
+    if (worker != 0) {
+        worker->stop();
+        workerThread->quit();
+        workerThread->wait();
+
+        delete worker;
+        delete workerThread;
+        worker = 0;
+        workerThread = 0;
+    }
+
     delete textfield;
     delete openAct;
     delete aboutAct;
@@ -80,7 +92,6 @@ void MainWindow::processEvent(int i, QString string)
 {
     progress->setValue(i);
     progress->setLabelText(string);
-    app->processEvents(QEventLoop::ExcludeUserInputEvents);
 }
 
 void MainWindow::userCancel()
@@ -88,11 +99,9 @@ void MainWindow::userCancel()
     userStop = true;
     setText("Berechnungen abgebrochen.");
 
-    if (calc != 0) {
-        calc->stop();
+    if (worker != 0) {
+        worker->stop();
     }
-
-    app->processEvents(QEventLoop::ExcludeUserInputEvents);
 }
 
 void MainWindow::about()
@@ -126,7 +135,6 @@ void MainWindow::computeFile()
     QString inputFileName = Helpers::positionalArgOrNULL(arguments, 0);
     QString outputFileName = Helpers::positionalArgOrNULL(arguments, 1);
     QString configFileName = arguments->value("config");
-    QString protokollFileName;
 
     userStop = false;
 
@@ -146,27 +154,6 @@ void MainWindow::computeFile()
     // Select configuration file
     configFileName = QString("config.xml");
 
-    // Open a DBASE File
-    DbaseReader dbReader(inputFileName);
-
-    setText("Lese Quelldatei...");
-    repaint();
-
-    if (! dbReader.checkAndRead()) {
-        critical(dbReader.getFullError());
-        return;
-    }
-
-    // Update default initial values with values given in config.xml
-    InitValues initValues;
-    QString errorMessage = InitValues::updateFromConfig(initValues, configFileName);
-
-    if (! errorMessage.isEmpty()) {
-        warning(errorMessage);
-    }
-
-    setText("Quelldatei eingelesen, waehlen Sie eine Zieldatei...");
-
     // Select output file
     outputFileName = QFileDialog::getSaveFileName(
         this,
@@ -184,109 +171,53 @@ void MainWindow::computeFile()
     setText("Bitte Warten...");
     processEvent(0, "Lese Datei.");
 
-    // Protokoll
-    protokollFileName = Helpers::defaultLogFileName(outputFileName);
-
-    QFile protokollFile(protokollFileName);
+    // Read the input file and calculate in a worker thread, the window
+    // stays responsive. Only one calculation may run at a time.
+    openAct->setEnabled(false);
 
-    if (! protokollFile.open(QFile::WriteOnly)) {
-        critical(
-            "Konnte Datei: " + Helpers::singleQuote(protokollFileName) +
-            " nicht oeffnen.\n" + protokollFile.error()
-        );
-        return;
-    }
-
-    QTextStream protokollStream(&protokollFile);
-
-    // Start the Calculation
-    protokollStream << "Start der Berechnung " + Helpers::nowString() + "\r\n";
-
-    // Create calculator object
-    calc = new Calculation(dbReader, initValues, protokollStream);
+    worker = new CalculationWorker(inputFileName, configFileName, outputFileName);
+    workerThread = new QThread(this);
+    worker->moveToThread(workerThread);
 
+    connect(workerThread, SIGNAL(started()), worker, SLOT(run()));
+    connect(worker, SIGNAL(processSignal(int, QString)), this, SLOT(processEvent(int, QString)));
+    connect(worker, SIGNAL(warning(QString)), this, SLOT(warning(QString)));
     connect(
-        calc,
-        SIGNAL(processSignal(int, QString)),
+        worker,
+        SIGNAL(finished(bool, bool, QString)),
         this,
-        SLOT(processEvent(int, QString))
+        SLOT(calculationFinished(bool, bool, QString))
     );
+    connect(worker, SIGNAL(finished(bool, bool, QString)), workerThread, SLOT(quit()));
+    connect(workerThread, SIGNAL(finished()), worker, SLOT(deleteLater()));
+    connect(workerThread, SIGNAL(finished()), workerThread, SLOT(deleteLater()));
 
-    // Do the calculation
-    bool success = calc->calc(outputFileName);
+    workerThread->start();
+}
+
+void MainWindow::calculationFinished(bool success, bool cancelled, QString text)
+{
+    worker = 0;
+    workerThread = 0;
+    openAct->setEnabled(true);
+
+    progress->close();
 
     // Report about success or failure
     if (success) {
-
-        if (userStop) {
-            reportCancelled(protokollStream);
+        if (cancelled || userStop) {
+            reportCancelled();
         }
         else {
-            reportSuccess(calc, protokollStream, outputFileName, protokollFileName);
+            setText(text);
         }
     }
     else {
-        critical(calc->getError());
-    }
-
-    delete calc;
-    calc = 0;
-    protokollFile.close();
-}
-
-void MainWindow::reportSuccess(
-    Calculation* calc,
-    QTextStream &protokollStream,
-    QString outFile,
-    QString protokollFileName
-)
-{
-    QString protCount;
-    QString nutzungIstNull;
-    QString keineFlaechenAngegeben;
-    QString readRecCount;
-    QString writeRecCount;
-
-    Counters counters = calc->getCounters();
-
-    protCount.setNum(counters.protcount);
-    nutzungIstNull.setNum(counters.nutzungIstNull);
-    keineFlaechenAngegeben.setNum(counters.keineFlaechenAngegeben);
-    readRecCount.setNum(counters.totalRecRead);
-    writeRecCount.setNum(counters.totalRecWrite);
-
-    setText(
-        "Berechnungen mit " + protCount + " Fehlern beendet.\n" +
-        "Eingelesene Records: " + readRecCount +"\n" +
-        "Geschriebene Records: " + writeRecCount +"\n" +
-        "Ergebnisse in Datei: '" + outFile + "' geschrieben.\n" +
-        "Protokoll in Datei: '" + protokollFileName + "' geschrieben."
-    );
-
-    protokollStream << "\r\nBei der Berechnung traten " << protCount <<
-        " Fehler auf.\r\n";
-
-    if (counters.keineFlaechenAngegeben != 0) {
-        protokollStream << "\r\nBei " + keineFlaechenAngegeben +
-            " Flaechen deren Wert 0 war wurde 100 eingesetzt.\r\n";
+        critical(text);
     }
-
-    if (counters.nutzungIstNull != 0) {
-        protokollStream << "\r\nBei " + nutzungIstNull +
-            " Records war die Nutzung 0, diese wurden ignoriert.\r\n";
-    }
-
-    if (counters.totalBERtoZeroForced != 0) {
-        protokollStream << "\r\nBei " << counters.totalBERtoZeroForced <<
-            " Records wurde BER==0 erzwungen.\r\n";
-    }
-
-    protokollStream << "\r\nEingelesene Records: " + readRecCount + "\r\n";
-    protokollStream << "\r\nGeschriebene Records: " + writeRecCount + "\r\n";
-    protokollStream << "\r\nEnde der Berechnung " + Helpers::nowString() + "\r\n";
 }
 
-void MainWindow::reportCancelled(QTextStream & /*protokollStream*/)
+void MainWindow::reportCancelled()
 {
     setText("Die Berechnungen wurden durch den Benutzer abgebrochen.");
 
@@ -14,10 +14,10 @@
 #include <QObject>
 #include <QProgressDialog>
 #include <QString>
-#include <QTextStream>
+#include <QThread>
 #include <QWidget>
 
-#include "calculation.h"
+#include "calculationworker.h"
 #include "initvalues.h"
 
 class MainWindow : public QMainWindow
@@ -34,20 +34,21 @@ private slots:
     void about();
     void computeFile();
     void userCancel();
+    void warning(QString);
+    void calculationFinished(bool, bool, QString);
 
 private:
     const QString programName;
     void setText(QString);
     void critical(QString);
-    void warning(QString);
-    void reportSuccess(Calculation*, QTextStream&, QString, QString);
-    void reportCancelled(QTextStream&);
+    void reportCancelled();
     QAction *openAct;
     QAction *aboutAct;
     QLabel *textfield;
     QProgressDialog * progress;
     bool userStop;
-    Calculation* calc;
+    CalculationWorker* worker;
+    QThread* workerThread;
     QApplication* app;
     QCommandLineParser* arguments;
     QString folder;
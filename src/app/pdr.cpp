@@ -5,7 +5,6 @@
 
 #include <math.h> // for abs()
 
-#include "config.h"
 #include "constants.h" // for MIN() macro
 #include "pdr.h"
 
@@ -6,8 +6,6 @@
 #ifndef PDR_H
 #define PDR_H
 
-#include <QString>
-
 // Descriptions from here:
 // https://www.berlin.de/umweltatlas/_assets/wasser/wasserhaushalt/
 //   de-abbildungen/maxsize_405ab3ac7c0e2104d3a03c317ddd93f0_a213_02a.jpg
@@ -26,11 +24,6 @@ enum struct Usage: char {
     unknown = '?'
 };
 
-struct UsageResult {
-    int tupleIndex;
-    QString message;
-};
-
 struct UsageTuple {
     Usage usage;
     int yield;
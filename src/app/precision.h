@@ -0,0 +1,107 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include <math.h>
+#include <string.h> // for memcpy()
+
+// Arithmetic of the calculation kernel (Bagrov relation and water balance of
+// a block, see Bagrov::evaluate() and Calculation::evaluateBlock()). The
+// kernel is a template on one of the policies below, which provide the
+// floating point type `real` and the functions exp() and log(). The input
+// (block state and configuration) is float in all cases.
+enum struct Precision {
+    // float, as in all former versions (reference results)
+    legacyFloat,
+    // double, same formulas and constants, for verification
+    doublePrecision,
+    // float with polynomial approximations of exp() and log()
+    fastFloat
+};
+
+// float with the exp() and log() of the C++ library. The functions are
+// called with the same argument types as in the former code (float or
+// double), the results are bit-identical to it.
+struct LegacyFloatPolicy {
+    typedef float real;
+
+    template <typename T> static T exp(T value) { return ::exp(value); }
+    template <typename T> static T log(T value) { return ::log(value); }
+};
+
+struct DoublePolicy {
+    typedef double real;
+
+    template <typename T> static double exp(T value) { return ::exp((double) value); }
+    template <typename T> static double log(T value) { return ::log((double) value); }
+};
+
+// float with approximations of exp() and log() that only use arithmetic
+// and bit operations (relative error below 1e-6 in the range of the model)
+struct FastFloatPolicy {
+    typedef float real;
+
+    template <typename T> static float exp(T value) { return fastExp((float) value); }
+    template <typename T> static float log(T value) { return fastLog((float) value); }
+
+    // exp(x) = 2^n * exp(r) with n = round(x / ln 2) and |r| <= ln 2 / 2
+    static float fastExp(float x)
+    {
+        if (x < -87.0F || x > 88.0F) {
+            return ::exp(x);
+        }
+
+        float n = floorf(x * 1.442695041F + 0.5F);
+        float r = x - n * 0.693145752F - n * 1.428606765e-06F;
+
+        // Taylor polynomial of degree 6 (Horner)
+        float p = 1.0F + r * (1.0F + r * (0.5F + r * (1.666666667e-01F + r * (
+            4.166666667e-02F + r * (8.333333333e-03F + r * 1.388888889e-03F)
+        ))));
+
+        int bits = ((int) n + 127) << 23;
+        float scale;
+        memcpy(&scale, &bits, sizeof(float));
+
+        return p * scale;
+    }
+
+    // log(x) = e * ln 2 + log(m) with x = m * 2^e and sqrt(1/2) <= m < sqrt(2),
+    // log(m) = 2 * atanh(s) with s = (m - 1) / (m + 1)
+    static float fastLog(float x)
+    {
+        // zero, negative, denormal, infinite or NaN
+        if (!(x >= 1.17549435e-38F && x < 3.40282347e+38F)) {
+            return ::log(x);
+        }
+
+        int bits;
+        memcpy(&bits, &x, sizeof(float));
+
+        int e = ((bits >> 23) & 255) - 127;
+        bits = (bits & 0x007fffff) | 0x3f800000;
+
+        float m;
+        memcpy(&m, &bits, sizeof(float));
+
+        if (m > 1.414213562F) {
+            m *= 0.5F;
+            e++;
+        }
+
+        float s = (m - 1.0F) / (m + 1.0F);
+        float z = s * s;
+
+        float atanh = s * (1.0F + z * (3.333333333e-01F + z * (2.0e-01F + z * (
+            1.428571429e-01F + z * 1.111111111e-01F
+        ))));
+
+        return e * 0.693147181F + 2.0F * atanh;
+    }
+};
+
+#endif // PRECISION_H
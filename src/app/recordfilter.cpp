@@ -0,0 +1,209 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <algorithm> // for std::sort()
+#include <QFile>
+#include <QIODevice>
+#include <QStringList>
+
+#include "codearena.h"
+#include "recordfilter.h"
+
+RecordFilter::RecordFilter():
+    hasDistricts(false),
+    hasUsages(false),
+    hasCodes(false)
+{
+}
+
+// Add a filter "FIELD=VALUES" (see recordfilter.h), false if it is invalid
+bool RecordFilter::add(const QString &expression)
+{
+    int equals = expression.indexOf('=');
+
+    if (equals < 0) {
+        error = QString("Filter '%1' is not of the form FIELD=VALUES").arg(expression);
+        return false;
+    }
+
+    QString field = expression.left(equals).trimmed().toUpper();
+    QString values = expression.mid(equals + 1).trimmed();
+
+    if (field == "BEZIRK") {
+        return addNumbers(field, values, districts, hasDistricts);
+    }
+
+    if (field == "NUTZUNG") {
+        return addNumbers(field, values, usages, hasUsages);
+    }
+
+    if (field == "CODE") {
+        return addCodes(values);
+    }
+
+    error = QString("Unknown filter field '%1' (expected BEZIRK, NUTZUNG or CODE)").arg(field);
+    return false;
+}
+
+// Several filters of a field select the records matching all of them
+bool RecordFilter::addNumbers(
+    const QString &field, const QString &values, QSet<int> &numbers, bool &hasNumbers
+)
+{
+    QSet<int> added;
+    QStringList list = values.split(',');
+
+    for (int i = 0; i < list.size(); i++) {
+
+        bool ok;
+        int number = list.at(i).trimmed().toInt(&ok);
+
+        if (!ok) {
+            error = QString("Invalid value '%1' in filter of %2").arg(list.at(i), field);
+            return false;
+        }
+
+        added.insert(number);
+    }
+
+    if (hasNumbers) {
+        numbers.intersect(added);
+    }
+    else {
+        numbers = added;
+    }
+
+    hasNumbers = true;
+    return true;
+}
+
+// Codes given as list or as @file (one code per line, empty lines are
+// skipped). The codes are compared with the trimmed bytes of the field, as
+// UTF-8 (see CodeArena::getString()).
+bool RecordFilter::readCodes(const QString &values, QVector<QByteArray> &codes, QString &error)
+{
+    if (values.startsWith("@")) {
+
+        QFile file(values.mid(1));
+
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = QString("Cannot open the code file '%1': %2").arg(
+                file.fileName(), file.errorString()
+            );
+            return false;
+        }
+
+        while (!file.atEnd()) {
+            QByteArray code = file.readLine().trimmed();
+            if (code.size() > 0) {
+                codes.append(code);
+            }
+        }
+
+        return true;
+    }
+
+    QStringList list = values.split(',');
+
+    for (int i = 0; i < list.size(); i++) {
+        QByteArray code = list.at(i).trimmed().toUtf8();
+        if (code.size() > 0) {
+            codes.append(code);
+        }
+    }
+
+    return true;
+}
+
+bool RecordFilter::addCodes(const QString &values)
+{
+    QVector<QByteArray> added;
+
+    if (!readCodes(values, added, error)) {
+        return false;
+    }
+
+    // only the codes in both lists
+    if (hasCodes) {
+        QVector<QByteArray> both;
+
+        for (int i = 0; i < added.size(); i++) {
+            if (containsCode(added.at(i).constData(), added.at(i).size())) {
+                both.append(added.at(i));
+            }
+        }
+
+        added = both;
+    }
+
+    std::sort(added.begin(), added.end(), [](const QByteArray &a, const QByteArray &b) {
+        return CodeArena::compare(a.constData(), a.size(), b.constData(), b.size()) < 0;
+    });
+
+    codes = added;
+    hasCodes = true;
+
+    return true;
+}
+
+bool RecordFilter::isEmpty() const
+{
+    return !hasDistricts && !hasUsages && !hasCodes;
+}
+
+// Record k is selected by all filters. Only the fields of the filters are
+// converted, the CODE is compared as bytes.
+bool RecordFilter::matches(DbaseReader &reader, int k) const
+{
+    if (hasDistricts && !districts.contains(reader.getInt(k, AbimoField::BEZIRK))) {
+        return false;
+    }
+
+    if (hasUsages && !usages.contains(reader.getInt(k, AbimoField::NUTZUNG))) {
+        return false;
+    }
+
+    if (hasCodes) {
+
+        const CodeArena &arena = reader.getCodes();
+
+        if (k >= arena.size() || !containsCode(arena.getData(k), arena.getLength(k))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QString RecordFilter::getError() const
+{
+    return error;
+}
+
+// Binary search in the sorted codes
+bool RecordFilter::containsCode(const char *code, int length) const
+{
+    int low = 0;
+    int high = codes.size();
+
+    while (low < high) {
+
+        int middle = (low + high) / 2;
+        const QByteArray &candidate = codes.at(middle);
+        int order = CodeArena::compare(candidate.constData(), candidate.size(), code, length);
+
+        if (order < 0) {
+            low = middle + 1;
+        }
+        else if (order > 0) {
+            high = middle;
+        }
+        else {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef RECORDFILTER_H
+#define RECORDFILTER_H
+
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include "dbaseReader.h"
+
+// Selection of the input records of a run (--where). A filter is given as
+// FIELD=VALUES with one of the fields BEZIRK, NUTZUNG or CODE and the values
+// as comma separated list, e.g. "BEZIRK=1,7". The codes can also be given as
+// "CODE=@<file>" with one code per line. A record is selected if it matches
+// all filters. Only the filter fields of a record are converted from the
+// bytes of the file (see DbaseReader::getInt(), DbaseReader::getCodes()).
+class RecordFilter
+{
+public:
+    RecordFilter();
+    bool add(const QString &expression);
+    bool isEmpty() const;
+    bool matches(DbaseReader &reader, int k) const;
+    QString getError() const;
+    static bool readCodes(const QString &values, QVector<QByteArray> &codes, QString &error);
+
+private:
+    bool hasDistricts;
+    QSet<int> districts;
+
+    bool hasUsages;
+    QSet<int> usages;
+
+    // sorted by CodeArena::compare(), searched without copying the code of a
+    // record
+    bool hasCodes;
+    QVector<QByteArray> codes;
+
+    QString error;
+
+    bool addNumbers(
+        const QString &field, const QString &values, QSet<int> &numbers, bool &hasNumbers
+    );
+    bool addCodes(const QString &values);
+    bool containsCode(const char *code, int length) const;
+};
+
+#endif // RECORDFILTER_H
@@ -0,0 +1,243 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <math.h>
+#include <string.h> // for memcmp()
+
+#include "recordstore.h"
+
+// fits value into an unsigned integer field of the given maximum
+static bool fits(int value, int maximum)
+{
+    return value >= 0 && value <= maximum;
+}
+
+static bool sameFloat(float a, float b)
+{
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+RecordStore::RecordStore():
+    n(0)
+{
+}
+
+void RecordStore::reserve(int n)
+{
+    for (int k = 0; k < RECORD_PERCENTAGES; k++) {
+        percentages[k].reserve(n);
+    }
+
+    flur.reserve(n);
+    nutzung.reserve(n);
+    bezirk.reserve(n);
+    regenja.reserve(n);
+    regenso.reserve(n);
+    typ.reserve(n);
+    feld30.reserve(n);
+    feld150.reserve(n);
+    flges.reserve(n);
+    strFlges.reserve(n);
+    codeEnd.reserve(n);
+}
+
+// Append a record and return its index
+int RecordStore::append(const abimoRecord &record)
+{
+    if (!encode(record)) {
+
+        // placeholder values in the arrays
+        abimoRecord empty = abimoRecord();
+        encode(empty);
+
+        unpacked.insert(n, record);
+    }
+
+    return n++;
+}
+
+void RecordStore::get(int i, abimoRecord &record) const
+{
+    if (!unpacked.isEmpty() && unpacked.contains(i)) {
+        record = unpacked.value(i);
+        return;
+    }
+
+    decode(i, record);
+}
+
+QString RecordStore::getCode(int i) const
+{
+    if (!unpacked.isEmpty() && unpacked.contains(i)) {
+        return unpacked.value(i).CODE;
+    }
+
+    quint32 begin = (i > 0) ? codeEnd.at(i - 1) : 0;
+
+    return QString::fromUtf8(codes.constData() + begin, codeEnd.at(i) - begin);
+}
+
+int RecordStore::size() const
+{
+    return n;
+}
+
+void RecordStore::clear()
+{
+    for (int k = 0; k < RECORD_PERCENTAGES; k++) {
+        percentages[k].clear();
+    }
+
+    flur.clear();
+    nutzung.clear();
+    bezirk.clear();
+    regenja.clear();
+    regenso.clear();
+    typ.clear();
+    feld30.clear();
+    feld150.clear();
+    flges.clear();
+    strFlges.clear();
+    codes.clear();
+    codeEnd.clear();
+    unpacked.clear();
+
+    n = 0;
+}
+
+qint64 RecordStore::getBytes() const
+{
+    return (qint64) n * (
+        RECORD_PERCENTAGES * sizeof(quint16) + 5 * sizeof(quint16) +
+        3 * sizeof(quint8) + 2 * sizeof(float) + sizeof(quint32)
+    ) + codes.size();
+}
+
+int RecordStore::getNumberOfUnpacked() const
+{
+    return unpacked.size();
+}
+
+// The percentage fields in the order of the arrays (PROBAU first)
+float* RecordStore::percentageField(abimoRecord &record, int k)
+{
+    float* fields[RECORD_PERCENTAGES] = {
+        &record.PROBAU_fraction,
+        &record.PROVGU_fraction,
+        &record.VGSTRASSE_fraction,
+        &record.KAN_BEB_fraction,
+        &record.KAN_VGU_fraction,
+        &record.KAN_STR_fraction,
+        &record.BELAG1_fraction,
+        &record.BELAG2_fraction,
+        &record.BELAG3_fraction,
+        &record.BELAG4_fraction,
+        &record.STR_BELAG1_fraction,
+        &record.STR_BELAG2_fraction,
+        &record.STR_BELAG3_fraction,
+        &record.STR_BELAG4_fraction
+    };
+
+    return fields[k];
+}
+
+// Fraction as calculated by DbaseReader::fillRecord() from the percentage
+// (value / 10). PROBAU is divided in float, all others in double.
+float RecordStore::decodeFraction(int k, quint16 value)
+{
+    float percentage = value / 10.0F;
+
+    if (k == 0) {
+        return percentage / 100.0F;
+    }
+
+    return DbaseReader::floatFraction(percentage);
+}
+
+void RecordStore::decode(int i, abimoRecord &record) const
+{
+    for (int k = 0; k < RECORD_PERCENTAGES; k++) {
+
+        *percentageField(record, k) = decodeFraction(k, percentages[k].at(i));
+    }
+
+    record.FLUR = flur.at(i) / 100.0F;
+    record.NUTZUNG = nutzung.at(i);
+    record.BEZIRK = bezirk.at(i);
+    record.REGENJA = regenja.at(i);
+    record.REGENSO = regenso.at(i);
+    record.TYP = typ.at(i);
+    record.FELD_30 = feld30.at(i);
+    record.FELD_150 = feld150.at(i);
+    record.FLGES = flges.at(i);
+    record.STR_FLGES = strFlges.at(i);
+    record.CODE = getCode(i);
+}
+
+// Append the packed values of the record to the arrays. Returns false (and
+// appends nothing) if a value cannot be restored exactly.
+bool RecordStore::encode(const abimoRecord &record)
+{
+    quint16 packed[RECORD_PERCENTAGES];
+    abimoRecord copy = record;
+
+    for (int k = 0; k < RECORD_PERCENTAGES; k++) {
+
+        float *field = percentageField(copy, k);
+        double tenths = floor(*field * 1000.0 + 0.5);
+
+        if (!(tenths >= 0.0 && tenths <= 65535.0)) {
+            return false;
+        }
+
+        packed[k] = (quint16) tenths;
+
+        if (!sameFloat(decodeFraction(k, packed[k]), *field)) {
+            return false;
+        }
+    }
+
+    double centimetres = floor(record.FLUR * 100.0 + 0.5);
+
+    if (!(centimetres >= 0.0 && centimetres <= 65535.0) ||
+        !sameFloat((quint16) centimetres / 100.0F, record.FLUR)) {
+        return false;
+    }
+
+    if (
+        !fits(record.NUTZUNG, 65535) || !fits(record.BEZIRK, 65535) ||
+        !fits(record.REGENJA, 65535) || !fits(record.REGENSO, 65535) ||
+        !fits(record.TYP, 255) || !fits(record.FELD_30, 255) ||
+        !fits(record.FELD_150, 255)
+    ) {
+        return false;
+    }
+
+    QByteArray code = record.CODE.toUtf8();
+
+    if (QString::fromUtf8(code) != record.CODE) {
+        return false;
+    }
+
+    for (int k = 0; k < RECORD_PERCENTAGES; k++) {
+        percentages[k].append(packed[k]);
+    }
+
+    flur.append((quint16) centimetres);
+    nutzung.append(record.NUTZUNG);
+    bezirk.append(record.BEZIRK);
+    regenja.append(record.REGENJA);
+    regenso.append(record.REGENSO);
+    typ.append(record.TYP);
+    feld30.append(record.FELD_30);
+    feld150.append(record.FELD_150);
+    flges.append(record.FLGES);
+    strFlges.append(record.STR_FLGES);
+
+    codes.append(code);
+    codeEnd.append(codes.size());
+
+    return true;
+}
@@ -0,0 +1,72 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef RECORDSTORE_H
+#define RECORDSTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+#include "dbaseReader.h"
+
+// Percentage fields of abimoRecord, see RecordStore
+#define RECORD_PERCENTAGES 14
+
+// Input records held in memory in a packed layout (one array per field):
+//
+// - percentages in tenths of a percent (quint16)
+// - FLUR in centimetres (quint16)
+// - NUTZUNG, BEZIRK, REGENJA, REGENSO as quint16; TYP, FELD_30, FELD_150 as
+//   quint8
+// - FLGES, STR_FLGES as float
+// - CODE as UTF-8 in one buffer
+//
+// A record is decoded into an abimoRecord by get(). append() only packs a
+// record if the decoded values are bit-identical to the given ones (e.g.
+// percentages with at most one decimal, as read from the input file), other
+// records are kept unpacked. A record takes 53 bytes plus its CODE instead of
+// about 110 bytes plus the CODE as QString as an abimoRecord. It is used by
+// the what-if server and the precision report, which keep their records,
+// calc() reads each record from the DbaseReader instead.
+class RecordStore
+{
+public:
+    RecordStore();
+    void reserve(int n);
+    int append(const abimoRecord &record);
+    void get(int i, abimoRecord &record) const;
+    QString getCode(int i) const;
+    int size() const;
+    void clear();
+
+    // memory used by the arrays (without the unpacked records)
+    qint64 getBytes() const;
+    int getNumberOfUnpacked() const;
+
+private:
+    int n;
+
+    QVector<quint16> percentages[RECORD_PERCENTAGES];
+    QVector<quint16> flur;
+    QVector<quint16> nutzung, bezirk, regenja, regenso;
+    QVector<quint8> typ, feld30, feld150;
+    QVector<float> flges, strFlges;
+
+    QByteArray codes;
+    QVector<quint32> codeEnd;
+
+    // records that cannot be packed without loss, by index
+    QHash<int, abimoRecord> unpacked;
+
+    static float* percentageField(abimoRecord &record, int k);
+    static float decodeFraction(int k, quint16 value);
+    void decode(int i, abimoRecord &record) const;
+    bool encode(const abimoRecord &record);
+};
+
+#endif // RECORDSTORE_H
@@ -0,0 +1,283 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <string.h> // for memcmp(), memcpy(), memset(), strncmp(), strncpy()
+
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+
+#include "constants.h"
+#include "resultcache.h"
+
+ResultCache::ResultCache(const QString &fileName, quint32 capacity):
+    file(fileName),
+    requestedCapacity(capacity),
+    data(0),
+    header(0),
+    entries(0),
+    lookups(0),
+    hits(0)
+{}
+
+ResultCache::~ResultCache()
+{
+    close();
+}
+
+QString ResultCache::getError()
+{
+    return error;
+}
+
+quint64 ResultCache::getLookups()
+{
+    return lookups;
+}
+
+quint64 ResultCache::getHits()
+{
+    return hits;
+}
+
+bool ResultCache::open()
+{
+    if (!file.exists()) {
+        return create();
+    }
+
+    if (!file.open(QIODevice::ReadWrite)) {
+        error = "Kann die Datei nicht oeffnen\n" + file.errorString();
+        return false;
+    }
+
+    if (file.size() >= (qint64) sizeof(ResultCacheHeader)) {
+        data = file.map(0, file.size());
+    }
+
+    if (data == 0) {
+        file.close();
+        return create();
+    }
+
+    header = reinterpret_cast<ResultCacheHeader*>(data);
+    entries = reinterpret_cast<ResultCacheEntry*>(data + sizeof(ResultCacheHeader));
+
+    // written by another program version (or no cache file at all), or with
+    // another number of slots than requested
+    if (
+        !isValid() ||
+        (requestedCapacity > 0 && header->capacity != slotCount(requestedCapacity))
+    ) {
+        close();
+        return create();
+    }
+
+    return true;
+}
+
+void ResultCache::close()
+{
+    if (data != 0) {
+        file.unmap(data);
+        data = 0;
+    }
+
+    header = 0;
+    entries = 0;
+
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+bool ResultCache::create()
+{
+    ResultCacheHeader newHeader;
+    memset(&newHeader, 0, sizeof(ResultCacheHeader));
+
+    memcpy(newHeader.magic, RESULTCACHE_MAGIC, sizeof(newHeader.magic));
+    newHeader.version = RESULTCACHE_VERSION;
+    newHeader.entrySize = sizeof(ResultCacheEntry);
+    strncpy(newHeader.programVersion, VERSION_STRING, sizeof(newHeader.programVersion) - 1);
+
+    newHeader.capacity = slotCount(
+        (requestedCapacity > 0) ? requestedCapacity : RESULTCACHE_DEFAULT_CAPACITY
+    );
+
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        error = "kann Cache-Datei: '" + file.fileName() + "' nicht anlegen\n Grund: " +
+            file.errorString();
+        return false;
+    }
+
+    // the slots are filled with zeros (empty)
+    qint64 size = sizeof(ResultCacheHeader) +
+        (qint64) sizeof(ResultCacheEntry) * newHeader.capacity;
+
+    if (
+        file.write(reinterpret_cast<const char*>(&newHeader), sizeof(ResultCacheHeader)) !=
+            (qint64) sizeof(ResultCacheHeader) ||
+        !file.resize(size)
+    ) {
+        error = "kann Cache-Datei: '" + file.fileName() + "' nicht schreiben\n Grund: " +
+            file.errorString();
+        file.close();
+        return false;
+    }
+
+    data = file.map(0, size);
+
+    if (data == 0) {
+        error = "Kann die Datei nicht in den Speicher abbilden\n" + file.errorString();
+        file.close();
+        return false;
+    }
+
+    header = reinterpret_cast<ResultCacheHeader*>(data);
+    entries = reinterpret_cast<ResultCacheEntry*>(data + sizeof(ResultCacheHeader));
+
+    return true;
+}
+
+bool ResultCache::isValid()
+{
+    if (
+        strncmp(header->magic, RESULTCACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != RESULTCACHE_VERSION ||
+        header->entrySize != sizeof(ResultCacheEntry) ||
+        strncmp(header->programVersion, VERSION_STRING, sizeof(header->programVersion) - 1) != 0
+    ) {
+        return false;
+    }
+
+    // capacity must be a power of two
+    if (header->capacity < RESULTCACHE_PROBES || (header->capacity & (header->capacity - 1)) != 0) {
+        return false;
+    }
+
+    return file.size() ==
+        (qint64) sizeof(ResultCacheHeader) + (qint64) sizeof(ResultCacheEntry) * header->capacity;
+}
+
+bool ResultCache::lookup(const ResultCacheKey &key, BlockResult &result)
+{
+    if (entries == 0) {
+        return false;
+    }
+
+    lookups++;
+
+    quint64 hash = hashBytes(&key, sizeof(ResultCacheKey), 0);
+    quint32 mask = header->capacity - 1;
+
+    for (quint32 i = 0; i < RESULTCACHE_PROBES; i++) {
+
+        ResultCacheEntry &entry = entries[(hash + i) & mask];
+
+        // slots are never emptied, the key is not stored further on
+        if (entry.hash == 0) {
+            return false;
+        }
+
+        if (
+            entry.hash == hash &&
+            memcmp(&entry.key, &key, sizeof(ResultCacheKey)) == 0 &&
+            entry.checksum == entryChecksum(entry)
+        ) {
+            result.row = entry.row;
+            result.ri = entry.ri;
+            result.r = entry.r;
+            result.verdunst = entry.verdunst;
+
+            entry.lastUsed = ++header->clock;
+            hits++;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ResultCache::insert(const ResultCacheKey &key, const BlockResult &result)
+{
+    if (entries == 0) {
+        return;
+    }
+
+    quint64 hash = hashBytes(&key, sizeof(ResultCacheKey), 0);
+    quint32 mask = header->capacity - 1;
+
+    // an empty slot, the slot of the key or the least recently used slot
+    ResultCacheEntry *slot = 0;
+
+    for (quint32 i = 0; i < RESULTCACHE_PROBES; i++) {
+
+        ResultCacheEntry &entry = entries[(hash + i) & mask];
+
+        if (entry.hash == 0 || (entry.hash == hash && memcmp(&entry.key, &key, sizeof(ResultCacheKey)) == 0)) {
+            slot = &entry;
+            break;
+        }
+
+        if (slot == 0 || entry.lastUsed < slot->lastUsed) {
+            slot = &entry;
+        }
+    }
+
+    ResultCacheEntry entry;
+    memset(&entry, 0, sizeof(ResultCacheEntry));
+
+    entry.hash = hash;
+    entry.lastUsed = ++header->clock;
+    memcpy(&entry.key, &key, sizeof(ResultCacheKey));
+    entry.row = result.row;
+    entry.ri = result.ri;
+    entry.r = result.r;
+    entry.verdunst = result.verdunst;
+    entry.checksum = entryChecksum(entry);
+
+    *slot = entry;
+}
+
+// Number of slots for the given capacity: a power of two, at least
+// RESULTCACHE_PROBES
+quint32 ResultCache::slotCount(quint32 capacity)
+{
+    quint32 count = RESULTCACHE_PROBES;
+
+    while (count < capacity && count < (1U << 30)) {
+        count *= 2;
+    }
+
+    return count;
+}
+
+// FNV-1a, never 0 (0 marks an empty slot)
+quint64 ResultCache::hashBytes(const void *bytes, size_t size, quint64 hash)
+{
+    const uchar *p = reinterpret_cast<const uchar*>(bytes);
+
+    if (hash == 0) {
+        hash = Q_UINT64_C(14695981039346656037);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= Q_UINT64_C(1099511628211);
+    }
+
+    return (hash == 0) ? 1 : hash;
+}
+
+quint32 ResultCache::entryChecksum(const ResultCacheEntry &entry)
+{
+    quint64 hash = hashBytes(&entry.hash, sizeof(entry.hash), 0);
+    hash = hashBytes(&entry.key, sizeof(ResultCacheKey), hash);
+    hash = hashBytes(&entry.row, 4 * sizeof(float), hash);
+
+    return (quint32) (hash ^ (hash >> 32));
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include "calculation.h"
+
+// A result cache file keeps the results (mm/a) of blocks calculated before,
+// across runs and programs using the same file (see --result-cache). The
+// key of a block is its state without areas (the areas only scale the
+// volumes, see Calculation::calcDeduplicated()), its climate and the
+// configuration values used by Calculation::evaluateBlock().
+//
+// The file consists of a ResultCacheHeader and a table of `capacity`
+// ResultCacheEntry slots (open addressing with linear probing). It is
+// memory mapped and never grows: if all slots a key may use are taken, the
+// least recently used of them is replaced. Each entry holds a checksum, an
+// entry that was overwritten concurrently by another process is not used.
+// The file is recreated if it was written by another program version or if
+// another capacity is requested (see --result-cache-size), without a
+// requested capacity an existing file keeps its size.
+
+#define RESULTCACHE_MAGIC "ABIMORC"
+#define RESULTCACHE_VERSION 1
+
+// default number of slots of a new file (about 200 bytes each, 13 MiB)
+#define RESULTCACHE_DEFAULT_CAPACITY (1 << 16)
+
+// number of slots searched for a key
+#define RESULTCACHE_PROBES 16
+
+struct ResultCacheKey {
+    BlockState state;
+    BlockClimate climate;
+
+    // infdach, infbel1..4, bagdach, bagbel1..4, niedKorrF
+    float config[11];
+};
+
+// the bytes of the key are hashed and compared
+static_assert(
+    sizeof(ResultCacheKey) == sizeof(BlockState) + sizeof(BlockClimate) + 11 * sizeof(float),
+    "ResultCacheKey has implicit padding"
+);
+
+struct ResultCacheHeader {
+    char magic[8];
+    quint32 version;
+
+    // size of one ResultCacheEntry, changes if the layout changes
+    quint32 entrySize;
+
+    // VERSION_STRING of the program that created the file
+    char programVersion[64];
+
+    // number of slots (a power of two)
+    quint32 capacity;
+    quint32 reserved;
+
+    // incremented on each use of an entry
+    quint64 clock;
+};
+
+struct ResultCacheEntry {
+    // hash of the key, 0 for an empty slot
+    quint64 hash;
+
+    // ResultCacheHeader::clock at the last use
+    quint64 lastUsed;
+
+    ResultCacheKey key;
+    float row;
+    float ri;
+    float r;
+    float verdunst;
+
+    // over hash, key and results
+    quint32 checksum;
+};
+
+class ResultCache
+{
+
+public:
+    ResultCache(const QString &fileName, quint32 capacity = 0);
+    ~ResultCache();
+    bool open();
+    void close();
+    QString getError();
+    bool lookup(const ResultCacheKey &key, BlockResult &result);
+    void insert(const ResultCacheKey &key, const BlockResult &result);
+    quint64 getLookups();
+    quint64 getHits();
+
+private:
+    QFile file;
+    QString error;
+    quint32 requestedCapacity;
+    uchar* data;
+    ResultCacheHeader* header;
+    ResultCacheEntry* entries;
+
+    // lookups and hits since open()
+    quint64 lookups;
+    quint64 hits;
+
+    bool create();
+    bool isValid();
+    static quint32 slotCount(quint32 capacity);
+    static quint64 hashBytes(const void *bytes, size_t size, quint64 hash);
+    static quint32 entryChecksum(const ResultCacheEntry &entry);
+};
+
+#endif // RESULTCACHE_H
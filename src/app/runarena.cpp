@@ -0,0 +1,68 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <string.h>
+
+#include "runarena.h"
+
+RunArena::RunArena():
+    current(-1),
+    used(0),
+    statistics({0L, 0L, 0L})
+{
+}
+
+RunArena::~RunArena()
+{
+    for (int i = 0; i < chunks.size(); i++) {
+        delete[] chunks.at(i);
+    }
+}
+
+// Uninitialised block of size bytes, valid until reset()
+char *RunArena::allocate(int size)
+{
+    if (current < 0 || used + size > sizes.at(current)) {
+
+        current++;
+        used = 0;
+
+        // the next chunk kept from the last run is used if it is large enough
+        if (current == chunks.size() || sizes.at(current) < size) {
+            int chunkSize = qMax(size, RUN_ARENA_CHUNK_SIZE);
+            chunks.insert(current, new char[chunkSize]);
+            sizes.insert(current, chunkSize);
+            statistics.heapAllocations++;
+        }
+    }
+
+    char *result = chunks.at(current) + used;
+
+    used += size;
+    statistics.bytes += size;
+    statistics.allocations++;
+
+    return result;
+}
+
+char *RunArena::copy(const char *data, int size)
+{
+    char *result = allocate(size);
+    memcpy(result, data, size);
+    return result;
+}
+
+// Release all blocks, the chunks are kept
+void RunArena::reset()
+{
+    current = -1;
+    used = 0;
+    statistics = {0L, 0L, 0L};
+}
+
+const RunArenaStatistics& RunArena::getStatistics() const
+{
+    return statistics;
+}
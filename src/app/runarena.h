@@ -0,0 +1,53 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef RUNARENA_H
+#define RUNARENA_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// Size of the chunks a RunArena takes from the heap (larger requests get a
+// chunk of their own)
+#define RUN_ARENA_CHUNK_SIZE (1 << 20)
+
+// Memory used since the last RunArena::reset()
+struct RunArenaStatistics {
+    // bytes and number of blocks handed out by allocate()
+    qint64 bytes;
+    long allocations;
+
+    // chunks taken from the heap (the others were kept from the last run)
+    long heapAllocations;
+};
+
+// Monotonic allocator for the transient data of one run, e.g. the text of
+// the values of a result file (see DbaseWriter). Blocks are never freed one
+// by one: reset() releases all of them at once and keeps the chunks for the
+// next run, the destructor gives them back to the heap.
+class RunArena
+{
+public:
+    RunArena();
+    ~RunArena();
+    char *allocate(int size);
+    char *copy(const char *data, int size);
+    void reset();
+    const RunArenaStatistics& getStatistics() const;
+
+private:
+    Q_DISABLE_COPY(RunArena)
+
+    QVector<char*> chunks;
+    QVector<int> sizes;
+
+    // chunk in use (-1: none) and bytes used in it
+    int current;
+    int used;
+
+    RunArenaStatistics statistics;
+};
+
+#endif // RUNARENA_H
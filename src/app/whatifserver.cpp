@@ -0,0 +1,357 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include <QDebug>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QList>
+#include <QStringList>
+
+#include "diagnosticsink.h"
+#include "whatifserver.h"
+
+namespace {
+
+// Largest request accepted (header and body)
+const int MAX_REQUEST_SIZE = 1 << 20;
+
+QJsonObject resultObject(const QString &code, const BlockResult &result)
+{
+    return {
+        {"CODE", code},
+        {"R", result.r},
+        {"ROW", result.row},
+        {"RI", result.ri},
+        {"RVOL", result.rvol},
+        {"ROWVOL", result.rowvol},
+        {"RIVOL", result.rivol},
+        {"VERDUNSTUN", result.verdunst}
+    };
+}
+
+QJsonObject totalsObject(const DistrictTotals &totals)
+{
+    return {
+        {"RVOL", totals.rvol},
+        {"ROWVOL", totals.rowvol},
+        {"RIVOL", totals.rivol}
+    };
+}
+
+void addResult(DistrictTotals &totals, const BlockResult &result, double sign)
+{
+    totals.rvol += sign * result.rvol;
+    totals.rowvol += sign * result.rowvol;
+    totals.rivol += sign * result.rivol;
+}
+
+QByteArray statusText(int status)
+{
+    switch (status) {
+        case 200: return "200 OK";
+        case 400: return "400 Bad Request";
+        case 404: return "404 Not Found";
+        case 413: return "413 Payload Too Large";
+        default: return QByteArray::number(status);
+    }
+}
+
+} // namespace
+
+WhatIfServer::WhatIfServer(DbaseReader &dbReader, InitValues &initValues, QObject *parent):
+    QObject(parent),
+    protocolStream(&protocol),
+    calculation(initValues, protocolStream)
+{
+    calculation.setDiagnosticMode(DiagnosticMode::aggregated, 0);
+
+    connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+
+    abimoRecord record;
+
+    for (int k = 0; k < dbReader.getNumberOfRecords(); k++) {
+
+        dbReader.fillRecord(k, record);
+
+        if (record.NUTZUNG != 0) {
+            codeIndex.insert(record.CODE, records.append(record));
+        }
+    }
+
+    results.resize(records.size());
+
+    for (int i = 0; i < records.size(); i++) {
+        records.get(i, record);
+
+        // unknown usage
+        if (!calculation.calcRecord(record, results[i])) {
+            error = calculation.getError();
+            return;
+        }
+
+        DistrictTotals &totals = districts[record.BEZIRK];
+        addResult(totals, results.at(i), 1.0);
+    }
+}
+
+// Keep running and answer what-if requests on the input (see --http)
+int WhatIfServer::serve(
+    QCoreApplication &app, DbaseReader &dbReader, InitValues &initValues, quint16 port
+)
+{
+    WhatIfServer server(dbReader, initValues);
+
+    if (!server.listen(port)) {
+        qDebug() << "Error: " << server.getError();
+        return 1;
+    }
+
+    qDebug() << "What-if server for" << server.getNumberOfBlocks() <<
+        "blocks listening on port" << server.serverPort();
+
+    return app.exec();
+}
+
+bool WhatIfServer::listen(quint16 port)
+{
+    if (!error.isEmpty()) {
+        return false;
+    }
+
+    // Only local clients, there is no authentication
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        error = server.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+QString WhatIfServer::getError()
+{
+    return error;
+}
+
+quint16 WhatIfServer::serverPort()
+{
+    return server.serverPort();
+}
+
+int WhatIfServer::getNumberOfBlocks()
+{
+    return records.size();
+}
+
+// Set a sealing field given in percent, with the conversions done by
+// DbaseReader::fillRecord()
+bool WhatIfServer::setField(abimoRecord &record, const QString &name, float value)
+{
+    if (name == "PROBAU") record.PROBAU_fraction = value / 100.0F;
+    else if (name == "PROVGU") record.PROVGU_fraction = DbaseReader::floatFraction(value);
+    else if (name == "VGSTRASSE") record.VGSTRASSE_fraction = DbaseReader::floatFraction(value);
+    else if (name == "KAN_BEB") record.KAN_BEB_fraction = DbaseReader::floatFraction(value);
+    else if (name == "KAN_VGU") record.KAN_VGU_fraction = DbaseReader::floatFraction(value);
+    else if (name == "KAN_STR") record.KAN_STR_fraction = DbaseReader::floatFraction(value);
+    else if (name == "BELAG1") record.BELAG1_fraction = DbaseReader::floatFraction(value);
+    else if (name == "BELAG2") record.BELAG2_fraction = DbaseReader::floatFraction(value);
+    else if (name == "BELAG3") record.BELAG3_fraction = DbaseReader::floatFraction(value);
+    else if (name == "BELAG4") record.BELAG4_fraction = DbaseReader::floatFraction(value);
+    else if (name == "STR_BELAG1") record.STR_BELAG1_fraction = DbaseReader::floatFraction(value);
+    else if (name == "STR_BELAG2") record.STR_BELAG2_fraction = DbaseReader::floatFraction(value);
+    else if (name == "STR_BELAG3") record.STR_BELAG3_fraction = DbaseReader::floatFraction(value);
+    else if (name == "STR_BELAG4") record.STR_BELAG4_fraction = DbaseReader::floatFraction(value);
+    else return false;
+
+    return true;
+}
+
+QJsonObject WhatIfServer::evaluate(const QJsonObject &request)
+{
+    QJsonArray blocks = request.value("blocks").toArray();
+
+    // changed records by index, a CODE given twice is changed once
+    QHash<int, abimoRecord> changed;
+    QList<int> order;
+
+    for (int i = 0; i < blocks.size(); i++) {
+
+        QJsonObject block = blocks.at(i).toObject();
+        QString code = block.value("CODE").toString();
+
+        if (!codeIndex.contains(code)) {
+            return {{"error", "unknown CODE: " + code}};
+        }
+
+        int index = codeIndex.value(code);
+
+        if (!changed.contains(index)) {
+            records.get(index, changed[index]);
+            order.append(index);
+        }
+
+        abimoRecord &record = changed[index];
+        QStringList names = block.keys();
+
+        for (int j = 0; j < names.size(); j++) {
+
+            if (names.at(j) == "CODE") {
+                continue;
+            }
+
+            QJsonValue value = block.value(names.at(j));
+
+            if (!value.isDouble() || !setField(record, names.at(j), value.toDouble())) {
+                return {{"error", "invalid field: " + names.at(j)}};
+            }
+        }
+    }
+
+    QJsonArray resultArray;
+    QMap<int, DistrictTotals> deltas;
+    BlockResult result;
+
+    for (int i = 0; i < order.size(); i++) {
+
+        int index = order.at(i);
+        abimoRecord &record = changed[index];
+
+        if (!calculation.calcRecord(record, result)) {
+            return {{"error", calculation.getError()}};
+        }
+        resultArray.append(resultObject(record.CODE, result));
+
+        DistrictTotals &delta = deltas[record.BEZIRK];
+        addResult(delta, result, 1.0);
+        addResult(delta, results.at(index), -1.0);
+    }
+
+    QJsonArray districtArray;
+
+    for (QMap<int, DistrictTotals>::const_iterator it = deltas.constBegin(); it != deltas.constEnd(); ++it) {
+
+        DistrictTotals before = districts.value(it.key());
+        DistrictTotals after = before;
+
+        after.rvol += it.value().rvol;
+        after.rowvol += it.value().rowvol;
+        after.rivol += it.value().rivol;
+
+        districtArray.append(QJsonObject({
+            {"BEZIRK", it.key()},
+            {"before", totalsObject(before)},
+            {"after", totalsObject(after)},
+            {"delta", totalsObject(it.value())}
+        }));
+    }
+
+    return {{"blocks", resultArray}, {"districts", districtArray}};
+}
+
+void WhatIfServer::newConnection()
+{
+    QTcpSocket *socket;
+
+    while ((socket = server.nextPendingConnection()) != 0) {
+        // answers are small, do not wait for more data to send
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(disconnected()));
+    }
+}
+
+void WhatIfServer::disconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+
+    if (socket != 0) {
+        buffers.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+// Minimal HTTP/1.1: requests with Content-Length, connections are kept open
+void WhatIfServer::readRequests()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+
+    if (socket == 0) {
+        return;
+    }
+
+    QByteArray &buffer = buffers[socket];
+    buffer.append(socket->readAll());
+
+    while (true) {
+
+        int headerEnd = buffer.indexOf("\r\n\r\n");
+
+        if (headerEnd < 0) {
+            if (buffer.size() > MAX_REQUEST_SIZE) {
+                respond(socket, 413, "{\"error\":\"request too large\"}");
+                socket->disconnectFromHost();
+            }
+            return;
+        }
+
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.at(0).trimmed().split(' ');
+        int contentLength = 0;
+
+        for (int i = 1; i < lines.size(); i++) {
+            int colon = lines.at(i).indexOf(':');
+            if (colon > 0 && lines.at(i).left(colon).trimmed().toLower() == "content-length") {
+                contentLength = lines.at(i).mid(colon + 1).trimmed().toInt();
+            }
+        }
+
+        if (contentLength < 0 || contentLength > MAX_REQUEST_SIZE) {
+            respond(socket, 413, "{\"error\":\"request too large\"}");
+            socket->disconnectFromHost();
+            return;
+        }
+
+        if (buffer.size() < headerEnd + 4 + contentLength) {
+            return;
+        }
+
+        QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.remove(0, headerEnd + 4 + contentLength);
+
+        if (requestLine.size() < 2 || requestLine.at(0) != "POST" || requestLine.at(1) != "/evaluate") {
+            respond(socket, 404, "{\"error\":\"use POST /evaluate\"}");
+            continue;
+        }
+
+        QJsonParseError parseError;
+        QJsonDocument document = QJsonDocument::fromJson(body, &parseError);
+
+        if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+            respond(socket, 400, QJsonDocument(QJsonObject({
+                {"error", "invalid request: " + parseError.errorString()}
+            })).toJson(QJsonDocument::Compact));
+            continue;
+        }
+
+        QJsonObject answer = evaluate(document.object());
+
+        respond(
+            socket, answer.contains("error") ? 400 : 200,
+            QJsonDocument(answer).toJson(QJsonDocument::Compact)
+        );
+    }
+}
+
+void WhatIfServer::respond(QTcpSocket *socket, int status, const QByteArray &body)
+{
+    socket->write(
+        "HTTP/1.1 " + statusText(status) + "\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+        "\r\n" + body
+    );
+}
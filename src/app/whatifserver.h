@@ -0,0 +1,86 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#ifndef WHATIFSERVER_H
+#define WHATIFSERVER_H
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QVector>
+
+#include "calculation.h"
+#include "dbaseReader.h"
+#include "initvalues.h"
+#include "recordstore.h"
+
+// Sum of the volumes [qcm/s] of all blocks of a district
+struct DistrictTotals {
+    double rvol;
+    double rowvol;
+    double rivol;
+};
+
+// HTTP/JSON endpoint (localhost only, see --http) for what-if calculations
+// on a loaded input file. The records are indexed by CODE, the results of
+// all records and the district totals are calculated once when loading.
+//
+//   POST /evaluate
+//   {"blocks": [{"CODE": "0001", "PROBAU": 40, "KAN_BEB": 100}, ...]}
+//
+// Only the given records are calculated again, with the given sealing
+// values (in percent, see WhatIfServer::setField()). The answer contains
+// their results and the totals of the affected districts. The loaded data
+// is not changed, each request starts from the input file.
+class WhatIfServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    WhatIfServer(DbaseReader &dbReader, InitValues &initValues, QObject *parent = 0);
+    static int serve(
+        QCoreApplication &app, DbaseReader &dbReader, InitValues &initValues, quint16 port
+    );
+    bool listen(quint16 port);
+    QString getError();
+    quint16 serverPort();
+    int getNumberOfBlocks();
+    QJsonObject evaluate(const QJsonObject &request);
+    static bool setField(abimoRecord &record, const QString &name, float value);
+
+private slots:
+    void newConnection();
+    void readRequests();
+    void disconnected();
+
+private:
+    QTcpServer server;
+    QString error;
+
+    // protocol of the calculation, messages are only counted
+    QString protocol;
+    QTextStream protocolStream;
+    Calculation calculation;
+
+    // records with NUTZUNG != 0 (packed), their results and the index by CODE
+    RecordStore records;
+    QVector<BlockResult> results;
+    QHash<QString, int> codeIndex;
+    QMap<int, DistrictTotals> districts;
+
+    // data received but not yet handled per connection
+    QHash<QTcpSocket*, QByteArray> buffers;
+
+    void respond(QTcpSocket *socket, int status, const QByteArray &body);
+};
+
+#endif
@@ -0,0 +1,29 @@
+# Load common settings
+! include( ../common.pri ) {
+    error( "Couldn't find the common.pri file!" )
+}
+
+# Shared library with the C interface (see abimoapi.h) for calls from other
+# languages (R, Python) without file input/output
+TEMPLATE = lib
+TARGET = abimoapi
+
+QT += \
+    core \
+    xml
+
+QT -= gui
+
+CONFIG += \
+    shared \
+    warn_on
+
+DEFINES += ABIMO_API_BUILD
+
+linkAbimoLibraries()
+
+HEADERS += \
+    $$ABIMO_SRCDIR/abimoapi.h
+
+SOURCES += \
+    $$ABIMO_SRCDIR/abimoapi.cpp
@@ -0,0 +1,26 @@
+# Load common settings
+! include( ../common.pri ) {
+    error( "Couldn't find the common.pri file!" )
+}
+
+# Command line program without any GUI library
+TEMPLATE = app
+TARGET = abimo-cli
+
+QT += \
+    core \
+    xml
+
+QT -= gui
+
+CONFIG += \
+    console \
+    warn_on
+
+CONFIG -= app_bundle
+
+linkAbimoServer()
+linkAbimoLibraries()
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,18 @@
+/***************************************************************************
+ * For copyright information please see COPYRIGHT in the base directory
+ * of this repository (https://github.com/KWB-R/abimo).
+ ***************************************************************************/
+
+#include "batch.h"
+#include "jobserver.h"
+#include "whatifserver.h"
+
+// Command line program: same as the batch mode of the GUI program but
+// without QtGui/QtWidgets, i.e. faster startup and a smaller binary. Only
+// this program links the servers (and QtNetwork, see src/server).
+int main(int argc, char *argv[])
+{
+    ServerModes servers = {JobServer::serve, WhatIfServer::serve};
+
+    return main_batch(argc, argv, &servers);
+}
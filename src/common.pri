@@ -1 +1,44 @@
 #DEFINES += QT_NO_DEBUG_OUTPUT
+
+# Check the indices of the lookup tables in debug builds (see app/lookuptable.h)
+CONFIG(debug, debug|release): DEFINES += ABIMO_CHECK_BOUNDS
+
+# constexpr tables (see app/lookuptable.h)
+CONFIG += c++14
+
+# Sources of all sub projects are in src/app
+ABIMO_SRCDIR = $$PWD/app
+
+# The libraries (see core/core.pro, lib/lib.pro) are written to <build>/lib
+ABIMO_LIBDIR = $$shadowed($$PWD)/../lib
+
+# Link the model library (libabimo) and the Qt-free core (libabimocore)
+defineTest(linkAbimoLibraries) {
+    LIBS += -L$$ABIMO_LIBDIR -labimo -labimocore
+    win32-msvc* {
+        PRE_TARGETDEPS += $$ABIMO_LIBDIR/abimo.lib $$ABIMO_LIBDIR/abimocore.lib
+    } else {
+        PRE_TARGETDEPS += $$ABIMO_LIBDIR/libabimo.a $$ABIMO_LIBDIR/libabimocore.a
+    }
+    INCLUDEPATH += $$ABIMO_SRCDIR
+    export(LIBS)
+    export(PRE_TARGETDEPS)
+    export(INCLUDEPATH)
+    return(true)
+}
+
+# Link the servers (libabimoserver, see server/server.pro) and QtNetwork.
+# Call before linkAbimoLibraries(), libabimoserver uses libabimo.
+defineTest(linkAbimoServer) {
+    LIBS += -L$$ABIMO_LIBDIR -labimoserver
+    win32-msvc* {
+        PRE_TARGETDEPS += $$ABIMO_LIBDIR/abimoserver.lib
+    } else {
+        PRE_TARGETDEPS += $$ABIMO_LIBDIR/libabimoserver.a
+    }
+    QT += network
+    export(QT)
+    export(LIBS)
+    export(PRE_TARGETDEPS)
+    return(true)
+}
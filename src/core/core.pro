@@ -0,0 +1,31 @@
+# Load common settings
+! include( ../common.pri ) {
+    error( "Couldn't find the common.pri file!" )
+}
+
+# Qt-free core of the model: Bagrov relation, effectiveness parameters and
+# soil/usage dependent estimates. Can be embedded without any Qt library.
+TEMPLATE = lib
+TARGET = abimocore
+DESTDIR = $$ABIMO_LIBDIR
+
+CONFIG += \
+    staticlib \
+    warn_on
+
+CONFIG -= qt
+
+INCDIR = $$ABIMO_SRCDIR
+
+HEADERS += \
+    $$INCDIR/bagrov.h \
+    $$INCDIR/constants.h \
+    $$INCDIR/effectivenessunsealed.h \
+    $$INCDIR/lookuptable.h \
+    $$INCDIR/pdr.h \
+    $$INCDIR/precision.h
+
+SOURCES += \
+    $$INCDIR/bagrov.cpp \
+    $$INCDIR/effectivenessunsealed.cpp \
+    $$INCDIR/pdr.cpp
@@ -0,0 +1,64 @@
+# Load common settings
+! include( ../common.pri ) {
+    error( "Couldn't find the common.pri file!" )
+}
+
+# Model library without GUI: calculation, configuration, dbf input/output and
+# the command line interface. Uses the Qt-free core (see ../core/core.pro).
+TEMPLATE = lib
+TARGET = abimo
+DESTDIR = $$ABIMO_LIBDIR
+
+QT += \
+    core \
+    xml
+
+QT -= gui
+
+CONFIG += \
+    staticlib \
+    warn_on
+
+INCDIR = $$ABIMO_SRCDIR
+
+HEADERS += \
+    $$INCDIR/batch.h \
+    $$INCDIR/blockmodel.h \
+    $$INCDIR/calculation.h \
+    $$INCDIR/codearena.h \
+    $$INCDIR/codeindex.h \
+    $$INCDIR/config.h \
+    $$INCDIR/configdiff.h \
+    $$INCDIR/dbaseField.h \
+    $$INCDIR/dbaseReader.h \
+    $$INCDIR/dbaseWriter.h \
+    $$INCDIR/diagnosticsink.h \
+    $$INCDIR/districtvalues.h \
+    $$INCDIR/helpers.h \
+    $$INCDIR/initvalues.h \
+    $$INCDIR/recordfilter.h \
+    $$INCDIR/recordstore.h \
+    $$INCDIR/resultcache.h \
+    $$INCDIR/runarena.h \
+    $$INCDIR/saxhandler.h
+
+SOURCES += \
+    $$INCDIR/batch.cpp \
+    $$INCDIR/blockmodel.cpp \
+    $$INCDIR/calculation.cpp \
+    $$INCDIR/codearena.cpp \
+    $$INCDIR/codeindex.cpp \
+    $$INCDIR/config.cpp \
+    $$INCDIR/configdiff.cpp \
+    $$INCDIR/dbaseField.cpp \
+    $$INCDIR/dbaseReader.cpp \
+    $$INCDIR/dbaseWriter.cpp \
+    $$INCDIR/diagnosticsink.cpp \
+    $$INCDIR/districtvalues.cpp \
+    $$INCDIR/helpers.cpp \
+    $$INCDIR/initvalues.cpp \
+    $$INCDIR/recordfilter.cpp \
+    $$INCDIR/recordstore.cpp \
+    $$INCDIR/resultcache.cpp \
+    $$INCDIR/runarena.cpp \
+    $$INCDIR/saxhandler.cpp
@@ -0,0 +1,32 @@
+# Load common settings
+! include( ../common.pri ) {
+    error( "Couldn't find the common.pri file!" )
+}
+
+# Job server (--serve) and what-if server (--http) on top of the model
+# library. Only the programs offering these modes link this library and
+# QtNetwork (see linkAbimoServer() in ../common.pri).
+TEMPLATE = lib
+TARGET = abimoserver
+DESTDIR = $$ABIMO_LIBDIR
+
+QT += \
+    core \
+    network \
+    xml
+
+QT -= gui
+
+CONFIG += \
+    staticlib \
+    warn_on
+
+INCDIR = $$ABIMO_SRCDIR
+
+HEADERS += \
+    $$INCDIR/jobserver.h \
+    $$INCDIR/whatifserver.h
+
+SOURCES += \
+    $$INCDIR/jobserver.cpp \
+    $$INCDIR/whatifserver.cpp
@@ -20,33 +20,13 @@ CONFIG += \
 
 #TEMPLATE = app
 
-INCDIR = ../app
-
-#INCLUDEPATH += $$INCDIR
-
-HEADERS += \
-    $$INCDIR/bagrov.h \
-    $$INCDIR/calculation.h\
-    $$INCDIR/config.h\
-    $$INCDIR/dbaseField.h \
-    $$INCDIR/dbaseReader.h \
-    $$INCDIR/dbaseWriter.h \
-    $$INCDIR/effectivenessunsealed.h \
-    $$INCDIR/helpers.h \
-    $$INCDIR/initvalues.h \
-    $$INCDIR/pdr.h \
-    $$INCDIR/saxhandler.h
+# the tests cover the servers as well
+linkAbimoServer()
+linkAbimoLibraries()
+
+# The C interface is linked statically into the test program
+DEFINES += ABIMO_API_STATIC
 
 SOURCES += \
-    $$INCDIR/bagrov.cpp \
-    $$INCDIR/calculation.cpp \
-    $$INCDIR/config.cpp \
-    $$INCDIR/dbaseField.cpp \
-    $$INCDIR/dbaseReader.cpp \
-    $$INCDIR/dbaseWriter.cpp \
-    $$INCDIR/effectivenessunsealed.cpp \
-    $$INCDIR/helpers.cpp \
-    $$INCDIR/initvalues.cpp \
-    $$INCDIR/pdr.cpp \
-    $$INCDIR/saxhandler.cpp \
+    $$ABIMO_SRCDIR/abimoapi.cpp \
     tst_testabimo.cpp
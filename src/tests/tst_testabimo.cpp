@@ -1,15 +1,38 @@
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QtDebug>
 #include <QtGlobal>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QStorageInfo>
 #include <QString>
 #include <QStringList>
+#include <QTextStream>
+#include <QVector>
 #include <QtTest>
 
+#include "../app/abimoapi.h"
+#include "../app/bagrov.h"
+#include "../app/blockmodel.h"
 #include "../app/calculation.h"
+#include "../app/codearena.h"
+#include "../app/codeindex.h"
 #include "../app/config.h"
+#include "../app/configdiff.h"
 #include "../app/dbaseReader.h"
+#include "../app/dbaseWriter.h"
+#include "../app/diagnosticsink.h"
+#include "../app/districtvalues.h"
 #include "../app/helpers.h"
+#include "../app/jobserver.h"
+#include "../app/lookuptable.h"
+#include "../app/recordfilter.h"
+#include "../app/recordstore.h"
+#include "../app/resultcache.h"
+#include "../app/runarena.h"
+#include "../app/whatifserver.h"
 
 class TestAbimo : public QObject
 {
@@ -28,13 +51,48 @@ private slots:
     void test_xmlReader();
     void test_config_getTWS();
     void test_calc();
+    void test_series();
+    void test_blockModel();
+    void test_deduplicate();
+    void test_diagnosticSink();
+    void test_abimoApi();
+    void test_lruCache();
+    void test_whatIfServer();
+    void test_jobServer();
+    void test_dbaseWriterPatch();
+    void test_calcDelta();
+    void test_configDiff();
+    void test_calcConfigChange();
+    void test_resultCache();
     void test_bagrov();
+    void test_bagrovWarmStart();
+    void test_bagrovCurve();
+    void test_precision();
+    void test_usageKernels();
+    void test_lookupTable();
+    void test_districtValues();
+    void test_recordStore();
+    void test_codeArena();
+    void test_runArena();
+    void test_recordFilter();
+    void test_codeIndex();
+    void test_largeFile();
+    void test_largeWrite();
 
     QString testDataDir();
     QString dataFilePath(QString fileName, bool mustExist = true);
     bool dbfHeadersAreIdentical(QString file_1, QString file_2);
+    bool addYearColumns(QString inputFile, QString outputFile, QString year);
+    bool writeInputRecords(
+        QString inputFile, QString outputFile, QVector<int> numbers,
+        QMap<int, QHash<QString, QString> > changes
+    );
     bool dbfStringsAreIdentical(QString file_1, QString file_2);
+    bool dbfRecordsAreIdentical(QString file_1, QString file_2, QVector<int> rows);
     bool numbersInFilesDiffer(QString file_1, QString file_2, int n_1, int n_2, QString subject);
+    void setResultValues(DbaseWriter &writer, float value);
+    bool writeResultFile(QString file, QStringList codes, float value = 1.0F);
+    void removeResultFile(QString file);
 };
 
 TestAbimo::TestAbimo()
@@ -164,98 +222,1746 @@ void TestAbimo::test_calc()
     QVERIFY(dbfStringsAreIdentical(outputFile, outFile_xmlConfig));
 }
 
-void TestAbimo::test_bagrov()
+void TestAbimo::test_series()
 {
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString seriesInput = dataFilePath("tmp_series.dbf", false);
+    QString seriesFile = dataFilePath("tmp_series.csv", false);
+    QString outFile_noConfig = dataFilePath("abimo_2019_mitstrassenout_3.2.1_default-config.dbf");
+
+    // One year with the precipitation of REGENJA and REGENSO
+    QVERIFY(addYearColumns(inputFile, seriesInput, "19"));
+
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+
+    DbaseReader dbReader(seriesInput);
+    QVERIFY(dbReader.checkAndRead());
+
+    InitValues initValues;
+    Calculation calculation(dbReader, initValues, protocolStream);
+    QVERIFY(calculation.calcSeries(seriesFile, SeriesOutput::years));
+    QVERIFY(!protocol.contains("Nicht ganzzahlige"));
+
+    // The year reproduces calc()
+    DbaseReader reference(outFile_noConfig);
+    QVERIFY(reference.read());
+
+    QFile file(seriesFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QList<QByteArray> lines = file.readAll().split('\n');
+    file.close();
+
+    // header and an empty string after the last line break
+    QCOMPARE(lines.size(), reference.getNumberOfRecords() + 2);
+
+    for (int i = 0; i < reference.getNumberOfRecords(); i++) {
+
+        // CODE,YEAR,R,ROW,RI,RVOL,ROWVOL,RIVOL,FLAECHE,VERDUNSTUN
+        QStringList values = QString(lines.at(i + 1)).split(',');
+
+        QCOMPARE(values.size(), 10);
+        QCOMPARE(values.at(0), reference.getRecord(i, "CODE"));
+        QCOMPARE(values.at(1), QString("19"));
+        QVERIFY(qAbs(values.at(2).toFloat() - reference.getRecord(i, "R").toFloat()) < 0.001F);
+        QVERIFY(qAbs(values.at(3).toFloat() - reference.getRecord(i, "ROW").toFloat()) < 0.001F);
+        QVERIFY(qAbs(values.at(4).toFloat() - reference.getRecord(i, "RI").toFloat()) < 0.001F);
+        QVERIFY(
+            qAbs(values.at(9).toFloat() - reference.getRecord(i, "VERDUNSTUN").toFloat()) < 0.001F
+        );
+    }
 
+    // Codes are quoted if needed
+    QCOMPARE(Helpers::csvField("A1"), QString("A1"));
+    QCOMPARE(Helpers::csvField("A,1"), QString("\"A,1\""));
+    QCOMPARE(Helpers::csvField("A\"1"), QString("\"A\"\"1\""));
+
+    // A failed write is an error (Linux: writing to /dev/full fails)
+    if (QFile::exists("/dev/full")) {
+        QVERIFY(!calculation.calcSeries("/dev/full", SeriesOutput::years));
+        QVERIFY(calculation.getError().startsWith("Fehler beim Schreiben"));
+    }
+
+    QFile::remove(seriesInput);
+    QFile::remove(seriesFile);
 }
 
-bool TestAbimo::dbfHeadersAreIdentical(QString file_1, QString file_2)
+void TestAbimo::test_blockModel()
 {
-    DbaseReader reader_1(file_1);
-    DbaseReader reader_2(file_2);
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString configFile = dataFilePath("config.xml");
+    QString modelFile = dataFilePath("tmp_model.abm", false);
+    QString outputFile = dataFilePath("tmp_out.dbf", false);
+    QString outFile_xmlConfig = dataFilePath("abimo_2019_mitstrassenout_3.2.1_xml-config.dbf");
 
-    reader_1.read();
-    reader_2.read();
+    QString protocol;
+    QTextStream protocolStream(&protocol);
 
-    if (reader_1.getVersion() != reader_2.getVersion()) {
-        qDebug() << "version differs";
-        return false;
+    // Compile the input file (without any configuration)
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
+
+    InitValues defaultValues;
+    Calculation compiler(dbReader, defaultValues, protocolStream);
+    QVERIFY(compiler.compile(modelFile));
+
+    // Evaluate the compiled model with the values from the config file
+    InitValues initValues;
+    QVERIFY(InitValues::updateFromConfig(initValues, configFile).isEmpty());
+
+    BlockModel model(modelFile);
+    QVERIFY(model.open());
+
+    Calculation calculator(initValues, protocolStream);
+    QVERIFY(calculator.calcModel(model, outputFile));
+    QVERIFY(dbfStringsAreIdentical(outputFile, outFile_xmlConfig));
+}
+
+void TestAbimo::test_deduplicate()
+{
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString configFile = dataFilePath("config.xml");
+    QString outputFile = dataFilePath("tmp_out.dbf", false);
+    QString outFile_noConfig = dataFilePath("abimo_2019_mitstrassenout_3.2.1_default-config.dbf");
+    QString outFile_xmlConfig = dataFilePath("abimo_2019_mitstrassenout_3.2.1_xml-config.dbf");
+
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
+
+    // Each unique parameter tuple calculated once gives the same output
+    InitValues defaultValues;
+    Calculation deduplicated(dbReader, defaultValues, protocolStream);
+    deduplicated.setDeduplicate(true);
+    QVERIFY(deduplicated.calc(outputFile));
+    QVERIFY(dbfHeadersAreIdentical(outputFile, outFile_noConfig));
+    QVERIFY(dbfStringsAreIdentical(outputFile, outFile_noConfig));
+    QVERIFY(protocol.contains("Eindeutige Parameterkombinationen"));
+
+    InitValues initValues;
+    QVERIFY(InitValues::updateFromConfig(initValues, configFile).isEmpty());
+
+    Calculation withConfig(dbReader, initValues, protocolStream);
+    withConfig.setDeduplicate(true);
+    QVERIFY(withConfig.calc(outputFile));
+    QVERIFY(dbfStringsAreIdentical(outputFile, outFile_xmlConfig));
+
+    // The warm start is the same within the convergence criteria
+    Calculation warm(dbReader, defaultValues, protocolStream);
+    warm.setWarmStart(true);
+    QVERIFY(warm.calc(outputFile));
+
+    DbaseReader output(outputFile);
+    DbaseReader reference(outFile_noConfig);
+    QVERIFY(output.read());
+    QVERIFY(reference.read());
+    QCOMPARE(output.getNumberOfRecords(), reference.getNumberOfRecords());
+
+    const char *fields[] = {"R", "ROW", "RI", "VERDUNSTUN"};
+
+    for (int i = 0; i < output.getNumberOfRecords(); i++) {
+        QCOMPARE(output.getRecord(i, "CODE"), reference.getRecord(i, "CODE"));
+        for (const char *field : fields) {
+            float value = output.getRecord(i, field).toFloat();
+            float expected = reference.getRecord(i, field).toFloat();
+            QVERIFY(qAbs(value - expected) < 0.5F);
+        }
     }
+}
 
-    QDate date_1 = reader_1.getDate();
-    QDate date_2 = reader_2.getDate();
+void TestAbimo::test_diagnosticSink()
+{
+    QString protocol;
+    QTextStream protocolStream(&protocol);
 
-    if (date_1 != date_2) {
-        qDebug() << "date differs (" << date_1 << "vs" << date_2 << ")."
-                 << "This is expected.";
+    // Full mode: messages as written by earlier versions
+    DiagnosticSink sink(protocolStream);
+    sink.report(DiagnosticType::unknownETP, "0001", 12, 660.0F);
+    sink.report(DiagnosticType::usageTypeUnknown, "0002", 0, 7.0F);
+    sink.flush();
+
+    QCOMPARE(protocol, QString(
+        "\r\nETP unbekannt fuer 0001 von Bezirk 12\r\nETP=660 angenommen\r\n"
+        "\r\nNutzungstyp nicht definiert fuer Element 0002\r\nTyp=7 angenommen\r\n"
+    ));
+
+    // Aggregated mode: counts and the first example per type
+    protocol.clear();
+    sink.setMode(DiagnosticMode::aggregated, 1);
+
+    for (int i = 0; i < 3; i++) {
+        sink.report(DiagnosticType::unknownEG, QString::number(i), 5, 775.0F);
     }
 
-    if (reader_1.getNumberOfRecords() != reader_2.getNumberOfRecords()) {
-        qDebug() << "numberOfRecords differs";
-        return false;
+    sink.flush();
+    QVERIFY(protocol.isEmpty());
+
+    sink.writeSummary();
+
+    QCOMPARE(protocol, QString(
+        "\r\nEG unbekannt: 3 Meldungen, davon die ersten 1:\r\n"
+        "\r\nEG unbekannt fuer 0 von Bezirk 5\r\nEG=775 angenommen\r\n"
+    ));
+}
+
+void TestAbimo::test_abimoApi()
+{
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QByteArray configFile = dataFilePath("config.xml").toUtf8();
+
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
+
+    int n = dbReader.getNumberOfRecords();
+
+    // Integer and float columns in the order of the names
+    const QStringList intNames = QStringList() << "NUTZUNG" << "TYP" <<
+        "BEZIRK" << "REGENJA" << "REGENSO" << "FELD_30" << "FELD_150";
+    const QStringList floatNames = QStringList() << "FLUR" << "PROBAU" <<
+        "PROVGU" << "VGSTRASSE" << "KAN_BEB" << "KAN_VGU" << "KAN_STR" <<
+        "BELAG1" << "BELAG2" << "BELAG3" << "BELAG4" << "STR_BELAG1" <<
+        "STR_BELAG2" << "STR_BELAG3" << "STR_BELAG4" << "FLGES" << "STR_FLGES";
+
+    QVector<QVector<int> > ints(intNames.size(), QVector<int>(n));
+    QVector<QVector<float> > floats(floatNames.size(), QVector<float>(n));
+
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < intNames.size(); j++) {
+            ints[j][k] = dbReader.getRecord(k, intNames.at(j)).toInt();
+        }
+        for (int j = 0; j < floatNames.size(); j++) {
+            floats[j][k] = dbReader.getRecord(k, floatNames.at(j)).toFloat();
+        }
     }
 
-    if (reader_1.getLengthOfHeader() != reader_2.getLengthOfHeader()) {
-        qDebug() << "lengthOfHeader differs";
-        return false;
+    abimo_input_columns input = {
+        ints[0].constData(), ints[1].constData(), ints[2].constData(),
+        ints[3].constData(), ints[4].constData(), floats[0].constData(),
+        ints[5].constData(), ints[6].constData(), floats[1].constData(),
+        floats[2].constData(), floats[3].constData(), floats[4].constData(),
+        floats[5].constData(), floats[6].constData(), floats[7].constData(),
+        floats[8].constData(), floats[9].constData(), floats[10].constData(),
+        floats[11].constData(), floats[12].constData(), floats[13].constData(),
+        floats[14].constData(), floats[15].constData(), floats[16].constData()
+    };
+
+    abimo_params params = {configFile.constData()};
+
+    QVector<float> r_1(n), row_1(n), r_4(n), row_4(n);
+    abimo_output_columns output_1 = {r_1.data(), row_1.data(), 0, 0, 0, 0, 0, 0};
+    abimo_output_columns output_4 = {r_4.data(), row_4.data(), 0, 0, 0, 0, 0, 0};
+
+    QCOMPARE(abimo_evaluate(&input, &params, &output_1, n, 1), ABIMO_OK);
+    QCOMPARE(abimo_evaluate(&input, &params, &output_4, n, 4), ABIMO_OK);
+
+    // Compare with the calculation of the records read from the dbf-file
+    InitValues initValues;
+    QVERIFY(InitValues::updateFromConfig(initValues, configFile).isEmpty());
+
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+    Calculation calculation(initValues, protocolStream);
+
+    abimoRecord record;
+    BlockResult result;
+
+    for (int k = 0; k < n; k++) {
+
+        dbReader.fillRecord(k, record);
+
+        if (record.NUTZUNG == 0) {
+            QVERIFY(qIsNaN(r_1.at(k)));
+            continue;
+        }
+
+        calculation.calcRecord(record, result);
+
+        QVERIFY(r_1.at(k) == result.r);
+        QVERIFY(row_1.at(k) == result.row);
+        QVERIFY(r_4.at(k) == result.r);
+        QVERIFY(row_4.at(k) == result.row);
     }
 
-    if (reader_1.getLengthOfEachRecord() != reader_2.getLengthOfEachRecord()) {
-        qDebug() << "lengthOfEachRecord differs";
-        return false;
+    // A row of unknown usage is an error (and does not abort the program)
+    ints[0][0] = 99;
+    QCOMPARE(abimo_evaluate(&input, &params, &output_1, n, 1), ABIMO_ERROR_USAGE);
+    QCOMPARE(abimo_evaluate(&input, &params, &output_4, n, 4), ABIMO_ERROR_USAGE);
+
+    // Missing columns
+    input.FLGES = 0;
+    QCOMPARE(abimo_evaluate(&input, &params, &output_1, n, 1), ABIMO_ERROR_ARGUMENT);
+}
+
+void TestAbimo::test_lruCache()
+{
+    LruCache<int> cache(2);
+    QDateTime modified = QDateTime::fromMSecsSinceEpoch(1000);
+
+    cache.put("a", modified, QSharedPointer<int>(new int(1)));
+    cache.put("b", modified, QSharedPointer<int>(new int(2)));
+
+    // "a" becomes the most recently used entry, "b" is evicted
+    QCOMPARE(*cache.get("a", modified), 1);
+    cache.put("c", modified, QSharedPointer<int>(new int(3)));
+
+    QVERIFY(cache.get("b", modified).isNull());
+    QCOMPARE(*cache.get("a", modified), 1);
+    QCOMPARE(*cache.get("c", modified), 3);
+
+    // a modified file is not taken from the cache
+    QVERIFY(cache.get("a", modified.addSecs(1)).isNull());
+}
+
+void TestAbimo::test_whatIfServer()
+{
+    DbaseReader dbReader(dataFilePath("abimo_2019_mitstrassen.dbf"));
+    QVERIFY(dbReader.checkAndRead());
+
+    InitValues initValues;
+    WhatIfServer server(dbReader, initValues);
+
+    QVERIFY(server.getError().isEmpty());
+    QVERIFY(server.getNumberOfBlocks() > 0);
+
+    abimoRecord record;
+    int k = 0;
+
+    do {
+        dbReader.fillRecord(k++, record);
+    } while (record.NUTZUNG == 0);
+
+    // Without changes the totals of the district stay the same
+    QJsonObject answer = server.evaluate({{"blocks", QJsonArray({
+        QJsonObject({{"CODE", record.CODE}})
+    })}});
+
+    QJsonObject district = answer.value("districts").toArray().at(0).toObject();
+    QCOMPARE(district.value("BEZIRK").toInt(), record.BEZIRK);
+    QCOMPARE(district.value("delta").toObject().value("RVOL").toDouble(), 0.0);
+
+    // Sealing the roofs of the block changes its runoff
+    answer = server.evaluate({{"blocks", QJsonArray({
+        QJsonObject({{"CODE", record.CODE}, {"PROBAU", 0}})
+    })}});
+    QVERIFY(!answer.contains("error"));
+    double rowUnsealed = answer.value("blocks").toArray().at(0).toObject().value("ROW").toDouble();
+
+    answer = server.evaluate({{"blocks", QJsonArray({
+        QJsonObject({{"CODE", record.CODE}, {"PROBAU", 100}, {"KAN_BEB", 100}})
+    })}});
+    QCOMPARE(answer.value("blocks").toArray().size(), 1);
+    QVERIFY(answer.value("blocks").toArray().at(0).toObject().value("ROW").toDouble() > rowUnsealed);
+
+    // Unknown blocks and fields are rejected
+    answer = server.evaluate({{"blocks", QJsonArray({QJsonObject({{"CODE", "unknown"}})})}});
+    QVERIFY(answer.contains("error"));
+
+    answer = server.evaluate({{"blocks", QJsonArray({
+        QJsonObject({{"CODE", record.CODE}, {"NUTZUNG", 10}})
+    })}});
+    QVERIFY(answer.contains("error"));
+}
+
+void TestAbimo::test_jobServer()
+{
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString outputFile = dataFilePath("tmp_job.dbf", false);
+    QString outFile_noConfig = dataFilePath("abimo_2019_mitstrassenout_3.2.1_default-config.dbf");
+
+    // Keep the status of one finished job only
+    JobServer server(4, 1);
+    QVERIFY(server.listen("abimo-test-jobs"));
+
+    QLocalSocket client;
+    client.connectToServer("abimo-test-jobs");
+    QVERIFY(client.waitForConnected(5000));
+
+    QByteArray submitWait = QJsonDocument(QJsonObject({
+        {"command", "submit"}, {"input", inputFile}, {"output", outputFile}, {"wait", true}
+    })).toJson(QJsonDocument::Compact) + '\n';
+
+    QByteArray submit = QJsonDocument(QJsonObject({
+        {"command", "submit"}, {"input", inputFile}, {"output", outputFile}
+    })).toJson(QJsonDocument::Compact) + '\n';
+
+    // A second job writing the same output is rejected while the first runs
+    client.write(submitWait + submit);
+    client.flush();
+
+    QTRY_VERIFY_WITH_TIMEOUT(client.canReadLine(), 5000);
+    QJsonObject answer = QJsonDocument::fromJson(client.readLine()).object();
+    QCOMPARE(answer.value("error").toString(), QString("output in use by job 1"));
+
+    QTRY_VERIFY_WITH_TIMEOUT(client.canReadLine(), 300000);
+    answer = QJsonDocument::fromJson(client.readLine()).object();
+    QCOMPARE(answer.value("job").toInt(), 1);
+    QCOMPARE(answer.value("status").toString(), QString("finished"));
+    QVERIFY(dbfStringsAreIdentical(outputFile, outFile_noConfig));
+
+    // The output is free again, the status of the first job is dropped
+    // when the second one finishes
+    client.write(submitWait);
+    client.flush();
+
+    QTRY_VERIFY_WITH_TIMEOUT(client.canReadLine(), 300000);
+    answer = QJsonDocument::fromJson(client.readLine()).object();
+    QCOMPARE(answer.value("job").toInt(), 2);
+    QCOMPARE(answer.value("status").toString(), QString("finished"));
+
+    client.write("{\"command\": \"status\", \"job\": 1}\n");
+    client.flush();
+
+    QTRY_VERIFY_WITH_TIMEOUT(client.canReadLine(), 5000);
+    answer = QJsonDocument::fromJson(client.readLine()).object();
+    QCOMPARE(answer.value("error").toString(), QString("unknown job"));
+
+    client.disconnectFromServer();
+
+    removeResultFile(outputFile);
+    QFile::remove(Helpers::defaultLogFileName(outputFile));
+}
+
+void TestAbimo::test_dbaseWriterPatch()
+{
+    QString fileName = dataFilePath("tmp_patch.dbf", false);
+    QString patchedName = dataFilePath("tmp_patched.dbf", false);
+    InitValues initValues;
+
+    QVERIFY(writeResultFile(fileName, {"CODE_0", "CODE_1", "CODE_2"}, 100.0F));
+
+    DbaseReader previous(fileName);
+    QVERIFY(previous.read());
+
+    // Replace the middle row in a copy of the file
+    DbaseWriter patcher(patchedName, initValues);
+    patcher.addRecord();
+    patcher.setRecordField("CODE", QString("CODE_1"));
+    setResultValues(patcher, 200.0F);
+
+    QVERIFY(patcher.fitsInto(previous));
+    QVERIFY(patcher.patch(previous, {1}));
+
+    DbaseReader patched(patchedName);
+    QVERIFY(patched.read());
+    QCOMPARE(patched.getNumberOfRecords(), 3);
+    QCOMPARE(patched.getRecord(0, "ROW").toFloat(), 100.0F);
+    QCOMPARE(patched.getRecord(1, "ROW").toFloat(), 200.0F);
+    QCOMPARE(patched.getRecord(1, "CODE"), QString("CODE_1"));
+    QCOMPARE(patched.getRecord(2, "ROW").toFloat(), 100.0F);
+
+    // Longer values do not fit into the fields of the file
+    patcher.setRecordField("ROW", 12345.0F);
+    QVERIFY(!patcher.fitsInto(previous));
+
+    removeResultFile(fileName);
+    removeResultFile(patchedName);
+}
+
+void TestAbimo::test_calcDelta()
+{
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString previousInput = dataFilePath("tmp_delta_in.dbf", false);
+    QString previousOutput = dataFilePath("tmp_delta_out.dbf", false);
+    QString deltaFile = dataFilePath("tmp_delta.dbf", false);
+    QString newInput = dataFilePath("tmp_delta_new.dbf", false);
+    QString expectedFile = dataFilePath("tmp_delta_expected.dbf", false);
+    QString mergedFile = dataFilePath("tmp_delta_merged.dbf", false);
+
+    DbaseReader reader(inputFile);
+    QVERIFY(reader.checkAndRead());
+
+    // the first three blocks are changed, removed and left unchanged, the
+    // first one is also added with a new code
+    QVector<int> all;
+    QVector<int> blocks;
+
+    for (int k = 0; k < reader.getNumberOfRecords(); k++) {
+        all.append(k);
+        if (blocks.size() < 3 && reader.getRecord(k, "NUTZUNG").toInt() != 0) {
+            blocks.append(k);
+        }
     }
 
-    QString lng_1 = reader_1.getLanguageDriver();
-    QString lng_2 = reader_2.getLanguageDriver();
+    QHash<QString, QString> changed = {
+        {"REGENJA", QString::number(reader.getRecord(blocks.at(0), "REGENJA").toInt() + 50)}
+    };
+    QHash<QString, QString> removed = {{"NUTZUNG", "0"}};
+    QHash<QString, QString> added = changed;
+    added.insert("CODE", "NEU1");
 
-    if (lng_1 != lng_2) {
-        qDebug() << "languageDriver differs"
-                 << "(" << lng_1 << "vs" << lng_2 << ")";
-        //return false;
+    QVector<int> extended = all;
+    extended.append(blocks.at(0));
+
+    // the previous run on a copy of the input (its code index is built next
+    // to it)
+    QVERIFY(writeInputRecords(inputFile, previousInput, all, {}));
+    Calculation::calculate(previousInput, "", previousOutput, false);
+
+    // the full calculation of the new input
+    QVERIFY(writeInputRecords(
+        inputFile, newInput, extended,
+        {{blocks.at(0), changed}, {blocks.at(1), removed}, {all.size(), added}}
+    ));
+    Calculation::calculate(newInput, "", expectedFile, false);
+
+    // the delta run gives the same result
+    QVERIFY(writeInputRecords(
+        inputFile, deltaFile, {blocks.at(0), blocks.at(1), blocks.at(2), blocks.at(0)},
+        {{0, changed}, {1, removed}, {3, added}}
+    ));
+
+    DbaseReader previousReader(previousInput);
+    DbaseReader outputReader(previousOutput);
+    DbaseReader deltaReader(deltaFile);
+    QVERIFY(previousReader.checkAndRead());
+    QVERIFY(outputReader.read());
+    QVERIFY(deltaReader.checkAndRead());
+
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+    InitValues initValues;
+
+    Calculation calculation(previousReader, initValues, protocolStream);
+    QVERIFY(calculation.calcDelta(deltaReader, outputReader, mergedFile));
+    QVERIFY(protocol.contains("Delta: 1 geaendert, 1 neu, 1 entfernt, 1 unveraendert"));
+    QVERIFY(dbfStringsAreIdentical(mergedFile, expectedFile));
+
+    // Only changed blocks: the rows of the previous result are overwritten
+    QVERIFY(writeInputRecords(inputFile, newInput, all, {{blocks.at(0), changed}}));
+    Calculation::calculate(newInput, "", expectedFile, false);
+
+    QVERIFY(writeInputRecords(inputFile, deltaFile, {blocks.at(0)}, {{0, changed}}));
+    DbaseReader changedReader(deltaFile);
+    QVERIFY(changedReader.checkAndRead());
+
+    QVERIFY(calculation.calcDelta(changedReader, outputReader, mergedFile));
+    QVERIFY(protocol.contains("Zeilen ersetzt"));
+    QVERIFY(dbfStringsAreIdentical(mergedFile, expectedFile));
+
+    // A field of the delta file that the previous input does not have is
+    // rejected
+    QVERIFY(addYearColumns(deltaFile, newInput, "19"));
+    DbaseReader extraReader(newInput);
+    QVERIFY(extraReader.checkAndRead());
+
+    QVERIFY(!calculation.calcDelta(extraReader, outputReader, mergedFile));
+    QVERIFY(calculation.getError().contains("REGENJA_19"));
+
+    for (QString file : {previousInput, previousOutput, deltaFile, newInput, expectedFile, mergedFile}) {
+        removeResultFile(file);
+        QFile::remove(Helpers::defaultLogFileName(file));
     }
+}
 
-    return true;
+void TestAbimo::test_configDiff()
+{
+    DbaseReader dbReader(dataFilePath("abimo_2019_mitstrassen.dbf"));
+    QVERIFY(dbReader.checkAndRead());
+
+    abimoRecord record;
+    int k = 0;
+
+    do {
+        dbReader.fillRecord(k++, record);
+    } while (record.NUTZUNG == 0);
+
+    record.BELAG3_fraction = 0.0F;
+    record.STR_BELAG3_fraction = 0.0F;
+
+    InitValues before;
+    InitValues after;
+
+    QVERIFY(ConfigDiff(before, after).isEmpty());
+
+    // A changed pavement class affects only blocks with a share of it
+    after.setBagbel3(before.getBagbel3() + 1.0F);
+    ConfigDiff pavement(before, after);
+
+    QCOMPARE(pavement.getChanges(), QStringList({"bagbel3"}));
+    QVERIFY(!pavement.affectsAll());
+    QVERIFY(!pavement.affects(record));
+
+    record.STR_BELAG3_fraction = 0.5F;
+    QVERIFY(pavement.affects(record));
+    record.STR_BELAG3_fraction = 0.0F;
+
+    // A changed potential evaporation affects only blocks of the district
+    InitValues district;
+    district.hashETP.insert(record.BEZIRK + 1, 600);
+    district.hashETPS.insert(record.BEZIRK + 1, DEFAULT_ETPS);
+    district.hashEG.insert(record.BEZIRK + 1, 700);
+    ConfigDiff evaporation(before, district);
+
+    QVERIFY(!evaporation.affects(record));
+    record.BEZIRK++;
+    QVERIFY(evaporation.affects(record));
+
+    // Other decimals change all rows of the result
+    after.setDecR(before.getDecR() + 1);
+    QVERIFY(ConfigDiff(before, after).affectsAll());
 }
 
-bool TestAbimo::dbfStringsAreIdentical(QString file_1, QString file_2)
+void TestAbimo::test_calcConfigChange()
 {
-    DbaseReader reader_1(file_1);
-    DbaseReader reader_2(file_2);
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString previousOutput = dataFilePath("tmp_config_out.dbf", false);
+    QString changedFile = dataFilePath("tmp_config_changed.dbf", false);
+    QString expectedFile = dataFilePath("tmp_config_expected.dbf", false);
 
-    reader_1.read();
-    reader_2.read();
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
 
-    int nrows_1 = reader_1.getNumberOfRecords();
-    int nrows_2 = reader_2.getNumberOfRecords();
+    QString protocol;
+    QTextStream protocolStream(&protocol);
 
-    if (numbersInFilesDiffer(file_1, file_2, nrows_1, nrows_2, "rows")) {
-        return false;
-    };
+    InitValues before;
+    QVERIFY(Calculation(dbReader, before, protocolStream).calc(previousOutput));
 
-    int ncols_1 = reader_1.getCountFields();
-    int ncols_2 = reader_2.getCountFields();
+    DbaseReader outputReader(previousOutput);
+    QVERIFY(outputReader.read());
 
-    if (numbersInFilesDiffer(file_1, file_2, ncols_1, ncols_2, "columns")) {
-        return false;
-    };
+    // A changed pavement class and the potential evaporation of the district
+    // of the first block
+    abimoRecord record;
+    int k = 0;
 
-    return Helpers::stringsAreEqual(
-        reader_1.getVals(), reader_2.getVals(), nrows_1 * ncols_1, 5, true
-    );
+    do {
+        dbReader.fillRecord(k++, record);
+    } while (record.NUTZUNG == 0);
+
+    InitValues pavement;
+    pavement.setBagbel3(before.getBagbel3() + 0.1F);
+
+    InitValues district;
+    district.hashETP.insert(record.BEZIRK, DEFAULT_ETP + 50);
+    district.hashETPS.insert(record.BEZIRK, DEFAULT_ETPS);
+    district.hashEG.insert(record.BEZIRK, DEFAULT_EG);
+
+    for (InitValues *after : {&pavement, &district}) {
+
+        Calculation calculation(dbReader, *after, protocolStream);
+        QVERIFY(calculation.calcConfigChange(before, outputReader, changedFile));
+        QVERIFY(Calculation(dbReader, *after, protocolStream).calc(expectedFile));
+
+        // same result as the full calculation
+        QVERIFY(dbfStringsAreIdentical(changedFile, expectedFile));
+
+        // the rows of the blocks not affected are copied unchanged (output
+        // rows are the input records with NUTZUNG != 0)
+        ConfigDiff diff(before, *after);
+        QVector<int> unaffected;
+        int row = 0;
+
+        for (k = 0; k < dbReader.getNumberOfRecords(); k++) {
+
+            dbReader.fillRecord(k, record);
+
+            if (record.NUTZUNG == 0) {
+                continue;
+            }
+
+            if (!diff.affects(record)) {
+                unaffected.append(row);
+            }
+
+            row++;
+        }
+
+        QVERIFY(unaffected.size() > 0);
+        QVERIFY(unaffected.size() < row);
+        QVERIFY(dbfRecordsAreIdentical(changedFile, previousOutput, unaffected));
+
+        QFile::remove(expectedFile);
+    }
+
+    for (QString file : {previousOutput, changedFile, expectedFile}) {
+        removeResultFile(file);
+    }
 }
 
-bool TestAbimo::numbersInFilesDiffer(QString file_1, QString file_2, int n_1, int n_2, QString subject)
+void TestAbimo::test_resultCache()
 {
-    if (n_1 != n_2) {
-        qDebug() << QString("Number of %1 (file_1: %2, file_2: %3) differs.").arg(
-            subject, file_1, file_2, QString::number(n_1), QString::number(n_2)
-        );
-        return true;
-    };
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString cacheFile = dataFilePath("tmp_results.cache", false);
+    QString outputFile = dataFilePath("tmp_out.dbf", false);
+    QString outFile_noConfig = dataFilePath("abimo_2019_mitstrassenout_3.2.1_default-config.dbf");
 
-    return false;
+    QFile::remove(cacheFile);
+
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
+
+    InitValues initValues;
+
+    // The first run fills the cache, the second one takes all results from
+    // it. Both results are the same as without cache. With enough slots no
+    // result is replaced.
+    for (int run = 0; run < 2; run++) {
+
+        QString protocol;
+        QTextStream protocolStream(&protocol);
+
+        ResultCache cache(cacheFile, 8 * dbReader.getNumberOfRecords());
+        QVERIFY(cache.open());
+
+        Calculation calculator(dbReader, initValues, protocolStream);
+        calculator.setResultCache(&cache);
+        QVERIFY(calculator.calc(outputFile));
+        QVERIFY(dbfStringsAreIdentical(outputFile, outFile_noConfig));
+
+        QVERIFY(cache.getLookups() > 0);
+
+        if (run == 1) {
+            QCOMPARE(cache.getHits(), cache.getLookups());
+        }
+    }
+
+    // With deduplication each unique parameter tuple is looked up
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+
+    ResultCache cache(cacheFile);
+    QVERIFY(cache.open());
+
+    Calculation calculator(dbReader, initValues, protocolStream);
+    calculator.setResultCache(&cache);
+    calculator.setDeduplicate(true);
+    QVERIFY(calculator.calc(outputFile));
+    QVERIFY(dbfStringsAreIdentical(outputFile, outFile_noConfig));
+
+    QVERIFY(cache.getLookups() > 0);
+    QCOMPARE(cache.getHits(), cache.getLookups());
+    cache.close();
+
+    // The file is recreated with another requested capacity
+    qint64 size = QFileInfo(cacheFile).size();
+    ResultCache small(cacheFile, RESULTCACHE_PROBES);
+    QVERIFY(small.open());
+    QVERIFY(QFileInfo(cacheFile).size() < size);
+    small.close();
+
+    QFile::remove(cacheFile);
+}
+
+void TestAbimo::test_bagrov()
+{
+    Bagrov bagrov;
+
+    // one call per regime
+    float y = bagrov.nbagro(0.5F, 1.0F);
+    QVERIFY(y > 0 && y <= 1);
+    bagrov.nbagro(2.0F, 1.0F);
+    bagrov.nbagro(5.0F, 1.0F);
+
+    const BagrovStatistics &statistics = bagrov.getStatistics();
+    QCOMPARE(statistics.calls[seriesExpansion], 1L);
+    QCOMPARE(statistics.calls[closedForm], 1L);
+    QCOMPARE(statistics.calls[newton], 1L);
+    QCOMPARE(statistics.iterations[closedForm], 0L);
+    QVERIFY(statistics.iterations[newton] <= 15);
+    QVERIFY(statistics.iterations[seriesExpansion] <= BAGROV_MAX_ITERATIONS);
+
+    // the numerical integration ends for input it did not converge for before
+    float bag = 0.24F, x = 5.1F;
+    bagrov.bagrov(&bag, &x, &y);
+    QVERIFY(y > 0 && y <= 1);
+    QCOMPARE(statistics.integrations, 1L);
+
+    bagrov.resetStatistics();
+    QCOMPARE(bagrov.getStatistics().calls[seriesExpansion], 0L);
+}
+
+void TestAbimo::test_bagrovWarmStart()
+{
+    Bagrov cold;
+    Bagrov warm;
+
+    warm.setWarmStart(true);
+
+    // sorted by bag and x, as in Calculation::calcDeduplicated()
+    for (float bag = 0.1F; bag < 10.0F; bag += 0.1F) {
+        for (float x = 0.01F; x < 5.0F; x += 0.01F) {
+            float expected = cold.nbagro(bag, x);
+            QVERIFY(qAbs(warm.nbagro(bag, x) - expected) <= 0.001F * expected);
+        }
+    }
+
+    const BagrovStatistics &coldStatistics = cold.getStatistics();
+    const BagrovStatistics &warmStatistics = warm.getStatistics();
+
+    QCOMPARE(coldStatistics.warmStarts, 0L);
+    QVERIFY(warmStatistics.warmStarts > 0);
+    QVERIFY(warmStatistics.iterations[newton] < coldStatistics.iterations[newton] / 2);
+    QVERIFY(warmStatistics.iterations[seriesExpansion] <= coldStatistics.iterations[seriesExpansion]);
+}
+
+void TestAbimo::test_bagrovCurve()
+{
+    Bagrov bagrov;
+    Bagrov solver;
+
+    float xs[100];
+    float ys[100];
+
+    for (int i = 0; i < 100; i++) {
+        xs[i] = i * 0.05F;
+    }
+
+    // one parameter per regime and one above the limit of 20
+    const float bags[] = {0.05F, 0.4F, 1.5F, 5.0F, 25.0F};
+
+    for (float bag : bags) {
+
+        BagrovCurve curve(solver, bag);
+        curve.y(xs, ys, 100);
+
+        for (int i = 0; i < 100; i++) {
+            QVERIFY(ys[i] == bagrov.nbagro(bag, xs[i]));
+            QVERIFY(curve.y(xs[i]) == ys[i]);
+        }
+    }
+
+    // the calls of the curves are counted by their solver
+    for (int i = 0; i < BAGROV_REGIMES; i++) {
+        QCOMPARE(solver.getStatistics().calls[i], 2 * bagrov.getStatistics().calls[i]);
+    }
+}
+
+void TestAbimo::test_precision()
+{
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString outputFile = dataFilePath("tmp_out.dbf", false);
+    QString outFile_noConfig = dataFilePath("abimo_2019_mitstrassenout_3.2.1_default-config.dbf");
+
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
+
+    InitValues initValues;
+
+    // The legacy arithmetic reproduces the reference results exactly
+    Calculation legacy(dbReader, initValues, protocolStream);
+    legacy.setPrecision(Precision::legacyFloat);
+    QVERIFY(legacy.calc(outputFile));
+    QVERIFY(dbfStringsAreIdentical(outputFile, outFile_noConfig));
+
+    // The other arithmetics differ by less than 0.5 mm/a
+    const Precision precisions[] = {Precision::doublePrecision, Precision::fastFloat};
+    const char *fields[] = {"R", "ROW", "RI"};
+
+    for (Precision precision : precisions) {
+
+        Calculation calculation(dbReader, initValues, protocolStream);
+        calculation.setPrecision(precision);
+        QVERIFY(calculation.calc(outputFile));
+
+        DbaseReader output(outputFile);
+        DbaseReader reference(outFile_noConfig);
+        QVERIFY(output.read());
+        QVERIFY(reference.read());
+        QCOMPARE(output.getNumberOfRecords(), reference.getNumberOfRecords());
+
+        for (int i = 0; i < output.getNumberOfRecords(); i++) {
+            for (const char *field : fields) {
+                float value = output.getRecord(i, field).toFloat();
+                float expected = reference.getRecord(i, field).toFloat();
+                QVERIFY(qAbs(value - expected) < 0.5F);
+            }
+        }
+    }
+}
+
+void TestAbimo::test_usageKernels()
+{
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString outputFile = dataFilePath("tmp_out.dbf", false);
+
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
+
+    InitValues initValues;
+
+    // calc() evaluates the blocks partitioned by usage class
+    Calculation calculation(dbReader, initValues, protocolStream);
+    QVERIFY(calculation.calc(outputFile));
+
+    DbaseReader output(outputFile);
+    QVERIFY(output.read());
+
+    // The results are in the order of the input, as calculated per record
+    Calculation single(initValues, protocolStream);
+    abimoRecord record;
+    BlockResult result;
+    int row = 0;
+
+    for (int k = 0; k < dbReader.getNumberOfRecords(); k++) {
+
+        dbReader.fillRecord(k, record);
+
+        if (record.NUTZUNG == 0) {
+            continue;
+        }
+
+        single.calcRecord(record, result);
+
+        QCOMPARE(output.getRecord(row, "CODE"), record.CODE);
+        QVERIFY(qAbs(output.getRecord(row, "R").toFloat() - result.r) < 0.001F);
+        QVERIFY(qAbs(output.getRecord(row, "ROW").toFloat() - result.row) < 0.001F);
+        QVERIFY(qAbs(output.getRecord(row, "RI").toFloat() - result.ri) < 0.001F);
+
+        row++;
+    }
+
+    QCOMPARE(row, output.getNumberOfRecords());
+}
+
+void TestAbimo::test_lookupTable()
+{
+    const float x[] = {0.1F, 0.2F, 0.3F, 0.5F, 0.8F, 1.3F};
+    const float y[] = {1.0F, 2.0F, 4.0F, 8.0F, 16.0F, 32.0F};
+
+    constexpr LookupAxis<6> axis(0.0001F, 0.1F, 0.2F, 0.3F, 0.5F, 0.8F, 1.3F);
+    constexpr LookupSteps<6> steps(
+        LookupAxis<6>(0.0F, 0.1F, 0.2F, 0.3F, 0.5F, 0.8F, 1.3F),
+        LookupTable<6>(1.0F, 2.0F, 4.0F, 8.0F, 16.0F, 32.0F)
+    );
+
+    // Same bins and values as the linear search of Helpers
+    float values[401];
+    int indices[401];
+    float results[401];
+
+    for (int i = 0; i < 401; i++) {
+        values[i] = -0.5F + i * 0.005F;
+    }
+
+    axis.index(values, indices, 401);
+    steps.value(values, results, 401);
+
+    for (int i = 0; i < 401; i++) {
+        QCOMPARE(indices[i], Helpers::index(values[i], x, 6));
+        QCOMPARE(axis.index(values[i]), indices[i]);
+        QCOMPARE(results[i], Helpers::interpolate(values[i], x, y, 6));
+    }
+
+    // breakpoints themselves, with and without the epsilon
+    for (int i = 0; i < 6; i++) {
+        QCOMPARE(axis.index(x[i]), i);
+        QCOMPARE(axis.index(x[i] + 0.00005F), i);
+        QCOMPARE(steps.value(x[i]), Helpers::interpolate(x[i], x, y, 6));
+    }
+
+    constexpr LookupMatrix<2, 3> matrix(1.0F, 2.0F, 3.0F, 4.0F, 5.0F, 6.0F);
+    QCOMPARE(matrix.at(0, 2), 3.0F);
+    QCOMPARE(matrix.at(1, 0), 4.0F);
+}
+
+void TestAbimo::test_districtValues()
+{
+    QHash<int, int> hash;
+    hash[0] = 500;
+    hash[3] = 600;
+    hash[5] = 700;
+
+    DistrictValues values;
+    values.compile(hash, DEFAULT_ETP);
+
+    QCOMPARE(values.value(3), 600);
+    QCOMPARE(values.value(5), 700);
+    QVERIFY(!values.isDefaulted(3));
+
+    // value of district 0 for unknown districts
+    QCOMPARE(values.value(4), 500);
+    QCOMPARE(values.value(100), 500);
+    QCOMPARE(values.value(-1), 500);
+    QVERIFY(values.isDefaulted(4));
+    QVERIFY(values.isDefaulted(100));
+
+    QVERIFY(values.markReported(4));
+    QVERIFY(!values.markReported(4));
+    QVERIFY(values.markReported(100));
+    QVERIFY(!values.markReported(100));
+
+    // default value without district 0
+    hash.remove(0);
+    values.compile(hash, DEFAULT_ETP);
+    QCOMPARE(values.value(4), DEFAULT_ETP);
+    QVERIFY(values.markReported(4));
+
+    // Without configuration, the missing ETP is reported once per district
+    QString inputFile = dataFilePath("abimo_2019_mitstrassen.dbf");
+    QString outputFile = dataFilePath("tmp_out.dbf", false);
+
+    QString protocol;
+    QTextStream protocolStream(&protocol);
+
+    DbaseReader dbReader(inputFile);
+    QVERIFY(dbReader.checkAndRead());
+
+    InitValues initValues;
+    Calculation calculation(dbReader, initValues, protocolStream);
+    QVERIFY(calculation.calc(outputFile));
+
+    QSet<int> districts;
+    abimoRecord record;
+
+    for (int k = 0; k < dbReader.getNumberOfRecords(); k++) {
+        dbReader.fillRecord(k, record);
+        if (record.NUTZUNG != 0) {
+            districts.insert(record.BEZIRK);
+        }
+    }
+
+    QVERIFY(protocol.count("ETP unbekannt fuer") <= districts.size());
+    QVERIFY(protocol.count("ETP unbekannt fuer") > 0);
+}
+
+void TestAbimo::test_recordStore()
+{
+    DbaseReader dbReader(dataFilePath("abimo_2019_mitstrassen.dbf"));
+    QVERIFY(dbReader.checkAndRead());
+
+    RecordStore store;
+    abimoRecord record;
+    abimoRecord decoded;
+
+    int n = dbReader.getNumberOfRecords();
+
+    for (int k = 0; k < n; k++) {
+        dbReader.fillRecord(k, record);
+        QCOMPARE(store.append(record), k);
+    }
+
+    QCOMPARE(store.size(), n);
+    QVERIFY(store.getBytes() < n * (qint64) sizeof(abimoRecord));
+
+    // the records are decoded to the same values
+    for (int k = 0; k < n; k++) {
+        dbReader.fillRecord(k, record);
+        store.get(k, decoded);
+
+        QCOMPARE(decoded.CODE, record.CODE);
+        QCOMPARE(store.getCode(k), record.CODE);
+        QCOMPARE(decoded.NUTZUNG, record.NUTZUNG);
+        QCOMPARE(decoded.TYP, record.TYP);
+        QCOMPARE(decoded.BEZIRK, record.BEZIRK);
+        QCOMPARE(decoded.FELD_30, record.FELD_30);
+        QCOMPARE(decoded.FELD_150, record.FELD_150);
+        QCOMPARE(decoded.REGENJA, record.REGENJA);
+        QCOMPARE(decoded.REGENSO, record.REGENSO);
+        QVERIFY(decoded.FLUR == record.FLUR);
+        QVERIFY(decoded.FLGES == record.FLGES);
+        QVERIFY(decoded.STR_FLGES == record.STR_FLGES);
+        QVERIFY(decoded.PROBAU_fraction == record.PROBAU_fraction);
+        QVERIFY(decoded.PROVGU_fraction == record.PROVGU_fraction);
+        QVERIFY(decoded.VGSTRASSE_fraction == record.VGSTRASSE_fraction);
+        QVERIFY(decoded.KAN_BEB_fraction == record.KAN_BEB_fraction);
+        QVERIFY(decoded.KAN_VGU_fraction == record.KAN_VGU_fraction);
+        QVERIFY(decoded.KAN_STR_fraction == record.KAN_STR_fraction);
+        QVERIFY(decoded.BELAG1_fraction == record.BELAG1_fraction);
+        QVERIFY(decoded.BELAG4_fraction == record.BELAG4_fraction);
+        QVERIFY(decoded.STR_BELAG1_fraction == record.STR_BELAG1_fraction);
+        QVERIFY(decoded.STR_BELAG4_fraction == record.STR_BELAG4_fraction);
+    }
+
+    // values that cannot be packed are kept as they are
+    record.PROVGU_fraction = 0.12345F;
+    record.BEZIRK = -1;
+    int index = store.append(record);
+
+    QVERIFY(store.getNumberOfUnpacked() > 0);
+    store.get(index, decoded);
+    QVERIFY(decoded.PROVGU_fraction == 0.12345F);
+    QCOMPARE(decoded.BEZIRK, -1);
+    QCOMPARE(store.getCode(index), record.CODE);
+}
+
+void TestAbimo::test_codeArena()
+{
+    CodeArena arena;
+
+    QCOMPARE(arena.add("0001", 4), 0);
+    QCOMPARE(arena.add("123456", 6), 1);
+    QCOMPARE(arena.size(), 2);
+    QCOMPARE(arena.getString(1), QString("123456"));
+    QCOMPARE(arena.getMaxLength(), 6);
+    QVERIFY(arena.isAscii(0));
+
+    // The writer copies the codes into the CODE field (padded with '0')
+    QString outputFile = dataFilePath("tmp_codes.dbf", false);
+    InitValues initValues;
+    DbaseWriter writer(outputFile, initValues);
+
+    for (int id = 0; id < 2; id++) {
+        writer.addRecord();
+        writer.setRecordCode(arena, id);
+        setResultValues(writer, 1.0F);
+    }
+
+    QVERIFY(writer.write());
+
+    DbaseReader reader(outputFile);
+    QVERIFY(reader.read());
+    QCOMPARE(reader.getNumberOfRecords(), 2);
+    QCOMPARE(reader.getField(0).getFieldLength(), 6);
+    QCOMPARE(reader.getRecord(0, "CODE"), QString("000001"));
+    QCOMPARE(reader.getRecord(1, "CODE"), QString("123456"));
+
+    // The reader keeps the codes in its arena, by record number
+    QCOMPARE(reader.getCodes().size(), 2);
+    QCOMPARE(reader.getCodes().getString(1), QString("123456"));
+
+    removeResultFile(outputFile);
+}
+
+void TestAbimo::test_runArena()
+{
+    RunArena arena;
+
+    char *text = arena.copy("abc", 3);
+    QVERIFY(arena.allocate(RUN_ARENA_CHUNK_SIZE) != 0);
+    QCOMPARE(QByteArray(text, 3), QByteArray("abc"));
+    QCOMPARE(arena.getStatistics().bytes, (qint64) RUN_ARENA_CHUNK_SIZE + 3);
+    QCOMPARE(arena.getStatistics().allocations, 2L);
+    QCOMPARE(arena.getStatistics().heapAllocations, 2L);
+
+    // The chunks are kept for the next run
+    arena.reset();
+    arena.copy("abc", 3);
+    arena.allocate(RUN_ARENA_CHUNK_SIZE);
+    QCOMPARE(arena.getStatistics().allocations, 2L);
+    QCOMPARE(arena.getStatistics().heapAllocations, 0L);
+
+    // The writer formats the values as QString::setNum() did
+    QString outputFile = dataFilePath("tmp_values.dbf", false);
+    InitValues initValues;
+    initValues.setDecR(3);
+    initValues.setDecROW(0);
+    initValues.setDecRI(2);
+    initValues.setDecRVOL(3);
+    initValues.setDecROWVOL(1);
+    initValues.setDecRIVOL(2);
+    initValues.setDecFLAECHE(1);
+    initValues.setDecVERDUNSTUNG(0);
+
+    DbaseWriter writer(outputFile, initValues);
+    float values[2][8] = {
+        {-1.5F, 123.5F, 0.25F, 1000.75F, 0.0F, -0.05F, 42.0F, 7.4F},
+        {2.25F, 1.0F, 1.0F, 1.0F, 1.0F, -10.5F, 1.0F, 1.0F}
+    };
+
+    for (int i = 0; i < 2; i++) {
+        writer.addRecord();
+        writer.setRecordField("CODE", QString::number(i));
+        for (int field = 0; field < 8; field++) {
+            writer.setRecordField(field + 1, values[i][field]);
+        }
+    }
+
+    QCOMPARE(writer.getStatistics().allocations, 18L);
+    QVERIFY(writer.write());
+
+    DbaseReader reader(outputFile);
+    QVERIFY(reader.read());
+    QCOMPARE(reader.getRecord(0, "R"), QString("-1.500"));
+    QCOMPARE(reader.getRecord(0, "ROW"), QString("124"));
+    QCOMPARE(reader.getRecord(0, "RI"), QString("0.25"));
+    QCOMPARE(reader.getRecord(0, "RVOL"), QString("1000.750"));
+    QCOMPARE(reader.getRecord(0, "ROWVOL"), QString("0.0"));
+    QCOMPARE(reader.getRecord(0, "RIVOL"), QString("-00.05"));
+    QCOMPARE(reader.getRecord(0, "FLAECHE"), QString("42.0"));
+    QCOMPARE(reader.getRecord(0, "VERDUNSTUN"), QString("7"));
+    QCOMPARE(reader.getRecord(1, "R"), QString("02.250"));
+    QCOMPARE(reader.getRecord(1, "RIVOL"), QString("-10.50"));
+}
+
+void TestAbimo::test_recordFilter()
+{
+    RecordFilter filter;
+
+    QVERIFY(filter.isEmpty());
+    QVERIFY(!filter.add("BEZIRK"));
+    QVERIFY(!filter.add("BEZIRK=1,x"));
+    QVERIFY(!filter.add("TYP=1"));
+    QVERIFY(filter.isEmpty());
+
+    // A file with the codes A1, B2, C3 (and no other input fields)
+    QString file = dataFilePath("tmp_filter.dbf", false);
+    QVERIFY(writeResultFile(file, {"A1", "B2", "C3"}));
+
+    DbaseReader reader(file);
+    QVERIFY(reader.read());
+
+    QVERIFY(filter.add("CODE=C3, B2,X9"));
+    QVERIFY(!filter.matches(reader, 0));
+    QVERIFY(filter.matches(reader, 1));
+    QVERIFY(filter.matches(reader, 2));
+
+    // All filters must match (a missing field has the value 0)
+    QVERIFY(filter.add("code=A1,B2"));
+    QVERIFY(!filter.matches(reader, 2));
+    QVERIFY(filter.matches(reader, 1));
+    QVERIFY(filter.add("BEZIRK=0,7"));
+    QVERIFY(filter.matches(reader, 1));
+    QVERIFY(filter.add("BEZIRK=7"));
+    QVERIFY(!filter.matches(reader, 1));
+
+    // Codes given in a file
+    QString codeFile = dataFilePath("tmp_filter_codes.txt", false);
+    QFile out(codeFile);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    out.write("A1\r\n\r\nC3\n");
+    out.close();
+
+    RecordFilter fromFile;
+    QVERIFY(fromFile.add("CODE=@" + codeFile));
+    QVERIFY(fromFile.matches(reader, 0));
+    QVERIFY(!fromFile.matches(reader, 1));
+    QVERIFY(fromFile.matches(reader, 2));
+    QVERIFY(!fromFile.add("CODE=@" + dataFilePath("no_such_file.txt", false)));
+
+    QFile::remove(codeFile);
+    removeResultFile(file);
+}
+
+void TestAbimo::test_codeIndex()
+{
+    // A result file with the codes C3, A1, B2, A1 (the index is written too)
+    QString file = dataFilePath("tmp_codeindex.dbf", false);
+    removeResultFile(file);
+
+    QVERIFY(writeResultFile(file, {"C3", "A1", "B2", "A1"}));
+    QVERIFY(QFile::exists(CodeIndex::indexFileName(file)));
+
+    CodeIndex index(file);
+    QVERIFY(index.open(false));
+    QCOMPARE(index.getNumberOfEntries(), 4);
+    QCOMPARE(index.find(QByteArray("C3")), 0);
+    QCOMPARE(index.find(QByteArray("B2")), 2);
+    QCOMPARE(index.find(QByteArray("X9")), -1);
+    QCOMPARE(index.find(QByteArray("A")), -1);
+
+    // Of equal codes the first record is found
+    QCOMPARE(index.find(QByteArray("A1")), 1);
+    index.close();
+
+    // Only the records found are read, in the order of the codes
+    DbaseReader reader(file);
+    QVector<QByteArray> wanted = {"B2", "X9", "C3"};
+    QVector<int> numbers;
+
+    QVERIFY(reader.readRecordsByCode(wanted, numbers));
+    QCOMPARE(numbers, QVector<int>({2, -1, 0}));
+    QCOMPARE(reader.getNumberOfRecords(), 2);
+    QCOMPARE(reader.getRecord(0, "CODE"), QString("B2"));
+    QCOMPARE(reader.getRecord(1, "CODE"), QString("C3"));
+    QCOMPARE(reader.getRecord(1, "R"), reader.getRecord(0, "R"));
+
+    DbaseReader outOfRange(file);
+    QVERIFY(!outOfRange.readRecords(QVector<int>({4})));
+
+    // A missing index is built on first use
+    QVERIFY(QFile::remove(CodeIndex::indexFileName(file)));
+    QVERIFY(!index.open(false));
+    QVERIFY(index.open());
+    QCOMPARE(index.find(QByteArray("B2")), 2);
+    index.close();
+
+    // An index that does not fit the file (records in another order) is
+    // detected by the codes read and built again
+    CodeArena shuffled;
+    shuffled.add("B2", 2);
+    shuffled.add("C3", 2);
+    shuffled.add("A1", 2);
+    shuffled.add("A1", 2);
+
+    QString error;
+    QVERIFY(CodeIndex::write(file, shuffled, error));
+
+    DbaseReader stale(file);
+    QVERIFY(stale.readRecordsByCode({"B2"}, numbers));
+    QCOMPARE(numbers, QVector<int>({2}));
+    QCOMPARE(stale.getRecord(0, "CODE"), QString("B2"));
+
+    QVERIFY(index.open(false));
+    QCOMPARE(index.find(QByteArray("B2")), 2);
+    index.close();
+
+    // Codes written as they are in the arena of setRecordCode() are indexed
+    // from the arena, the other codes of the arena are not found
+    CodeArena arena;
+    arena.add("X1", 2);
+    arena.add("Y2", 2);
+    arena.add("Z3", 2);
+
+    InitValues initValues;
+    DbaseWriter writer(file, initValues);
+
+    for (int id = 2; id >= 1; id--) {
+        writer.addRecord();
+        writer.setRecordCode(arena, id);
+        setResultValues(writer, 1.0F);
+    }
+
+    QVERIFY(writer.write());
+    QVERIFY(writer.getIndexError().isEmpty());
+
+    QVERIFY(index.open(false));
+    QCOMPARE(index.getNumberOfEntries(), 2);
+    QCOMPARE(index.find(QByteArray("Z3")), 0);
+    QCOMPARE(index.find(QByteArray("Y2")), 1);
+    QCOMPARE(index.find(QByteArray("X1")), -1);
+    index.close();
+
+    removeResultFile(file);
+}
+
+void TestAbimo::test_largeFile()
+{
+#ifdef Q_OS_WIN
+    QSKIP("The test needs a sparse file of more than 4 GiB");
+#endif
+
+    // A result file with the records A1, B2, C3 as template
+    QString small = dataFilePath("tmp_large_template.dbf", false);
+    QVERIFY(writeResultFile(small, {"A1", "B2", "C3"}));
+
+    QFile in(small);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    QByteArray header = in.read(lengthOfHeader);
+    QByteArray records = in.read(in.size() - lengthOfHeader - 1);
+    in.close();
+    removeResultFile(small);
+
+    int length = records.size() / 3;
+
+    // The same header with more records than fit into 4 GiB, only the first
+    // and the last record are written, the rest of the file is a hole
+    qint64 size = (qint64) 5 << 30;
+    int n = (int) (size / length);
+
+    for (int i = 0; i < 4; i++) {
+        header[4 + i] = (char) (n >> (8 * i));
+    }
+
+    QString large = dataFilePath("tmp_large.dbf", false);
+    QFile::remove(CodeIndex::indexFileName(large));
+
+    QFile out(large);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    out.write(header);
+    out.write(records.mid(0, length));
+    QVERIFY(out.seek(lengthOfHeader + (qint64) (n - 1) * length));
+    out.write(records.mid(2 * length, length));
+    out.write("\x1A", 1);
+    out.close();
+
+    QCOMPARE(QFileInfo(large).size(), lengthOfHeader + (qint64) n * length + 1);
+
+    // Only the requested records are read
+    DbaseReader reader(large);
+    QVERIFY(reader.readRecords(QVector<int>({n - 1, 0})));
+    QCOMPARE(reader.getRecord(0, "CODE"), QString("C3"));
+    QCOMPARE(reader.getRecord(1, "CODE"), QString("A1"));
+
+    // A record behind 4 GiB is patched in place
+    InitValues initValues;
+    DbaseWriter patcher(large, initValues);
+    patcher.addRecord();
+    patcher.setRecordField("CODE", QString("D4"));
+    setResultValues(patcher, 1.0F);
+
+    QVERIFY(patcher.patch(reader, QVector<int>({n - 1})));
+
+    DbaseReader patched(large);
+    QVERIFY(patched.readRecords(QVector<int>({n - 1})));
+    QCOMPARE(patched.getRecord(0, "CODE"), QString("D4"));
+
+    QVERIFY(QFile::remove(large));
+    QFile::remove(CodeIndex::indexFileName(large));
+}
+
+void TestAbimo::test_largeWrite()
+{
+#ifdef Q_OS_WIN
+    QSKIP("The test needs a file of more than 4 GiB");
+#endif
+
+    QString file = dataFilePath("tmp_large_write.dbf", false);
+
+    if (QStorageInfo(QFileInfo(file).absolutePath()).bytesAvailable() < ((qint64) 7 << 30)) {
+        QSKIP("The test needs 7 GiB of free disk space");
+    }
+
+    // More records of more than 250 bytes than fit into 4 GiB, the last one
+    // with another code. Most of them are spooled (see DbaseWriter::addRecord()).
+    CodeArena arena;
+    QByteArray code(250, 'A');
+    arena.add(code.constData(), code.size());
+    code[249] = 'B';
+    arena.add(code.constData(), code.size());
+
+    int n = (int) (((qint64) 4 << 30) / 250) + 1;
+
+    InitValues initValues;
+    DbaseWriter writer(file, initValues);
+    writer.reserve(n);
+
+    for (int i = 0; i < n; i++) {
+        writer.addRecord();
+        writer.setRecordCode(arena, (i == n - 1) ? 1 : 0);
+        setResultValues(writer, (float) (i % 100));
+    }
+
+    QVERIFY(writer.write());
+    QVERIFY(writer.getIndexError().isEmpty());
+    QVERIFY(QFileInfo(file).size() > ((qint64) 4 << 30));
+
+    DbaseReader reader(file);
+    QVERIFY(reader.readRecords(QVector<int>({0, n - 2, n - 1})));
+    QCOMPARE(reader.getRecord(0, "CODE"), arena.getString(0));
+    QCOMPARE(reader.getRecord(1, "R").toFloat(), (float) ((n - 2) % 100));
+    QCOMPARE(reader.getRecord(2, "CODE"), arena.getString(1));
+
+    // The index refers to the codes in the arena
+    CodeIndex index(file);
+    QVERIFY(index.open(false));
+    QCOMPARE(index.find(arena.getData(1), arena.getLength(1)), n - 1);
+    index.close();
+
+    removeResultFile(file);
+}
+
+// Copy of a dbf file with the columns REGENJA_<year> and REGENSO_<year>
+// added, holding the values of REGENJA and REGENSO (see
+// Calculation::calcSeries())
+bool TestAbimo::addYearColumns(QString inputFile, QString outputFile, QString year)
+{
+    QFile in(inputFile);
+
+    if (!in.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray bytes = in.readAll();
+    in.close();
+
+    // little endian numbers of the file header
+    auto number = [](const QByteArray &data, int index, int size) {
+        int value = 0;
+        for (int i = size - 1; i >= 0; i--) {
+            value = value * 256 + (quint8) data[index + i];
+        }
+        return value;
+    };
+
+    auto setNumber = [](QByteArray &data, int index, int size, int value) {
+        for (int i = 0; i < size; i++) {
+            data[index + i] = (char) (value >> (8 * i));
+        }
+    };
+
+    int numberOfRecords = number(bytes, 4, 4);
+    int lengthOfHeader = number(bytes, 8, 2);
+    int lengthOfRecord = number(bytes, 10, 2);
+    int countFields = (lengthOfHeader - 32 - 1) / 32;
+
+    // descriptors of the new fields, position of the copied values
+    const char *names[] = {"REGENJA", "REGENSO"};
+    QByteArray descriptors;
+    int offsets[2] = {-1, -1};
+    int lengths[2] = {0, 0};
+
+    for (int j = 0; j < 2; j++) {
+
+        // after the deletion flag
+        int offset = 1;
+
+        for (int i = 0; i < countFields; i++) {
+
+            QByteArray descriptor = bytes.mid(32 + 32 * i, 32);
+            int length = (quint8) descriptor[16];
+
+            if (QByteArray(descriptor.constData()) == names[j]) {
+                QByteArray name = QByteArray(names[j]) + "_" + year.toLatin1();
+                descriptor.replace(0, 11, name.leftJustified(11, '\0'));
+                descriptors.append(descriptor);
+                offsets[j] = offset;
+                lengths[j] = length;
+            }
+
+            offset += length;
+        }
+
+        if (offsets[j] < 0) {
+            return false;
+        }
+    }
+
+    int end = 32 + 32 * countFields;
+    QByteArray out = bytes.left(end) + descriptors + bytes.mid(end, lengthOfHeader - end);
+
+    setNumber(out, 8, 2, lengthOfHeader + descriptors.size());
+    setNumber(out, 10, 2, lengthOfRecord + lengths[0] + lengths[1]);
+
+    for (int k = 0; k < numberOfRecords; k++) {
+        QByteArray record = bytes.mid(lengthOfHeader + k * lengthOfRecord, lengthOfRecord);
+        out.append(record);
+        out.append(record.mid(offsets[0], lengths[0]));
+        out.append(record.mid(offsets[1], lengths[1]));
+    }
+
+    out.append((char) 0x1A);
+
+    QFile file(outputFile);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    bool written = (file.write(out) == out.size());
+    file.close();
+
+    return written;
+}
+
+// Write the records of inputFile with the given numbers (in this order) to
+// outputFile, the values of changes (by position in numbers and field name)
+// replacing those of the input
+bool TestAbimo::writeInputRecords(
+    QString inputFile, QString outputFile, QVector<int> numbers,
+    QMap<int, QHash<QString, QString> > changes
+)
+{
+    DbaseReader reader(inputFile);
+    QFile in(inputFile);
+
+    if (!reader.read() || !in.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray bytes = in.readAll();
+    in.close();
+
+    int lengthOfHeader = reader.getLengthOfHeader();
+    int lengthOfRecord = reader.getLengthOfEachRecord();
+    int n = numbers.size();
+
+    QByteArray out = bytes.left(lengthOfHeader);
+
+    // little endian number of records
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = (char) (n >> (8 * i));
+    }
+
+    for (int k = 0; k < n; k++) {
+
+        QByteArray record = bytes.mid(lengthOfHeader + numbers.at(k) * lengthOfRecord, lengthOfRecord);
+
+        // after the deletion flag
+        int offset = 1;
+
+        for (int i = 0; i < reader.getCountFields(); i++) {
+
+            DbaseField field = reader.getField(i);
+            int length = field.getFieldLength();
+
+            if (changes.value(k).contains(field.getName())) {
+                QByteArray value = changes.value(k).value(field.getName()).toLatin1();
+                record.replace(offset, length, field.getType() == "C" ?
+                    value.leftJustified(length, ' ', true) :
+                    value.rightJustified(length, ' ', true)
+                );
+            }
+
+            offset += length;
+        }
+
+        out.append(record);
+    }
+
+    out.append((char) 0x1A);
+
+    QFile file(outputFile);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    bool written = (file.write(out) == out.size());
+    file.close();
+
+    return written;
+}
+
+bool TestAbimo::dbfHeadersAreIdentical(QString file_1, QString file_2)
+{
+    DbaseReader reader_1(file_1);
+    DbaseReader reader_2(file_2);
+
+    reader_1.read();
+    reader_2.read();
+
+    if (reader_1.getVersion() != reader_2.getVersion()) {
+        qDebug() << "version differs";
+        return false;
+    }
+
+    QDate date_1 = reader_1.getDate();
+    QDate date_2 = reader_2.getDate();
+
+    if (date_1 != date_2) {
+        qDebug() << "date differs (" << date_1 << "vs" << date_2 << ")."
+                 << "This is expected.";
+    }
+
+    if (reader_1.getNumberOfRecords() != reader_2.getNumberOfRecords()) {
+        qDebug() << "numberOfRecords differs";
+        return false;
+    }
+
+    if (reader_1.getLengthOfHeader() != reader_2.getLengthOfHeader()) {
+        qDebug() << "lengthOfHeader differs";
+        return false;
+    }
+
+    if (reader_1.getLengthOfEachRecord() != reader_2.getLengthOfEachRecord()) {
+        qDebug() << "lengthOfEachRecord differs";
+        return false;
+    }
+
+    QString lng_1 = reader_1.getLanguageDriver();
+    QString lng_2 = reader_2.getLanguageDriver();
+
+    if (lng_1 != lng_2) {
+        qDebug() << "languageDriver differs"
+                 << "(" << lng_1 << "vs" << lng_2 << ")";
+        //return false;
+    }
+
+    return true;
+}
+
+bool TestAbimo::dbfStringsAreIdentical(QString file_1, QString file_2)
+{
+    DbaseReader reader_1(file_1);
+    DbaseReader reader_2(file_2);
+
+    reader_1.read();
+    reader_2.read();
+
+    int nrows_1 = reader_1.getNumberOfRecords();
+    int nrows_2 = reader_2.getNumberOfRecords();
+
+    if (numbersInFilesDiffer(file_1, file_2, nrows_1, nrows_2, "rows")) {
+        return false;
+    };
+
+    int ncols_1 = reader_1.getCountFields();
+    int ncols_2 = reader_2.getCountFields();
+
+    if (numbersInFilesDiffer(file_1, file_2, ncols_1, ncols_2, "columns")) {
+        return false;
+    };
+
+    // all values, row by row
+    QVector<QString> values_1;
+    QVector<QString> values_2;
+
+    for (int i = 0; i < nrows_1; i++) {
+        for (int j = 0; j < ncols_1; j++) {
+            values_1.append(reader_1.getRecord(i, j));
+            values_2.append(reader_2.getRecord(i, j));
+        }
+    }
+
+    return Helpers::stringsAreEqual(
+        values_1.data(), values_2.data(), nrows_1 * ncols_1, 5, true
+    );
+}
+
+// The raw bytes of the given records are the same in both files
+bool TestAbimo::dbfRecordsAreIdentical(QString file_1, QString file_2, QVector<int> rows)
+{
+    DbaseReader reader_1(file_1);
+    DbaseReader reader_2(file_2);
+    QFile in_1(file_1);
+    QFile in_2(file_2);
+
+    if (!reader_1.read() || !reader_2.read() || !in_1.open(QIODevice::ReadOnly) ||
+        !in_2.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    int length = reader_1.getLengthOfEachRecord();
+
+    if (length != reader_2.getLengthOfEachRecord()) {
+        qDebug() << "record length differs";
+        return false;
+    }
+
+    QByteArray bytes_1 = in_1.readAll().mid(reader_1.getLengthOfHeader());
+    QByteArray bytes_2 = in_2.readAll().mid(reader_2.getLengthOfHeader());
+
+    for (int i = 0; i < rows.size(); i++) {
+        if (bytes_1.mid(rows.at(i) * length, length) != bytes_2.mid(rows.at(i) * length, length)) {
+            qDebug() << "record" << rows.at(i) << "differs";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TestAbimo::numbersInFilesDiffer(QString file_1, QString file_2, int n_1, int n_2, QString subject)
+{
+    if (n_1 != n_2) {
+        qDebug() << QString("Number of %1 (file_1: %2, file_2: %3) differs.").arg(
+            subject, file_1, file_2, QString::number(n_1), QString::number(n_2)
+        );
+        return true;
+    };
+
+    return false;
+}
+
+// All values but CODE of the last record of a result file
+void TestAbimo::setResultValues(DbaseWriter &writer, float value)
+{
+    for (int field = 1; field < 9; field++) {
+        writer.setRecordField(field, value);
+    }
+}
+
+// Result file with one record per code (and no input fields)
+bool TestAbimo::writeResultFile(QString file, QStringList codes, float value)
+{
+    InitValues initValues;
+    DbaseWriter writer(file, initValues);
+
+    for (const QString &code : codes) {
+        writer.addRecord();
+        writer.setRecordField("CODE", code);
+        setResultValues(writer, value);
+    }
+
+    return writer.write();
+}
+
+// A result file and the code index written with it
+void TestAbimo::removeResultFile(QString file)
+{
+    QFile::remove(file);
+    QFile::remove(CodeIndex::indexFileName(file));
 }
 
-QTEST_APPLESS_MAIN(TestAbimo)
+QTEST_GUILESS_MAIN(TestAbimo)
 
 #include "tst_testabimo.moc"